@@ -11,6 +11,7 @@
 #include <json/json.h>
 #include <opencv2/opencv.hpp>
 #include "composion.hpp"
+#include "composion_result.hpp"
 
 #include "base/logging.h"
 
@@ -86,116 +87,8 @@ Composion::~Composion() {
 		delete m_yolov5;
 }
 
-void parse_char_info(Json::Value &infos, Json::Value &input, std::string section) {
-	for (auto i = 0; i < input["char_pos"].size(); ++i) {
-		Value pos;
-		Json::Value result;
-		pos["x"] = input["char_pos"][i][0];
-		pos["y"] = input["char_pos"][i][1];
-		result["char_location"].append(pos);
-
-		for (auto &loc : input["char_box"][i]) {
-			Value ploc;
-			ploc["x"] = loc[0];
-			ploc["y"] = loc[1];
-			result["char_location"].append(ploc);
-		}
-
-		for (auto &top : input["char_arr"][i]) {
-			Json::Value info;
-			info["char_ocr_result"] = top[0];
-			info["char_confidence"] = top[1];
-			result[section].append(info);
-		}
-
-		infos.append(result);
-	}
-}
-
-void parse_title_info(Json::Value &result, Json::Value &input, bool details) {
-	if (input.size() == 0) {
-		return;
-	}
-
-	Json::Value val = input;
-	if (!val.isMember("text")) {
-		return;
-	}
-
-	if (val["text"].isNull())
-		return;
-
-	if (val["text"].asString().size() == 0)
-		return;
-	result["title_ocr_result"] = val["text"];
-	if (!details) {
-		return;
-	}
-	parse_char_info(result["title_char_info"], val, "char_ocr_topn");
-}
-
-void parse_eassy_info(Json::Value &result, Json::Value &input, bool details) {
-	if (input.size() == 0) {
-		return;
-	}
-
-	for (auto &eaasy : input) {
-		Json::Value lines;
-		bool flag = false;
-		for (auto &line : eaasy) {
-			Json::Value info;
-			if (line["text"].isNull())
-				continue;
-
-			if (line["text"].asString().size() == 0)
-				continue;
-			flag = true;
-			info["line_ocr_result"] = line["text"];
-			if (details) {
-				parse_char_info(info["line_char_info"], line, "line_char_topn");
-			}
-			lines.append(info);
-		}
-		if (flag)
-			result["para_ocr_result"].append(lines);
-	}
-}
-
-bool parse_result(std::string &requestid, std::string &str, Json::Value &result, bool details, bool prcision) {
-	if (str.size() == 0) {
-		return true;
-	}
-
-	try {
-		Json::Reader reader;
-		Json::Value root;
-		std::string title = "title_info";
-		std::string essay = "essay_info";
-
-		if (!reader.parse(str, root)) {
-			LOG(INFO) << requestid << " reader json parse error.";
-			return false;
-		}
-		if (prcision) {
-			title = "title_info_sec";
-			essay = "essay_info_sec";
-		}
-
-		if (root.isMember("title")) {
-			parse_title_info(result[title], root["title"], details);
-		}
-		if (root.isMember("texts")) {
-			parse_eassy_info(result[essay], root["texts"], details);
-		}
-	} catch(exception &e) {
-		LOG(INFO) << requestid << "parse json err " << e.what();
-		return false;
-	}
-
-	return true;
-}
-
-bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv::Mat &img, Json::Value &result) {
+bool Composion::detect(bool prcision, const std::string &trace_id, cv::Mat &img, std::string &old_result,
+		std::string &new_result) {
 	std::vector<cv::Mat> input_imgs;
 	std::vector<std::vector<float>> mgs;
 	std::vector<cv::Mat> title_poly;
@@ -205,8 +98,6 @@ bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv
 	future<int> fu;
 	int ret;
 
-	std::string new_result;
-	std::string old_result;
 	input_imgs.emplace_back(img);
 
 	{
@@ -260,13 +151,23 @@ bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv
 		LOG(INFO) << trace_id << " old detect parse error.";
 		return false;
 	}
+	return true;
+}
+
+bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv::Mat &img, Json::Value &result,
+		int scale, const ResultFields &fields) {
+	std::string new_result;
+	std::string old_result;
+	if (!detect(prcision, trace_id, img, old_result, new_result)) {
+		return false;
+	}
 
-	if (!parse_result(trace_id, old_result, result, details, false)) {
+	if (!parse_result(trace_id, old_result, result, details, false, scale, fields)) {
 		LOG(INFO) << trace_id << " parse result error";
 		return false;
 	}
 
-	if (prcision && !parse_result(trace_id, new_result, result, details, true)) {
+	if (prcision && !parse_result(trace_id, new_result, result, details, true, scale, fields)) {
 		LOG(INFO) << trace_id << " parse result error";
 		return false;
 	}
@@ -277,3 +178,19 @@ bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv
 	LOG(INFO) << trace_id << " parse detect success";
 	return true;
 }
+
+bool Composion::parse_task(bool details, bool prcision, std::string trace_id, cv::Mat &img, ResponseFormat format,
+		std::string &data, int scale, const ResultFields &fields) {
+	std::string new_result;
+	std::string old_result;
+	if (!detect(prcision, trace_id, img, old_result, new_result)) {
+		return false;
+	}
+
+	if (!write_result(trace_id, old_result, new_result, details, prcision, scale, format, data, fields)) {
+		LOG(INFO) << trace_id << " parse result error";
+		return false;
+	}
+	LOG(INFO) << trace_id << " parse detect success";
+	return true;
+}
@@ -19,18 +19,29 @@
 #include "rec_chn_comp.hpp"
 #include "det_chn_yolov5.hpp"
 #include "threadpool.hpp"
+#include "response_writer.h"
+#include "composion_result.hpp"
 
 class Composion {
 public:
 	static Composion *instance();
 	static bool init();
 public:
-	bool parse_task(bool details, bool prcision, std::string id, cv::Mat &img, Json::Value &result);
+	/// @param scale 原图与img的比例，返回的坐标乘以此比例还原到原图
+	/// @param fields 只返回请求的部分
+	bool parse_task(bool details, bool prcision, std::string id, cv::Mat &img, Json::Value &result, int scale = 1,
+			const ResultFields &fields = ResultFields());
+	/// 与上面的结果一致，直接输出编码好的data，不构建Json::Value
+	bool parse_task(bool details, bool prcision, std::string id, cv::Mat &img, ResponseFormat format,
+			std::string &data, int scale = 1, const ResultFields &fields = ResultFields());
 private:
 	Composion();
 	~Composion();
 private:
 	bool _init();
+	/// 检测和识别，返回识别模型输出的JSON；没有文本时为空
+	bool detect(bool prcision, const std::string &trace_id, cv::Mat &img, std::string &old_result,
+			std::string &new_result);
 private:
 	std::mutex m_det_new_mutex;
 	std::mutex m_det_yolov5_mutex;
@@ -0,0 +1,542 @@
+/*
+ * composion_result.cpp
+ *
+ *  Created on: 2026年10月16日
+ */
+
+#include <map>
+#include <vector>
+#include "composion_result.hpp"
+#include "json_scanner.h"
+#include "metrics.h"
+
+#include "base/logging.h"
+
+using namespace std;
+using namespace Json;
+
+// 缩小解码的图片上的坐标还原到原图，保持原来的数值类型
+static Json::Value scale_coord(const Json::Value &val, int scale) {
+	if (scale == 1) {
+		return val;
+	}
+	if (val.isIntegral()) {
+		return Json::Value(val.asInt64() * scale);
+	}
+	return Json::Value(val.asDouble() * scale);
+}
+
+bool ResultFields::Parse(const Json::Value &fields, ResultFields &result) {
+	std::vector<std::string> names;
+	if (fields.isString()) {
+		std::string value = fields.asString();
+		size_t begin = 0;
+		while (begin <= value.size()) {
+			size_t end = value.find(',', begin);
+			if (end == std::string::npos) {
+				end = value.size();
+			}
+			names.push_back(value.substr(begin, end - begin));
+			begin = end + 1;
+		}
+	} else if (fields.isArray()) {
+		for (auto &name : fields) {
+			if (!name.isString()) {
+				return false;
+			}
+			names.push_back(name.asString());
+		}
+	} else {
+		return false;
+	}
+
+	result.title = result.paragraphs = result.char_location = result.topn = false;
+	for (auto &name : names) {
+		size_t begin = name.find_first_not_of(" \t");
+		if (begin == std::string::npos) {
+			continue;
+		}
+		name = name.substr(begin, name.find_last_not_of(" \t") + 1 - begin);
+		if (name == "title") {
+			result.title = true;
+		} else if (name == "paragraphs") {
+			result.paragraphs = true;
+		} else if (name == "char_location") {
+			result.char_location = true;
+		} else if (name == "topN") {
+			result.topn = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 字的位置和候选都不需要时不输出char_info
+static bool need_char_info(bool details, const ResultFields &fields) {
+	return details && (fields.char_location || fields.topn);
+}
+
+void parse_char_info(Json::Value &infos, Json::Value &input, std::string section, int scale,
+		const ResultFields &fields) {
+	for (Json::ArrayIndex i = 0; i < input["char_pos"].size(); ++i) {
+		Json::Value result;
+		if (fields.char_location) {
+			Value pos;
+			pos["x"] = scale_coord(input["char_pos"][i][0], scale);
+			pos["y"] = scale_coord(input["char_pos"][i][1], scale);
+			result["char_location"].append(pos);
+
+			for (auto &loc : input["char_box"][i]) {
+				Value ploc;
+				ploc["x"] = scale_coord(loc[0], scale);
+				ploc["y"] = scale_coord(loc[1], scale);
+				result["char_location"].append(ploc);
+			}
+		}
+
+		if (fields.topn) {
+			for (auto &top : input["char_arr"][i]) {
+				Json::Value info;
+				info["char_ocr_result"] = top[0];
+				info["char_confidence"] = top[1];
+				result[section].append(info);
+			}
+		}
+
+		infos.append(result);
+	}
+}
+
+void parse_title_info(Json::Value &result, Json::Value &input, bool details, int scale,
+		const ResultFields &fields) {
+	if (input.size() == 0) {
+		return;
+	}
+
+	Json::Value val = input;
+	if (!val.isMember("text")) {
+		return;
+	}
+
+	if (val["text"].isNull())
+		return;
+
+	if (val["text"].asString().size() == 0)
+		return;
+	result["title_ocr_result"] = val["text"];
+	if (!need_char_info(details, fields)) {
+		return;
+	}
+	parse_char_info(result["title_char_info"], val, "char_ocr_topn", scale, fields);
+}
+
+void parse_eassy_info(Json::Value &result, Json::Value &input, bool details, int scale,
+		const ResultFields &fields) {
+	if (input.size() == 0) {
+		return;
+	}
+
+	for (auto &eaasy : input) {
+		Json::Value lines;
+		bool flag = false;
+		for (auto &line : eaasy) {
+			Json::Value info;
+			if (line["text"].isNull())
+				continue;
+
+			if (line["text"].asString().size() == 0)
+				continue;
+			flag = true;
+			info["line_ocr_result"] = line["text"];
+			if (need_char_info(details, fields)) {
+				parse_char_info(info["line_char_info"], line, "line_char_topn", scale, fields);
+			}
+			lines.append(info);
+		}
+		if (flag)
+			result["para_ocr_result"].append(lines);
+	}
+}
+
+bool parse_result(std::string &requestid, std::string &str, Json::Value &result, bool details, bool prcision,
+		int scale, const ResultFields &fields) {
+	if (str.size() == 0) {
+		return true;
+	}
+
+	try {
+		Json::Reader reader;
+		Json::Value root;
+		std::string title = "title_info";
+		std::string essay = "essay_info";
+
+		if (!reader.parse(str, root)) {
+			LOG(INFO) << requestid << " reader json parse error.";
+			return false;
+		}
+		if (prcision) {
+			title = "title_info_sec";
+			essay = "essay_info_sec";
+		}
+
+		if (fields.title && root.isMember("title")) {
+			parse_title_info(result[title], root["title"], details, scale, fields);
+		}
+		if (fields.paragraphs && root.isMember("texts")) {
+			parse_eassy_info(result[essay], root["texts"], details, scale, fields);
+		}
+	} catch(exception &e) {
+		LOG(INFO) << requestid << "parse json err " << e.what();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * 以下是write_result：按parse_*的规则直接从JsonIndex输出，每个函数与对应的parse_*一一对应
+ * 返回false表示模型输出的格式与预期不符(例如parse_*中会抛异常的情况)，由调用方回退到parse_result
+ */
+
+static Metrics::Counter *g_write_fallback = Metrics::GetCounter("result_writer_fallback_total");
+
+// 标量原样输出：字符串、数字、true/false/null
+static bool write_scalar(ResponseWriter &writer, const JsonIndex &doc, uint32_t node, std::string &scratch) {
+	if (doc.TypeOf(node) == JsonIndex::STRING_VALUE) {
+		base::StringPiece value;
+		if (!doc.StringValue(node, scratch, value)) {
+			return false;
+		}
+		writer.String(value);
+		return true;
+	}
+	Json::Value value;
+	if (!doc.ScalarValue(node, value)) {
+		return false;
+	}
+	writer.Value(value);
+	return true;
+}
+
+// 坐标点[x, y]输出为{"x":x,"y":y}
+static bool write_point(ResponseWriter &writer, const JsonIndex &doc, uint32_t point, int scale) {
+	if (doc.TypeOf(point) != JsonIndex::ARRAY_VALUE || doc.Size(point) < 2) {
+		return false;
+	}
+	uint32_t x = doc.Child(point);
+	uint32_t y = doc.Next(x);
+	Json::Value x_val, y_val;
+	if (!doc.ScalarValue(x, x_val) || !doc.ScalarValue(y, y_val)) {
+		return false;
+	}
+	writer.StartObject(2);
+	writer.Key("x");
+	writer.Value(scale_coord(x_val, scale));
+	writer.Key("y");
+	writer.Value(scale_coord(y_val, scale));
+	writer.EndObject();
+	return true;
+}
+
+// parse_char_info中按下标取值的数组：不存在、null、数组
+static bool indexable(const JsonIndex &doc, uint32_t node) {
+	return node == JsonIndex::kNone || doc.TypeOf(node) == JsonIndex::NULL_VALUE ||
+			doc.TypeOf(node) == JsonIndex::ARRAY_VALUE;
+}
+
+// 被遍历的值中的元素个数：数组的元素，其他标量没有元素；非空对象不支持
+static bool iterable_size(const JsonIndex &doc, uint32_t node, uint32_t &size) {
+	size = 0;
+	if (node == JsonIndex::kNone) {
+		return true;
+	}
+	if (doc.TypeOf(node) == JsonIndex::OBJECT_VALUE) {
+		return doc.Size(node) == 0;
+	}
+	if (doc.TypeOf(node) == JsonIndex::ARRAY_VALUE) {
+		size = doc.Size(node);
+	}
+	return true;
+}
+
+static uint32_t next_or_none(const JsonIndex &doc, uint32_t node) {
+	return node == JsonIndex::kNone ? JsonIndex::kNone : doc.Next(node);
+}
+
+static bool write_char_info(ResponseWriter &writer, const JsonIndex &doc, uint32_t input, const char *section,
+		int scale, const ResultFields &fields, std::string &scratch) {
+	uint32_t char_pos = doc.Find(input, "char_pos");
+	if (char_pos == JsonIndex::kNone || doc.Size(char_pos) == 0) {
+		writer.Null();
+		return true;
+	}
+	// 不需要的部分不检查也不输出，与parse_char_info一样不访问
+	uint32_t char_box = fields.char_location ? doc.Find(input, "char_box") : JsonIndex::kNone;
+	uint32_t char_arr = fields.topn ? doc.Find(input, "char_arr") : JsonIndex::kNone;
+	if (doc.TypeOf(char_pos) != JsonIndex::ARRAY_VALUE || !indexable(doc, char_box) || !indexable(doc, char_arr)) {
+		return false;
+	}
+
+	auto first_child = [&doc](uint32_t node) {
+		return node == JsonIndex::kNone || doc.TypeOf(node) != JsonIndex::ARRAY_VALUE ?
+				JsonIndex::kNone : doc.Child(node);
+	};
+	uint32_t box = first_child(char_box);
+	uint32_t arr = first_child(char_arr);
+	writer.StartArray(doc.Size(char_pos));
+	for (uint32_t pos = doc.Child(char_pos); pos != JsonIndex::kNone; pos = doc.Next(pos)) {
+		uint32_t box_size = 0, arr_size = 0;
+		if (!iterable_size(doc, box, box_size) || !iterable_size(doc, arr, arr_size)) {
+			return false;
+		}
+
+		// 两部分都没有时parse_char_info追加的是null
+		uint32_t members = (fields.char_location ? 1 : 0) + (arr_size > 0 ? 1 : 0);
+		if (members == 0) {
+			writer.Null();
+			box = next_or_none(doc, box);
+			arr = next_or_none(doc, arr);
+			continue;
+		}
+		writer.StartObject(members);
+		if (fields.char_location) {
+			writer.Key("char_location");
+			writer.StartArray(1 + box_size);
+			if (!write_point(writer, doc, pos, scale)) {
+				return false;
+			}
+			for (uint32_t loc = box_size > 0 ? doc.Child(box) : JsonIndex::kNone; loc != JsonIndex::kNone;
+					loc = doc.Next(loc)) {
+				if (!write_point(writer, doc, loc, scale)) {
+					return false;
+				}
+			}
+			writer.EndArray();
+		}
+
+		if (arr_size > 0) {
+			writer.Key(section);
+			writer.StartArray(arr_size);
+			for (uint32_t top = doc.Child(arr); top != JsonIndex::kNone; top = doc.Next(top)) {
+				if (doc.TypeOf(top) != JsonIndex::ARRAY_VALUE || doc.Size(top) < 2) {
+					return false;
+				}
+				uint32_t ocr_result = doc.Child(top);
+				writer.StartObject(2);
+				writer.Key("char_confidence");
+				if (!write_scalar(writer, doc, doc.Next(ocr_result), scratch)) {
+					return false;
+				}
+				writer.Key("char_ocr_result");
+				if (!write_scalar(writer, doc, ocr_result, scratch)) {
+					return false;
+				}
+				writer.EndObject();
+			}
+			writer.EndArray();
+		}
+		writer.EndObject();
+
+		box = next_or_none(doc, box);
+		arr = next_or_none(doc, arr);
+	}
+	writer.EndArray();
+	return true;
+}
+
+// 行/标题的文本：0表示跳过(不存在、null、空字符串)，1表示有文本，-1表示格式不支持
+static int text_state(const JsonIndex &doc, uint32_t input, uint32_t &text) {
+	text = doc.Find(input, "text");
+	if (text == JsonIndex::kNone || doc.TypeOf(text) == JsonIndex::NULL_VALUE) {
+		return 0;
+	}
+	if (doc.TypeOf(text) != JsonIndex::STRING_VALUE) {
+		return -1;
+	}
+	return doc.Get(text).end > doc.Get(text).begin ? 1 : 0;
+}
+
+static bool write_title_info(ResponseWriter &writer, const JsonIndex &doc, uint32_t input, bool details, int scale,
+		const ResultFields &fields, std::string &scratch) {
+	if (doc.Size(input) == 0) {
+		writer.Null();
+		return true;
+	}
+	if (doc.TypeOf(input) != JsonIndex::OBJECT_VALUE) {
+		return false;
+	}
+	uint32_t text = JsonIndex::kNone;
+	int state = text_state(doc, input, text);
+	if (state < 0) {
+		return false;
+	}
+	if (state == 0) {
+		writer.Null();
+		return true;
+	}
+
+	bool char_info = need_char_info(details, fields);
+	writer.StartObject(char_info ? 2 : 1);
+	if (char_info) {
+		writer.Key("title_char_info");
+		if (!write_char_info(writer, doc, input, "char_ocr_topn", scale, fields, scratch)) {
+			return false;
+		}
+	}
+	writer.Key("title_ocr_result");
+	if (!write_scalar(writer, doc, text, scratch)) {
+		return false;
+	}
+	writer.EndObject();
+	return true;
+}
+
+static bool write_eassy_info(ResponseWriter &writer, const JsonIndex &doc, uint32_t input, bool details,
+		int scale, const ResultFields &fields, std::string &scratch) {
+	if (doc.Size(input) == 0) {
+		writer.Null();
+		return true;
+	}
+	if (doc.TypeOf(input) != JsonIndex::ARRAY_VALUE) {
+		return false;
+	}
+
+	// 先检查格式并统计每段有文本的行数，没有文本的段落不输出
+	std::vector<uint32_t> line_counts;
+	uint32_t paras = 0;
+	for (uint32_t eaasy = doc.Child(input); eaasy != JsonIndex::kNone; eaasy = doc.Next(eaasy)) {
+		uint32_t size = 0, count = 0;
+		if (!iterable_size(doc, eaasy, size)) {
+			return false;
+		}
+		for (uint32_t line = size > 0 ? doc.Child(eaasy) : JsonIndex::kNone; line != JsonIndex::kNone;
+				line = doc.Next(line)) {
+			if (doc.TypeOf(line) == JsonIndex::NULL_VALUE) {
+				continue;
+			}
+			if (doc.TypeOf(line) != JsonIndex::OBJECT_VALUE) {
+				return false;
+			}
+			uint32_t text = JsonIndex::kNone;
+			int state = text_state(doc, line, text);
+			if (state < 0) {
+				return false;
+			}
+			count += state;
+		}
+		line_counts.push_back(count);
+		paras += count > 0 ? 1 : 0;
+	}
+	if (paras == 0) {
+		writer.Null();
+		return true;
+	}
+
+	bool char_info = need_char_info(details, fields);
+	writer.StartObject(1);
+	writer.Key("para_ocr_result");
+	writer.StartArray(paras);
+	size_t k = 0;
+	for (uint32_t eaasy = doc.Child(input); eaasy != JsonIndex::kNone; eaasy = doc.Next(eaasy), ++k) {
+		if (line_counts[k] == 0) {
+			continue;
+		}
+		writer.StartArray(line_counts[k]);
+		for (uint32_t line = doc.Child(eaasy); line != JsonIndex::kNone; line = doc.Next(line)) {
+			uint32_t text = JsonIndex::kNone;
+			if (doc.TypeOf(line) == JsonIndex::NULL_VALUE || text_state(doc, line, text) == 0) {
+				continue;
+			}
+			writer.StartObject(char_info ? 2 : 1);
+			if (char_info) {
+				writer.Key("line_char_info");
+				if (!write_char_info(writer, doc, line, "line_char_topn", scale, fields, scratch)) {
+					return false;
+				}
+			}
+			writer.Key("line_ocr_result");
+			if (!write_scalar(writer, doc, text, scratch)) {
+				return false;
+			}
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+	writer.EndArray();
+	writer.EndObject();
+	return true;
+}
+
+// 一次模型输出写入sections(key为title_info等，值为编码好的片段)
+static bool write_sections(const std::string &str, bool details, bool prcision, int scale, ResponseFormat format,
+		const ResultFields &fields, std::map<std::string, std::string> &sections) {
+	if (str.size() == 0) {
+		return true;
+	}
+
+	// 每个线程复用索引和解码缓冲区的内存
+	static thread_local JsonIndex doc;
+	static thread_local std::string scratch;
+	if (!doc.Parse(str) || doc.TypeOf(doc.Root()) != JsonIndex::OBJECT_VALUE) {
+		return false;
+	}
+
+	uint32_t title = fields.title ? doc.Find(doc.Root(), "title") : JsonIndex::kNone;
+	if (title != JsonIndex::kNone) {
+		std::string &out = sections[prcision ? "title_info_sec" : "title_info"];
+		auto writer = ResponseWriter::Create(format, out);
+		if (!write_title_info(*writer, doc, title, details, scale, fields, scratch)) {
+			return false;
+		}
+	}
+	uint32_t texts = fields.paragraphs ? doc.Find(doc.Root(), "texts") : JsonIndex::kNone;
+	if (texts != JsonIndex::kNone) {
+		std::string &out = sections[prcision ? "essay_info_sec" : "essay_info"];
+		auto writer = ResponseWriter::Create(format, out);
+		if (!write_eassy_info(*writer, doc, texts, details, scale, fields, scratch)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool write_result(std::string &requestid, std::string &old_result, std::string &new_result, bool details,
+		bool prcision, int scale, ResponseFormat format, std::string &data, const ResultFields &fields) {
+	data.clear();
+	auto writer = ResponseWriter::Create(format, data);
+
+	std::map<std::string, std::string> sections;
+	bool written = false;
+	try {
+		written = write_sections(old_result, details, false, scale, format, fields, sections) &&
+				(!prcision || write_sections(new_result, details, true, scale, format, fields, sections));
+	} catch (exception &e) {
+		LOG(INFO) << requestid << " write result err " << e.what();
+	}
+	if (written) {
+		if (sections.empty()) {
+			writer->Null();
+			return true;
+		}
+		// std::map按key排序，与Json::Value的序列化顺序一致
+		writer->StartObject(sections.size());
+		for (const auto &section : sections) {
+			writer->Key(section.first);
+			writer->Raw(section.second);
+		}
+		writer->EndObject();
+		return true;
+	}
+
+	g_write_fallback->Add();
+	Json::Value result;
+	if (!parse_result(requestid, old_result, result, details, false, scale, fields)) {
+		return false;
+	}
+	if (prcision && !parse_result(requestid, new_result, result, details, true, scale, fields)) {
+		return false;
+	}
+	writer->Value(result);
+	return true;
+}
@@ -0,0 +1,39 @@
+/*
+ * composion_result.hpp
+ *
+ *  Created on: 2026年10月16日
+ */
+
+#ifndef IMAGE_SRC_AI_MODEL_COMPOSION_RESULT_HPP_
+#define IMAGE_SRC_AI_MODEL_COMPOSION_RESULT_HPP_
+
+#include <string>
+#include <json/json.h>
+#include "response_writer.h"
+
+/// 请求参数fields：只返回指定的部分，没有指定的部分不解析、不输出
+/// title/paragraphs对应title_info/essay_info，char_location/topn对应details中每个字的位置和候选
+struct ResultFields {
+	bool title = true;
+	bool paragraphs = true;
+	bool char_location = true;
+	bool topn = true;
+
+	/// fields为逗号分隔的字符串或字符串数组，有未知的名字时返回false
+	static bool Parse(const Json::Value &fields, ResultFields &result);
+};
+
+/// 识别模型输出的JSON转换为接口返回的data：先解析为Json::Value，再逐个取值构建新的Json::Value
+/// @param prcision 为true时写入title_info_sec/essay_info_sec
+/// @param scale 原图与识别图片的比例，坐标乘以此比例
+bool parse_result(std::string &requestid, std::string &str, Json::Value &result, bool details, bool prcision,
+		int scale, const ResultFields &fields = ResultFields());
+
+/// 与parse_result的结果一致，但只扫描一遍模型输出，直接写出data的字节(不构建Json::Value)
+/// 模型输出的格式与预期不符时回退到parse_result，保证结果一致
+/// @param data 编码好的data(与format对应)，没有识别结果时为null
+bool write_result(std::string &requestid, std::string &old_result, std::string &new_result, bool details,
+		bool prcision, int scale, ResponseFormat format, std::string &data,
+		const ResultFields &fields = ResultFields());
+
+#endif /* IMAGE_SRC_AI_MODEL_COMPOSION_RESULT_HPP_ */
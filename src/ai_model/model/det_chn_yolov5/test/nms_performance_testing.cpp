@@ -0,0 +1,103 @@
+#include "yolov5_post.hpp"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * 构造稠密anchor的yolov5输出：640x640输入共25200个anchor，
+ * 围绕若干个目标区域生成大量高置信度、相互重叠的候选框
+ */
+static void make_dense_pred(int num_anchors, int num_classes, int num_targets, float dense_ratio,
+		unsigned seed, std::vector<float> &pred) {
+	const int stride = 5 + num_classes;
+	pred.assign((size_t)num_anchors * stride, 0.0f);
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	std::normal_distribution<float> jitter(0.0f, 6.0f);
+
+	std::vector<std::vector<float>> targets;
+	for (int t = 0; t < num_targets; ++t) {
+		float w = 60.0f + uni(rng) * 300.0f;
+		float h = 60.0f + uni(rng) * 300.0f;
+		targets.push_back({w / 2 + uni(rng) * (640.0f - w), h / 2 + uni(rng) * (640.0f - h), w, h});
+	}
+
+	for (int i = 0; i < num_anchors; ++i) {
+		float *p = &pred[(size_t)i * stride];
+		const auto &t = targets[i % num_targets];
+		p[0] = t[0] + jitter(rng);
+		p[1] = t[1] + jitter(rng);
+		p[2] = std::max(4.0f, t[2] + jitter(rng));
+		p[3] = std::max(4.0f, t[3] + jitter(rng));
+		p[4] = uni(rng) < dense_ratio ? 0.3f + 0.7f * uni(rng) : 0.1f * uni(rng);
+		for (int c = 0; c < num_classes; ++c) {
+			p[5 + c] = uni(rng);
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const int num_anchors = argc > 1 ? std::stoi(argv[1]) : 25200;
+	const float dense_ratio = argc > 2 ? std::stof(argv[2]) : 0.2f;
+	const int num_classes = argc > 3 ? std::stoi(argv[3]) : 1;
+	const int repeat_count = argc > 4 ? std::stoi(argv[4]) : 50;
+
+	yolov5::PostParam param;
+	param.num_classes = num_classes;
+	param.conf_thresh = 0.25f;
+	param.iou_thresh = 0.45f;
+	param.scale = 0.3125f;		// 2048 -> 640
+	param.img_w = 2048;
+	param.img_h = 2048;
+
+	std::vector<float> pred;
+	make_dense_pred(num_anchors, num_classes, 16, dense_ratio, 1234, pred);
+
+	yolov5::BoxSoA boxes;
+	yolov5::decode(pred.data(), num_anchors, param, boxes);
+	std::cout << "anchors: " << num_anchors << ", candidates: " << boxes.size() << std::endl;
+
+	std::vector<int> keep_scalar;
+	std::vector<int> keep_simd;
+	std::vector<double> cost_scalar;
+	std::vector<double> cost_simd;
+	std::vector<double> cost_decode;
+	for (int i = 0; i < repeat_count; ++i) {
+		auto t0 = std::chrono::steady_clock::now();
+		yolov5::decode(pred.data(), num_anchors, param, boxes);
+		auto t1 = std::chrono::steady_clock::now();
+		yolov5::nms_scalar(boxes, param, keep_scalar);
+		auto t2 = std::chrono::steady_clock::now();
+		yolov5::nms(boxes, param, keep_simd);
+		auto t3 = std::chrono::steady_clock::now();
+		cost_decode.emplace_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+		cost_scalar.emplace_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+		cost_simd.emplace_back(std::chrono::duration<double, std::milli>(t3 - t2).count());
+		if (keep_scalar != keep_simd) {
+			std::cerr << "simd nms result mismatch: " << keep_scalar.size()
+					<< " vs " << keep_simd.size() << std::endl;
+			return -1;
+		}
+	}
+	std::cout << "keep: " << keep_simd.size() << std::endl;
+
+	auto report = [](const std::string &name, std::vector<double> &cost) {
+		std::sort(cost.begin(), cost.end());
+		double sum = 0.0;
+		for (auto c : cost) {
+			sum += c;
+		}
+		std::cout << name << " average time: " << sum / cost.size() << " ms"
+				<< ", p90 time: " << cost[(int)(0.9 * cost.size())]
+				<< ", max time: " << cost[cost.size() - 1] << std::endl;
+	};
+	report("decode", cost_decode);
+	report("nms scalar", cost_scalar);
+	report("nms simd", cost_simd);
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include "det_chn_yolov5.hpp"
+#include "yolov5_post.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+
+using namespace facethink;
+using namespace std;
+
+/*
+ * yolov5::postprocess与DetChnYolo::detection的逐框比对
+ * sdk不输出模型的原始结果，这里用OpenCV dnn在CPU上跑同一个模型导出的onnx(area_chs.onnx)，
+ * 按yolov5的letterbox预处理，原始输出交给yolov5::postprocess；sdk跑TensorRT引擎
+ * 1.格式：sdk的每个框至少BOX_FIELDS个字段，x1<=x2、y1<=y2、score在[0,1]、cls为整数
+ * 2.结果：框数相同，按IoU一一匹配，坐标、score、cls在容差内一致(引擎为fp16，不要求逐位相同)
+ */
+
+static std::vector<std::string> get_file_path(const std::string &folder_path) {
+	namespace fs = boost::filesystem;
+	std::vector<std::string> file_paths;
+	for (fs::directory_iterator dir(folder_path), end; dir != end; ++dir) {
+		file_paths.push_back(dir->path().string());
+	}
+	std::sort(file_paths.begin(), file_paths.end());
+	return file_paths;
+}
+
+static float iou(const std::vector<float> &a, const std::vector<float> &b) {
+	float w = std::min(a[yolov5::BOX_X2], b[yolov5::BOX_X2]) - std::max(a[yolov5::BOX_X1], b[yolov5::BOX_X1]);
+	float h = std::min(a[yolov5::BOX_Y2], b[yolov5::BOX_Y2]) - std::max(a[yolov5::BOX_Y1], b[yolov5::BOX_Y1]);
+	if (w <= 0.0f || h <= 0.0f) {
+		return 0.0f;
+	}
+	float inter = w * h;
+	float area_a = (a[yolov5::BOX_X2] - a[yolov5::BOX_X1]) * (a[yolov5::BOX_Y2] - a[yolov5::BOX_Y1]);
+	float area_b = (b[yolov5::BOX_X2] - b[yolov5::BOX_X1]) * (b[yolov5::BOX_Y2] - b[yolov5::BOX_Y1]);
+	return inter / (area_a + area_b - inter);
+}
+
+static bool check_layout(const std::vector<float> &box) {
+	return box.size() >= yolov5::BOX_FIELDS &&
+			box[yolov5::BOX_X1] <= box[yolov5::BOX_X2] && box[yolov5::BOX_Y1] <= box[yolov5::BOX_Y2] &&
+			box[yolov5::BOX_SCORE] >= 0.0f && box[yolov5::BOX_SCORE] <= 1.0f &&
+			box[yolov5::BOX_CLASS] == std::floor(box[yolov5::BOX_CLASS]);
+}
+
+// letterbox到input_size x input_size，跑onnx模型，输出为原图上的框
+static void cpu_detection(cv::dnn::Net &net, const cv::Mat &img, int input_size, float conf_thresh,
+		float iou_thresh, std::vector<std::vector<float>> &boxes) {
+	yolov5::PostParam param;
+	param.scale = std::min((float)input_size / img.cols, (float)input_size / img.rows);
+	int new_w = (int)std::round(img.cols * param.scale);
+	int new_h = (int)std::round(img.rows * param.scale);
+	param.pad_x = (input_size - new_w) / 2.0f;
+	param.pad_y = (input_size - new_h) / 2.0f;
+	param.img_w = img.cols;
+	param.img_h = img.rows;
+	param.conf_thresh = conf_thresh;
+	param.iou_thresh = iou_thresh;
+
+	cv::Mat resized, padded;
+	cv::resize(img, resized, cv::Size(new_w, new_h));
+	int top = (int)std::round(param.pad_y - 0.1f);
+	int left = (int)std::round(param.pad_x - 0.1f);
+	cv::copyMakeBorder(resized, padded, top, input_size - new_h - top, left, input_size - new_w - left,
+			cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114));
+	net.setInput(cv::dnn::blobFromImage(padded, 1.0 / 255.0, cv::Size(), cv::Scalar(), true, false));
+	cv::Mat out = net.forward();
+	// [1, num_anchors, 5+num_classes]
+	param.num_classes = out.size[2] - 5;
+	yolov5::postprocess(out.ptr<float>(), out.size[1], param, boxes);
+}
+
+// sdk的框逐个找IoU最大的cpu框，匹配不上或字段不一致都计为不一致
+static int compare(const std::string &name, const std::vector<std::vector<float>> &sdk,
+		const std::vector<std::vector<float>> &cpu, float box_iou, float score_diff) {
+	int failed = 0;
+	for (const auto &box : sdk) {
+		if (!check_layout(box)) {
+			std::cout << name << ": unexpected sdk box layout, fields: " << box.size() << std::endl;
+			return 1;
+		}
+	}
+	if (sdk.size() != cpu.size()) {
+		std::cout << name << ": box count sdk " << sdk.size() << " cpu " << cpu.size() << std::endl;
+		++failed;
+	}
+	std::vector<bool> used(cpu.size(), false);
+	for (const auto &box : sdk) {
+		int best = -1;
+		float best_iou = 0.0f;
+		for (size_t j = 0; j < cpu.size(); ++j) {
+			float v = used[j] ? 0.0f : iou(box, cpu[j]);
+			if (v > best_iou) {
+				best_iou = v;
+				best = (int)j;
+			}
+		}
+		if (best < 0 || best_iou < box_iou ||
+				std::fabs(box[yolov5::BOX_SCORE] - cpu[best][yolov5::BOX_SCORE]) > score_diff ||
+				box[yolov5::BOX_CLASS] != cpu[best][yolov5::BOX_CLASS]) {
+			std::cout << name << ": sdk box";
+			for (auto v : box) {
+				std::cout << " " << v;
+			}
+			std::cout << " unmatched, best iou " << best_iou << std::endl;
+			++failed;
+			continue;
+		}
+		used[best] = true;
+	}
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 5) {
+		std::cerr << "Usage: " << argv[0]
+				<< " engine_model config_file onnx_model image_folder [input_size] [conf_thresh] [iou_thresh]"
+				<< std::endl;
+		return 1;
+	}
+	const int input_size = argc > 5 ? std::stoi(argv[5]) : 640;
+	const float conf_thresh = argc > 6 ? std::stof(argv[6]) : 0.25f;
+	const float iou_thresh = argc > 7 ? std::stof(argv[7]) : 0.45f;
+
+	DetChnYolo *detector = DetChnYolo::create(argv[1], argv[2]);
+	if (detector == nullptr) {
+		std::cerr << "create DetChnYolo failed: " << argv[1] << ", " << argv[2] << std::endl;
+		return -1;
+	}
+	cv::dnn::Net net = cv::dnn::readNetFromONNX(argv[3]);
+	if (net.empty()) {
+		std::cerr << "read onnx failed: " << argv[3] << std::endl;
+		delete detector;
+		return -1;
+	}
+
+	int images = 0, failed_images = 0;
+	for (const auto &img_path : get_file_path(argv[4])) {
+		cv::Mat img = cv::imread(img_path);
+		if (img.empty()) {
+			continue;
+		}
+		std::vector<cv::Mat> input_imgs{img};
+		std::vector<std::vector<float>> sdk_boxes, cpu_boxes;
+		double predict_used = 0.0, post_used = 0.0;
+		if (detector->detection(input_imgs, sdk_boxes, predict_used, post_used) != 0) {
+			std::cerr << "sdk detection failed: " << img_path << std::endl;
+			++failed_images;
+			continue;
+		}
+		cpu_detection(net, img, input_size, conf_thresh, iou_thresh, cpu_boxes);
+		++images;
+		if (compare(img_path, sdk_boxes, cpu_boxes, 0.9f, 0.02f) != 0) {
+			++failed_images;
+		}
+	}
+	delete detector;
+
+	std::cout << "images: " << images << ", mismatch: " << failed_images << std::endl;
+	return images > 0 && failed_images == 0 ? 0 : 1;
+}
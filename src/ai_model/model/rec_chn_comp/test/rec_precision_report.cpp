@@ -0,0 +1,269 @@
+#include "rec_chn_comp.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iomanip>
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include <opencv2/opencv.hpp>
+
+using namespace facethink;
+using namespace std;
+
+/*
+ * 识别模型精度对比工具：基准模型(fp32)与候选模型(例如量化后的模型)分别跑带标注的样本集，
+ * 按标注计算字符准确率，输出精度报告(key=value)
+ * 报告中记录两个模型文件的大小和FNV-1a哈希，换了模型文件后旧报告不再对应
+ */
+
+static std::vector<std::string> get_file_path(const std::string &folder_path) {
+	namespace fs = boost::filesystem;
+	std::vector<std::string> file_paths;
+	for (fs::directory_iterator dir(folder_path), end; dir != end; ++dir) {
+		file_paths.push_back(dir->path().string());
+	}
+	std::sort(file_paths.begin(), file_paths.end());
+	return file_paths;
+}
+
+static std::string file_name(const std::string &path) {
+	return boost::filesystem::path(path).filename().string();
+}
+
+// 按出现顺序拼接识别结果中所有的text字段
+static void collect_text(const Json::Value &val, std::string &text) {
+	if (val.isObject()) {
+		if (val.isMember("text") && val["text"].isString()) {
+			text += val["text"].asString();
+		}
+		for (const auto &name : val.getMemberNames()) {
+			if (name != "text") {
+				collect_text(val[name], text);
+			}
+		}
+	} else if (val.isArray()) {
+		for (const auto &item : val) {
+			collect_text(item, text);
+		}
+	}
+}
+
+static std::u32string utf8_to_u32(const std::string &s) {
+	std::u32string out;
+	for (size_t i = 0; i < s.size();) {
+		unsigned char c = s[i];
+		int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 1;
+		char32_t cp = len == 1 ? c : c & (0xff >> (len + 1));
+		for (int k = 1; k < len && i + k < s.size(); ++k) {
+			cp = (cp << 6) | (s[i + k] & 0x3f);
+		}
+		out.push_back(cp);
+		i += len;
+	}
+	return out;
+}
+
+// 字符级编辑距离
+static size_t edit_distance(const std::u32string &a, const std::u32string &b) {
+	std::vector<size_t> prev(b.size() + 1), cur(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); ++j) {
+		prev[j] = j;
+	}
+	for (size_t i = 1; i <= a.size(); ++i) {
+		cur[0] = i;
+		for (size_t j = 1; j <= b.size(); ++j) {
+			size_t sub = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+			cur[j] = std::min(sub, std::min(prev[j], cur[j - 1]) + 1);
+		}
+		std::swap(prev, cur);
+	}
+	return prev[b.size()];
+}
+
+struct RecStat {
+	size_t chars = 0;		// 标注字符数
+	size_t errors = 0;		// 编辑距离之和
+	std::vector<double> cost;
+
+	double accuracy() const { return chars == 0 ? 0.0 : 1.0 - (double)errors / chars; }
+	double average() const {
+		double sum = 0.0;
+		for (auto c : cost) {
+			sum += c;
+		}
+		return cost.empty() ? 0.0 : sum / cost.size();
+	}
+};
+
+// 识别单张文本行图片，失败返回false
+static bool recognize(RecChnComp *rec, const cv::Mat &img, std::string &text, double &cost_ms) {
+	std::vector<cv::Mat> input_imgs{img};
+	std::vector<std::vector<float>> mgs;
+	std::vector<cv::Mat> title_poly;
+	std::vector<std::pair<int, cv::Mat>> text_poly{{0, cv::Mat()}};
+	std::string jsontxt;
+
+	auto time_start = std::chrono::steady_clock::now();
+	int ret = rec->detection(input_imgs, mgs, title_poly, text_poly, jsontxt, false);
+	cost_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_start).count();
+	if (ret < 0) {
+		return false;
+	}
+
+	Json::Value root;
+	Json::Reader reader;
+	if (!reader.parse(jsontxt, root)) {
+		return false;
+	}
+	text.clear();
+	collect_text(root, text);
+	return true;
+}
+
+// 标注文件格式：每行 "文件名\t文本"
+static std::map<std::string, std::string> load_labels(const std::string &label_file) {
+	std::map<std::string, std::string> labels;
+	std::ifstream ifs(label_file);
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		auto pos = line.find('\t');
+		if (pos != std::string::npos) {
+			labels[line.substr(0, pos)] = line.substr(pos + 1);
+		}
+	}
+	return labels;
+}
+
+// 模型文件的FNV-1a 64位哈希，十六进制
+static bool file_hash(const std::string &path, std::string &hash, size_t &size) {
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs.good()) {
+		return false;
+	}
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size = 0;
+	char buf[1 << 16];
+	while (ifs.read(buf, sizeof(buf)) || ifs.gcount() > 0) {
+		for (std::streamsize i = 0; i < ifs.gcount(); ++i) {
+			h = (h ^ (unsigned char)buf[i]) * 0x100000001b3ULL;
+		}
+		size += ifs.gcount();
+	}
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << h;
+	hash = ss.str();
+	return true;
+}
+
+static int run_report(RecChnComp *fp32, RecChnComp *candidate, const std::string &fp32_model,
+		const std::string &candidate_model, const std::string &images_folder, const std::string &label_file,
+		const std::string &report_file) {
+	std::string fp32_hash, candidate_hash;
+	size_t fp32_size = 0, candidate_size = 0;
+	if (!file_hash(fp32_model, fp32_hash, fp32_size) || !file_hash(candidate_model, candidate_hash, candidate_size)) {
+		std::cerr << "read model file failed: " << fp32_model << ", " << candidate_model << std::endl;
+		return -1;
+	}
+
+	auto labels = load_labels(label_file);
+	RecStat fp32_stat, candidate_stat;
+	size_t agree_chars = 0, agree_errors = 0;
+	int samples = 0;
+
+	for (const auto &img_path : get_file_path(images_folder)) {
+		auto it = labels.find(file_name(img_path));
+		if (it == labels.end()) {
+			continue;
+		}
+		cv::Mat img = cv::imread(img_path, 0);
+		if (img.empty()) {
+			continue;
+		}
+
+		std::string fp32_text, candidate_text;
+		double fp32_cost = 0.0, candidate_cost = 0.0;
+		if (!recognize(fp32, img, fp32_text, fp32_cost) || !recognize(candidate, img, candidate_text, candidate_cost)) {
+			std::cerr << "recognize failed: " << img_path << std::endl;
+			continue;
+		}
+
+		auto label = utf8_to_u32(it->second);
+		auto fp32_u32 = utf8_to_u32(fp32_text);
+		auto candidate_u32 = utf8_to_u32(candidate_text);
+		fp32_stat.chars += label.size();
+		fp32_stat.errors += edit_distance(fp32_u32, label);
+		fp32_stat.cost.push_back(fp32_cost);
+		candidate_stat.chars += label.size();
+		candidate_stat.errors += edit_distance(candidate_u32, label);
+		candidate_stat.cost.push_back(candidate_cost);
+		agree_chars += fp32_u32.size();
+		agree_errors += edit_distance(candidate_u32, fp32_u32);
+		++samples;
+	}
+	if (samples == 0) {
+		std::cerr << "no labeled samples in " << images_folder << std::endl;
+		return -1;
+	}
+
+	std::ostringstream report;
+	report << "fp32_model=" << file_name(fp32_model) << "\n"
+			<< "fp32_model_size=" << fp32_size << "\n"
+			<< "fp32_model_fnv1a64=" << fp32_hash << "\n"
+			<< "candidate_model=" << file_name(candidate_model) << "\n"
+			<< "candidate_model_size=" << candidate_size << "\n"
+			<< "candidate_model_fnv1a64=" << candidate_hash << "\n"
+			<< "samples=" << samples << "\n"
+			<< "fp32_char_accuracy=" << fp32_stat.accuracy() << "\n"
+			<< "candidate_char_accuracy=" << candidate_stat.accuracy() << "\n"
+			<< "candidate_agreement=" << (agree_chars == 0 ? 0.0 : 1.0 - (double)agree_errors / agree_chars) << "\n"
+			<< "char_accuracy_drop=" << fp32_stat.accuracy() - candidate_stat.accuracy() << "\n"
+			<< "fp32_avg_ms=" << fp32_stat.average() << "\n"
+			<< "candidate_avg_ms=" << candidate_stat.average() << "\n";
+	std::cout << report.str();
+
+	std::ofstream ofs(report_file);
+	if (!ofs.good()) {
+		std::cerr << "write report failed: " << report_file << std::endl;
+		return -1;
+	}
+	ofs << report.str();
+	return 0;
+}
+
+// 模型、配置或字典路径错误时create返回空指针
+static RecChnComp *create_rec(const std::string &model_file, const std::string &config_file,
+		const std::string &dict_file) {
+	RecChnComp *rec = RecChnComp::create(model_file, config_file, dict_file);
+	if (rec == nullptr) {
+		std::cerr << "create recognizer failed: " << model_file << ", " << config_file << ", " << dict_file
+				<< std::endl;
+	}
+	return rec;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 8) {
+		std::cerr << "Usage: " << argv[0]
+				<< " fp32_model candidate_model config_file dict_file image_folder label_file report_file" << std::endl;
+		return 1;
+	}
+	RecChnComp *fp32 = create_rec(argv[1], argv[3], argv[4]);
+	RecChnComp *candidate = fp32 ? create_rec(argv[2], argv[3], argv[4]) : nullptr;
+	int ret = -1;
+	if (fp32 != nullptr && candidate != nullptr) {
+		ret = run_report(fp32, candidate, argv[1], argv[2], argv[5], argv[6], argv[7]);
+	}
+	delete candidate;
+	delete fp32;
+	return ret;
+}
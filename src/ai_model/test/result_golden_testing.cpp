@@ -0,0 +1,240 @@
+#include "composion_result.hpp"
+#include "metrics.h"
+#include <json/json.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+
+using namespace std;
+
+/*
+ * write_result与parse_result + Json::FastWriter的一致性测试：
+ * 1.固定的边界用例(缺少char_pos、text为空/null、重复的key、char_box比char_pos短等)
+ * 2.随机生成的模型输出(中文、转义字符、整数/小数/大数、scale、details、prcision、fields)
+ * 两条路径的输出必须逐字节相同；CBOR/MessagePack的输出转换为JSON后也必须相同
+ */
+
+static std::mt19937 rng(20261016);
+
+static std::string legacy(std::string old_result, std::string new_result, bool details, bool prcision, int scale,
+		const ResultFields &fields, bool &ok) {
+	std::string requestid = "golden";
+	Json::Value result;
+	ok = parse_result(requestid, old_result, result, details, false, scale, fields) &&
+			(!prcision || parse_result(requestid, new_result, result, details, true, scale, fields));
+	Json::FastWriter writer;
+	std::string data = writer.write(result);
+	data.pop_back();
+	return data;
+}
+
+static int check(const std::string &name, std::string old_result, std::string new_result, bool details,
+		bool prcision, int scale, const std::string &mask, const ResultFields &fields) {
+	bool expect_ok = false;
+	std::string expect = legacy(old_result, new_result, details, prcision, scale, fields, expect_ok);
+	std::string requestid = "golden";
+	std::string data;
+	bool ok = write_result(requestid, old_result, new_result, details, prcision, scale, ResponseFormat::JSON, data,
+			fields);
+	if (ok != expect_ok || (ok && data != expect)) {
+		std::cout << "mismatch: " << name << " details=" << details << " prcision=" << prcision
+				<< " scale=" << scale << " fields=" << mask << std::endl
+				<< "  input:  " << old_result << std::endl
+				<< "  expect: " << expect_ok << " " << expect << std::endl
+				<< "  actual: " << ok << " " << data << std::endl;
+		return 1;
+	}
+	for (auto format : {ResponseFormat::CBOR, ResponseFormat::MSGPACK}) {
+		std::string binary, json;
+		ok = write_result(requestid, old_result, new_result, details, prcision, scale, format, binary, fields);
+		if (ok != expect_ok || (ok && (!ResponseWriter::ToJson(format, binary, json) || json != expect + "\n"))) {
+			std::cout << "mismatch: " << name << " format=" << ResponseWriter::ContentType(format)
+					<< " details=" << details << " prcision=" << prcision << " scale=" << scale
+					<< " fields=" << mask << std::endl
+					<< "  input:  " << old_result << std::endl
+					<< "  expect: " << expect_ok << " " << expect << std::endl
+					<< "  actual: " << ok << " " << json << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// 空字符串为默认(全部返回)
+static const std::vector<std::string> kFields = {
+	"", "title", "paragraphs", "title,paragraphs,char_location", "paragraphs, topN", "title,topN", "char_location"
+};
+
+static int check_all(const std::string &name, const std::string &old_result, const std::string &new_result) {
+	int failed = 0;
+	for (const auto &mask : kFields) {
+		ResultFields fields;
+		if (!mask.empty() && !ResultFields::Parse(Json::Value(mask), fields)) {
+			std::cout << "parse fields failed: " << mask << std::endl;
+			return 1;
+		}
+		for (int scale : {1, 2}) {
+			for (bool details : {false, true}) {
+				for (bool prcision : {false, true}) {
+					failed += check(name, old_result, new_result, details, prcision, scale, mask, fields);
+				}
+			}
+		}
+	}
+	return failed;
+}
+
+static int check_parse_fields() {
+	int failed = 0;
+	ResultFields fields;
+	Json::Value names(Json::arrayValue);
+	names.append("title");
+	names.append("topN");
+	if (!ResultFields::Parse(names, fields) || !fields.title || fields.paragraphs || fields.char_location ||
+			!fields.topn) {
+		std::cout << "parse fields array failed" << std::endl;
+		++failed;
+	}
+	for (const auto &bad : {Json::Value("title,unknown"), Json::Value(1), Json::Value(true)}) {
+		if (ResultFields::Parse(bad, fields)) {
+			std::cout << "parse fields should fail: " << bad.toStyledString();
+			++failed;
+		}
+	}
+	return failed;
+}
+
+static const std::vector<std::string> kTexts = {
+	"", "春天来了", "a\"b\\c", "tab\tnew\nline", "\xe2\x80\xa8", "\\u4e2d", "mixed 中文 and ascii", "/</script>",
+	"\x01\x1f", "\xf0\x9f\x98\x80"
+};
+
+static std::string random_number() {
+	// 超出int64的整数乘以scale时回退到parse_result，少量生成
+	if (rng() % 500 == 0) {
+		return "12345678901234567890";
+	}
+	switch (rng() % 5) {
+	case 0:
+		return std::to_string(rng() % 5000);
+	case 1:
+		return "-" + std::to_string(rng() % 100);
+	case 2:
+		return std::to_string(rng() % 5000) + "." + std::to_string(rng() % 1000);
+	case 3:
+		return "1e" + std::to_string(rng() % 3);
+	default:
+		return "0.1234567890123456789";
+	}
+}
+
+static std::string random_text() {
+	std::string text = kTexts[rng() % kTexts.size()];
+	Json::FastWriter writer;
+	std::string quoted = writer.write(Json::Value(text));
+	quoted.pop_back();
+	return quoted;
+}
+
+static std::string random_point() {
+	return "[" + random_number() + "," + random_number() + "]";
+}
+
+static std::string random_line() {
+	int chars = rng() % 5;
+	std::stringstream ss;
+	ss << "{\"text\":" << (rng() % 8 == 0 ? "null" : random_text());
+	if (rng() % 6 != 0) {
+		ss << ",\"char_pos\":[";
+		for (int i = 0; i < chars; ++i) {
+			ss << (i ? "," : "") << random_point();
+		}
+		ss << "]";
+	}
+	ss << ",\"char_box\":[";
+	int boxes = rng() % 4 == 0 ? chars / 2 : chars;
+	for (int i = 0; i < boxes; ++i) {
+		ss << (i ? "," : "") << "[" << random_point() << "," << random_point() << "," << random_point() << "]";
+	}
+	ss << "],\"char_arr\":[";
+	for (int i = 0; i < chars; ++i) {
+		ss << (i ? "," : "") << "[";
+		int topn = rng() % 4;
+		for (int j = 0; j < topn; ++j) {
+			ss << (j ? "," : "") << "[" << random_text() << "," << random_number() << "]";
+		}
+		ss << "]";
+	}
+	ss << "]}";
+	return ss.str();
+}
+
+static std::string random_result() {
+	std::stringstream ss;
+	ss << "{";
+	bool first = true;
+	if (rng() % 5 != 0) {
+		ss << "\"title\":" << random_line();
+		first = false;
+	}
+	if (rng() % 5 != 0) {
+		ss << (first ? "" : ",") << "\"texts\":[";
+		int paras = rng() % 4;
+		for (int i = 0; i < paras; ++i) {
+			ss << (i ? "," : "") << "[";
+			int lines = rng() % 4;
+			for (int j = 0; j < lines; ++j) {
+				ss << (j ? "," : "") << random_line();
+			}
+			ss << "]";
+		}
+		ss << "]";
+	}
+	ss << "}";
+	return ss.str();
+}
+
+int main(int argc, char *argv[]) {
+	const int rounds = argc > 1 ? std::stoi(argv[1]) : 2000;
+	const std::string line = "{\"text\":\"字\",\"char_pos\":[[1,2]],\"char_box\":[[[0,0],[3,3]]],"
+			"\"char_arr\":[[[\"字\",0.9],[\"宇\",0.1]]]}";
+
+	std::vector<std::pair<std::string, std::string>> cases = {
+		{"empty", ""},
+		{"empty object", "{}"},
+		{"invalid json", "{\"title\":"},
+		{"title only", "{\"title\":" + line + "}"},
+		{"texts only", "{\"texts\":[[" + line + "]]}"},
+		{"null title", "{\"title\":null,\"texts\":null}"},
+		{"empty title", "{\"title\":{},\"texts\":[]}"},
+		{"empty text", "{\"title\":{\"text\":\"\"},\"texts\":[[{\"text\":\"\"}],[]]}"},
+		{"no char_pos", "{\"title\":{\"text\":\"a\"},\"texts\":[[{\"text\":\"b\"}]]}"},
+		{"empty topn", "{\"title\":{\"text\":\"a\",\"char_pos\":[[1,2]],\"char_arr\":[[]]}}"},
+		{"short char_box", "{\"title\":{\"text\":\"a\",\"char_pos\":[[1,2],[3,4]],\"char_box\":[[[1,1]]],"
+				"\"char_arr\":[[[\"a\",1]],[[\"b\",2]]]}}"},
+		{"duplicate key", "{\"title\":{\"text\":\"a\",\"text\":\"b\"},\"texts\":[],\"texts\":[[" + line + "]]}"},
+		{"number text", "{\"title\":{\"text\":1},\"texts\":[[{\"text\":true}]]}"},
+		{"string coord", "{\"title\":{\"text\":\"a\",\"char_pos\":[[\"1\",2]]}}"},
+		{"whitespace", " { \"texts\" : [ [ " + line + " , null ] ] } "},
+		{"unicode escape", "{\"title\":{\"text\":\"\\u4e2d\\u6587\\n\"}}"},
+		{"surrogate pair", "{\"title\":{\"text\":\"\\ud840\\udc0b\\uD83D\\uDE00\"}}"},
+		{"lone surrogate", "{\"title\":{\"text\":\"a\\udc0b\"},\"texts\":[[{\"text\":\"\\ud840\"}]]}"},
+		{"extra keys", "{\"id\":1,\"title\":" + line + ",\"score\":[1,2,3]}"},
+	};
+	int failed = check_parse_fields();
+	for (const auto &c : cases) {
+		failed += check_all(c.first, c.second, c.second);
+		failed += check_all(c.first + " with precision", "{\"texts\":[[" + line + "]]}",
+				c.second);
+	}
+	for (int i = 0; i < rounds; ++i) {
+		failed += check_all("random " + std::to_string(i), random_result(), random_result());
+	}
+
+	// 回退到parse_result的次数，随机用例应当大部分走单遍输出
+	std::cout << "cases: " << cases.size() * 2 + rounds << ", mismatch: " << failed
+			<< ", fallback: " << Metrics::GetCounter("result_writer_fallback_total")->Value() << std::endl;
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+#include "composion_result.hpp"
+#include <json/json.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+/*
+ * write_result与parse_result + Json::FastWriter的耗时对比
+ * 模型输出按一篇作文生成：paras段，每段lines行，每行chars个字，每个字topn个候选
+ */
+
+static std::string make_result(int paras, int lines, int chars, int topn) {
+	std::mt19937 rng(1234);
+	auto coord = [&rng]() { return std::to_string(rng() % 4000) + "." + std::to_string(rng() % 100); };
+	auto line = [&](std::stringstream &ss) {
+		ss << "{\"text\":\"";
+		for (int i = 0; i < chars; ++i) {
+			ss << "\\u" << std::hex << 0x4e00 + rng() % 0x5000 << std::dec;
+		}
+		ss << "\",\"char_pos\":[";
+		for (int i = 0; i < chars; ++i) {
+			ss << (i ? "," : "") << "[" << coord() << "," << coord() << "]";
+		}
+		ss << "],\"char_box\":[";
+		for (int i = 0; i < chars; ++i) {
+			ss << (i ? "," : "") << "[[" << coord() << "," << coord() << "],[" << coord() << "," << coord()
+					<< "],[" << coord() << "," << coord() << "],[" << coord() << "," << coord() << "]]";
+		}
+		ss << "],\"char_arr\":[";
+		for (int i = 0; i < chars; ++i) {
+			ss << (i ? "," : "") << "[";
+			for (int j = 0; j < topn; ++j) {
+				ss << (j ? "," : "") << "[\"\\u" << std::hex << 0x4e00 + rng() % 0x5000 << std::dec << "\","
+						<< (rng() % 10000) / 10000.0 << "]";
+			}
+			ss << "]";
+		}
+		ss << "]}";
+	};
+
+	std::stringstream ss;
+	ss << "{\"title\":";
+	line(ss);
+	ss << ",\"texts\":[";
+	for (int i = 0; i < paras; ++i) {
+		ss << (i ? "," : "") << "[";
+		for (int j = 0; j < lines; ++j) {
+			ss << (j ? "," : "");
+			line(ss);
+		}
+		ss << "]";
+	}
+	ss << "]}";
+	return ss.str();
+}
+
+int main(int argc, char *argv[]) {
+	const int loops = argc > 1 ? std::stoi(argv[1]) : 100;
+	const bool details = argc > 2 ? std::stoi(argv[2]) != 0 : true;
+	std::string requestid = "perf";
+	std::string old_result = make_result(6, 5, 20, 5);
+	std::string new_result = old_result;
+	std::cout << "model output: " << old_result.size() << " bytes, details: " << details << std::endl;
+
+	size_t legacy_size = 0, single_size = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < loops; ++i) {
+		Json::Value result;
+		parse_result(requestid, old_result, result, details, false, 1);
+		parse_result(requestid, new_result, result, details, true, 1);
+		Json::FastWriter writer;
+		legacy_size = writer.write(result).size() - 1;
+	}
+	double legacy_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::string data;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < loops; ++i) {
+		write_result(requestid, old_result, new_result, details, true, 1, ResponseFormat::JSON, data);
+		single_size = data.size();
+	}
+	double single_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "parse_result + FastWriter: " << legacy_ms / loops << " ms, " << legacy_size << " bytes" << std::endl;
+	std::cout << "write_result: " << single_ms / loops << " ms, " << single_size << " bytes" << std::endl;
+
+	for (auto format : {ResponseFormat::CBOR, ResponseFormat::MSGPACK}) {
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < loops; ++i) {
+			write_result(requestid, old_result, new_result, details, true, 1, format, data);
+		}
+		double binary_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "write_result(" << ResponseWriter::ContentType(format) << "): " << binary_ms / loops << " ms, "
+				<< data.size() << " bytes" << std::endl;
+	}
+	return 0;
+}
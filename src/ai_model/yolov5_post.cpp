@@ -0,0 +1,321 @@
+/*
+ * yolov5_post.cpp
+ *
+ *  主区域检测(yolov5)的CPU后处理：输出解码 + NMS
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <immintrin.h>
+#include "yolov5_post.hpp"
+
+namespace yolov5 {
+
+// 非agnostic时，不同类别的框按类别平移，保证不同类别之间不会相互抑制
+static const float kClassOffset = 8192.0f;
+
+void BoxSoA::clear() {
+	x1.clear();
+	y1.clear();
+	x2.clear();
+	y2.clear();
+	score.clear();
+	cls.clear();
+}
+
+void BoxSoA::reserve(size_t n) {
+	x1.reserve(n);
+	y1.reserve(n);
+	x2.reserve(n);
+	y2.reserve(n);
+	score.reserve(n);
+	cls.reserve(n);
+}
+
+void BoxSoA::resize(size_t n) {
+	x1.resize(n);
+	y1.resize(n);
+	x2.resize(n);
+	y2.resize(n);
+	score.resize(n);
+	cls.resize(n);
+}
+
+static bool cpu_has_avx() {
+	static const bool has_avx = __builtin_cpu_supports("avx");
+	return has_avx;
+}
+
+/*
+ * cx,cy,w,h(模型输入坐标) -> x1,y1,x2,y2(原图坐标)，原地转换
+ * 标量与向量版本的运算顺序一致，结果逐位相同
+ */
+static inline void convert_one(float *x1, float *y1, float *x2, float *y2, size_t i,
+		float inv_scale, float pad_x, float pad_y, float max_x, float max_y) {
+	float hw = x2[i] * 0.5f;
+	float hh = y2[i] * 0.5f;
+	float cx = x1[i] - pad_x;
+	float cy = y1[i] - pad_y;
+	x1[i] = std::min(std::max((cx - hw) * inv_scale, 0.0f), max_x);
+	y1[i] = std::min(std::max((cy - hh) * inv_scale, 0.0f), max_y);
+	x2[i] = std::min(std::max((cx + hw) * inv_scale, 0.0f), max_x);
+	y2[i] = std::min(std::max((cy + hh) * inv_scale, 0.0f), max_y);
+}
+
+__attribute__((target("avx")))
+static size_t convert_avx(float *x1, float *y1, float *x2, float *y2, size_t n,
+		float inv_scale, float pad_x, float pad_y, float max_x, float max_y) {
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 vs = _mm256_set1_ps(inv_scale);
+	const __m256 vpx = _mm256_set1_ps(pad_x);
+	const __m256 vpy = _mm256_set1_ps(pad_y);
+	const __m256 vmx = _mm256_set1_ps(max_x);
+	const __m256 vmy = _mm256_set1_ps(max_y);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 hw = _mm256_mul_ps(_mm256_loadu_ps(x2 + i), half);
+		__m256 hh = _mm256_mul_ps(_mm256_loadu_ps(y2 + i), half);
+		__m256 cx = _mm256_sub_ps(_mm256_loadu_ps(x1 + i), vpx);
+		__m256 cy = _mm256_sub_ps(_mm256_loadu_ps(y1 + i), vpy);
+		_mm256_storeu_ps(x1 + i, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(cx, hw), vs), zero), vmx));
+		_mm256_storeu_ps(y1 + i, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(cy, hh), vs), zero), vmy));
+		_mm256_storeu_ps(x2 + i, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_add_ps(cx, hw), vs), zero), vmx));
+		_mm256_storeu_ps(y2 + i, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_add_ps(cy, hh), vs), zero), vmy));
+	}
+	return i;
+}
+
+static size_t convert_sse(float *x1, float *y1, float *x2, float *y2, size_t n,
+		float inv_scale, float pad_x, float pad_y, float max_x, float max_y) {
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 vs = _mm_set1_ps(inv_scale);
+	const __m128 vpx = _mm_set1_ps(pad_x);
+	const __m128 vpy = _mm_set1_ps(pad_y);
+	const __m128 vmx = _mm_set1_ps(max_x);
+	const __m128 vmy = _mm_set1_ps(max_y);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 hw = _mm_mul_ps(_mm_loadu_ps(x2 + i), half);
+		__m128 hh = _mm_mul_ps(_mm_loadu_ps(y2 + i), half);
+		__m128 cx = _mm_sub_ps(_mm_loadu_ps(x1 + i), vpx);
+		__m128 cy = _mm_sub_ps(_mm_loadu_ps(y1 + i), vpy);
+		_mm_storeu_ps(x1 + i, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(cx, hw), vs), zero), vmx));
+		_mm_storeu_ps(y1 + i, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(cy, hh), vs), zero), vmy));
+		_mm_storeu_ps(x2 + i, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(cx, hw), vs), zero), vmx));
+		_mm_storeu_ps(y2 + i, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(cy, hh), vs), zero), vmy));
+	}
+	return i;
+}
+
+void decode(const float *pred, int num_anchors, const PostParam &param, BoxSoA &boxes) {
+	boxes.clear();
+	if (pred == nullptr || num_anchors <= 0 || param.num_classes <= 0) {
+		return;
+	}
+
+	// 1.过滤：绝大多数anchor的obj很低，先按obj剪枝，存活的框暂以cx,cy,w,h存入x1,y1,x2,y2
+	const int stride = 5 + param.num_classes;
+	for (int i = 0; i < num_anchors; ++i) {
+		const float *p = pred + (size_t)i * stride;
+		float obj = p[4];
+		if (obj < param.conf_thresh) {
+			continue;
+		}
+		int best = 0;
+		float best_conf = p[5];
+		for (int c = 1; c < param.num_classes; ++c) {
+			if (p[5 + c] > best_conf) {
+				best_conf = p[5 + c];
+				best = c;
+			}
+		}
+		float conf = obj * best_conf;
+		if (conf < param.conf_thresh) {
+			continue;
+		}
+		boxes.x1.push_back(p[0]);
+		boxes.y1.push_back(p[1]);
+		boxes.x2.push_back(p[2]);
+		boxes.y2.push_back(p[3]);
+		boxes.score.push_back(conf);
+		boxes.cls.push_back(best);
+	}
+
+	// 2.坐标转换：对连续存放的存活框做向量化处理
+	size_t n = boxes.size();
+	float inv_scale = param.scale > 0.0f ? 1.0f / param.scale : 1.0f;
+	float max_x = param.img_w > 0 ? (float)param.img_w : 1e9f;
+	float max_y = param.img_h > 0 ? (float)param.img_h : 1e9f;
+	float *x1 = boxes.x1.data();
+	float *y1 = boxes.y1.data();
+	float *x2 = boxes.x2.data();
+	float *y2 = boxes.y2.data();
+	size_t i = cpu_has_avx() ?
+			convert_avx(x1, y1, x2, y2, n, inv_scale, param.pad_x, param.pad_y, max_x, max_y) :
+			convert_sse(x1, y1, x2, y2, n, inv_scale, param.pad_x, param.pad_y, max_x, max_y);
+	for (; i < n; ++i) {
+		convert_one(x1, y1, x2, y2, i, inv_scale, param.pad_x, param.pad_y, max_x, max_y);
+	}
+}
+
+/*
+ * NMS的工作区：按score降序重排后的SoA，坐标已按类别平移
+ */
+struct NmsBuffer {
+	std::vector<int> order;
+	std::vector<float> x1;
+	std::vector<float> y1;
+	std::vector<float> x2;
+	std::vector<float> y2;
+	std::vector<float> area;
+	std::vector<int32_t> removed;	// 0：保留，-1：已被抑制
+};
+
+static void prepare(const BoxSoA &boxes, const PostParam &param, NmsBuffer &buf) {
+	size_t n = boxes.size();
+	buf.order.resize(n);
+	std::iota(buf.order.begin(), buf.order.end(), 0);
+	std::stable_sort(buf.order.begin(), buf.order.end(), [&boxes](int a, int b) {
+		return boxes.score[a] > boxes.score[b];
+	});
+
+	buf.x1.resize(n);
+	buf.y1.resize(n);
+	buf.x2.resize(n);
+	buf.y2.resize(n);
+	buf.area.resize(n);
+	buf.removed.assign(n, 0);
+	for (size_t k = 0; k < n; ++k) {
+		int i = buf.order[k];
+		float offset = param.agnostic ? 0.0f : boxes.cls[i] * kClassOffset;
+		buf.x1[k] = boxes.x1[i] + offset;
+		buf.y1[k] = boxes.y1[i] + offset;
+		buf.x2[k] = boxes.x2[i] + offset;
+		buf.y2[k] = boxes.y2[i] + offset;
+		buf.area[k] = (buf.x2[k] - buf.x1[k]) * (buf.y2[k] - buf.y1[k]);
+	}
+}
+
+// 第k个框与第j个框的IoU大于阈值时，抑制第j个框
+static inline void suppress_one(NmsBuffer &buf, size_t k, size_t j, float iou_thresh) {
+	float w = std::max(std::min(buf.x2[k], buf.x2[j]) - std::max(buf.x1[k], buf.x1[j]), 0.0f);
+	float h = std::max(std::min(buf.y2[k], buf.y2[j]) - std::max(buf.y1[k], buf.y1[j]), 0.0f);
+	float inter = w * h;
+	float iou = inter / (buf.area[k] + buf.area[j] - inter);
+	if (iou > iou_thresh) {
+		buf.removed[j] = -1;
+	}
+}
+
+// 用第k个框抑制[j, n)中IoU大于阈值的框，返回未处理的起始下标
+__attribute__((target("avx")))
+static size_t suppress_avx(NmsBuffer &buf, size_t k, size_t j, size_t n, float iou_thresh) {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 thresh = _mm256_set1_ps(iou_thresh);
+	const __m256 kx1 = _mm256_set1_ps(buf.x1[k]);
+	const __m256 ky1 = _mm256_set1_ps(buf.y1[k]);
+	const __m256 kx2 = _mm256_set1_ps(buf.x2[k]);
+	const __m256 ky2 = _mm256_set1_ps(buf.y2[k]);
+	const __m256 karea = _mm256_set1_ps(buf.area[k]);
+	float *removed = reinterpret_cast<float *>(buf.removed.data());
+	for (; j + 8 <= n; j += 8) {
+		__m256 w = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(kx2, _mm256_loadu_ps(&buf.x2[j])),
+				_mm256_max_ps(kx1, _mm256_loadu_ps(&buf.x1[j]))), zero);
+		__m256 h = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(ky2, _mm256_loadu_ps(&buf.y2[j])),
+				_mm256_max_ps(ky1, _mm256_loadu_ps(&buf.y1[j]))), zero);
+		__m256 inter = _mm256_mul_ps(w, h);
+		__m256 iou = _mm256_div_ps(inter,
+				_mm256_sub_ps(_mm256_add_ps(karea, _mm256_loadu_ps(&buf.area[j])), inter));
+		__m256 mask = _mm256_cmp_ps(iou, thresh, _CMP_GT_OQ);
+		_mm256_storeu_ps(removed + j, _mm256_or_ps(_mm256_loadu_ps(removed + j), mask));
+	}
+	return j;
+}
+
+static size_t suppress_sse(NmsBuffer &buf, size_t k, size_t j, size_t n, float iou_thresh) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 thresh = _mm_set1_ps(iou_thresh);
+	const __m128 kx1 = _mm_set1_ps(buf.x1[k]);
+	const __m128 ky1 = _mm_set1_ps(buf.y1[k]);
+	const __m128 kx2 = _mm_set1_ps(buf.x2[k]);
+	const __m128 ky2 = _mm_set1_ps(buf.y2[k]);
+	const __m128 karea = _mm_set1_ps(buf.area[k]);
+	float *removed = reinterpret_cast<float *>(buf.removed.data());
+	for (; j + 4 <= n; j += 4) {
+		__m128 w = _mm_max_ps(_mm_sub_ps(_mm_min_ps(kx2, _mm_loadu_ps(&buf.x2[j])),
+				_mm_max_ps(kx1, _mm_loadu_ps(&buf.x1[j]))), zero);
+		__m128 h = _mm_max_ps(_mm_sub_ps(_mm_min_ps(ky2, _mm_loadu_ps(&buf.y2[j])),
+				_mm_max_ps(ky1, _mm_loadu_ps(&buf.y1[j]))), zero);
+		__m128 inter = _mm_mul_ps(w, h);
+		__m128 iou = _mm_div_ps(inter,
+				_mm_sub_ps(_mm_add_ps(karea, _mm_loadu_ps(&buf.area[j])), inter));
+		__m128 mask = _mm_cmpgt_ps(iou, thresh);
+		_mm_storeu_ps(removed + j, _mm_or_ps(_mm_loadu_ps(removed + j), mask));
+	}
+	return j;
+}
+
+static void run_nms(const BoxSoA &boxes, const PostParam &param, std::vector<int> &keep, bool simd) {
+	keep.clear();
+	size_t n = boxes.size();
+	if (n == 0) {
+		return;
+	}
+
+	static thread_local NmsBuffer buf;
+	prepare(boxes, param, buf);
+
+	bool avx = cpu_has_avx();
+	size_t max_det = param.max_det > 0 ? (size_t)param.max_det : n;
+	for (size_t k = 0; k < n; ++k) {
+		if (buf.removed[k] != 0) {
+			continue;
+		}
+		keep.push_back(buf.order[k]);
+		if (keep.size() >= max_det) {
+			break;
+		}
+		size_t j = k + 1;
+		if (simd) {
+			j = avx ? suppress_avx(buf, k, j, n, param.iou_thresh) :
+					suppress_sse(buf, k, j, n, param.iou_thresh);
+		}
+		for (; j < n; ++j) {
+			suppress_one(buf, k, j, param.iou_thresh);
+		}
+	}
+}
+
+void nms(const BoxSoA &boxes, const PostParam &param, std::vector<int> &keep) {
+	run_nms(boxes, param, keep, true);
+}
+
+void nms_scalar(const BoxSoA &boxes, const PostParam &param, std::vector<int> &keep) {
+	run_nms(boxes, param, keep, false);
+}
+
+void postprocess(const float *pred, int num_anchors, const PostParam &param,
+		std::vector<std::vector<float>> &final_boxes) {
+	static thread_local BoxSoA boxes;
+	std::vector<int> keep;
+	decode(pred, num_anchors, param, boxes);
+	nms(boxes, param, keep);
+
+	final_boxes.clear();
+	final_boxes.reserve(keep.size());
+	for (auto i : keep) {
+		std::vector<float> box(BOX_FIELDS);
+		box[BOX_X1] = boxes.x1[i];
+		box[BOX_Y1] = boxes.y1[i];
+		box[BOX_X2] = boxes.x2[i];
+		box[BOX_Y2] = boxes.y2[i];
+		box[BOX_SCORE] = boxes.score[i];
+		box[BOX_CLASS] = (float)boxes.cls[i];
+		final_boxes.emplace_back(std::move(box));
+	}
+}
+
+}
@@ -0,0 +1,80 @@
+/*
+ * yolov5_post.hpp
+ *
+ *  主区域检测(yolov5)的CPU后处理：输出解码 + NMS
+ *  解码结果以SoA方式存放，IoU/NMS按AVX(8路)/SSE(4路)并行计算，运行时选择指令集
+ *  目前没有CPU后端使用，不编入服务，只在 model/det_chn_yolov5/test 的nms_performance_testing中编译
+ */
+
+#ifndef IMAGE_SRC_AI_MODEL_YOLOV5_POST_HPP_
+#define IMAGE_SRC_AI_MODEL_YOLOV5_POST_HPP_
+
+#include <vector>
+#include <cstddef>
+
+namespace yolov5 {
+
+struct PostParam {
+	int num_classes = 1;		// 类别数，模型每个anchor输出 5+num_classes 个值
+	float conf_thresh = 0.25f;	// obj * cls 置信度阈值
+	float iou_thresh = 0.45f;
+	int max_det = 300;
+	bool agnostic = false;		// true：不区分类别做NMS
+	// letterbox参数：模型输入坐标 -> 原图坐标 (x - pad_x) / scale
+	float scale = 1.0f;
+	float pad_x = 0.0f;
+	float pad_y = 0.0f;
+	// 原图尺寸，用于裁剪框
+	int img_w = 0;
+	int img_h = 0;
+};
+
+// 候选框，SoA布局：各字段连续存放，便于向量化
+struct BoxSoA {
+	std::vector<float> x1;
+	std::vector<float> y1;
+	std::vector<float> x2;
+	std::vector<float> y2;
+	std::vector<float> score;
+	std::vector<int> cls;
+
+	size_t size() const { return score.size(); }
+	void clear();
+	void reserve(size_t n);
+	void resize(size_t n);
+};
+
+/// 解码yolov5输出(已含grid/anchor解码，[num_anchors, 5+num_classes]，cx,cy,w,h,obj,cls...)
+/// 只保留 obj*cls >= conf_thresh 的框，坐标转换为原图上的 x1,y1,x2,y2
+void decode(const float *pred, int num_anchors, const PostParam &param, BoxSoA &boxes);
+
+/// 对boxes按score降序做NMS，keep返回保留框在boxes中的下标(按score降序)
+void nms(const BoxSoA &boxes, const PostParam &param, std::vector<int> &keep);
+
+/*
+ * final_boxes中每个框的字段顺序，与DetChnYolo::detection的输出一致：
+ * 1.DetChnComp::detection直接使用DetChnYolo输出的areas，而det_chn_comp的测试按 {x1,y1,x2,y2} 构造areas，
+ *   所以前4个字段是原图坐标 x1,y1,x2,y2
+ * 2.sdk的performance_testing读到r[5]，每个框共6个字段，后两个为 score、cls
+ * 与sdk输出的逐框比对见 model/det_chn_yolov5/test/yolov5_parity_testing
+ */
+enum BoxField {
+	BOX_X1 = 0,
+	BOX_Y1,
+	BOX_X2,
+	BOX_Y2,
+	BOX_SCORE,
+	BOX_CLASS,
+	BOX_FIELDS
+};
+
+/// decode + nms，final_boxes按BoxField的顺序输出，按score降序
+void postprocess(const float *pred, int num_anchors, const PostParam &param,
+		std::vector<std::vector<float>> &final_boxes);
+
+/// 标量实现，仅用于校验和性能对比
+void nms_scalar(const BoxSoA &boxes, const PostParam &param, std::vector<int> &keep);
+
+}
+
+#endif /* IMAGE_SRC_AI_MODEL_YOLOV5_POST_HPP_ */
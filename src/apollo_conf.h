@@ -33,6 +33,52 @@ const std::string APOLLO_DATAFLOW_URL_TRANS_HOST{"dataflow_url_trans_host"};
 const std::string APOLLO_DATAFLOW_URL_TRANS_TIMEOUT{"dataflow_url_trans_timeout"};
 const std::string APOLLO_DATAFLOW_URL_TRANS_RETRY{"dataflow_url_trans_retry"};
 const std::string APOLLO_AUTOMATIC_URL{"paas_automatic_aurl"};
+// CPU线程预算：总线程数、最大请求并发(io线程数)，0表示使用CPU核数
+const std::string APOLLO_LOCAL_CPU_THREADS{"local_cpu_threads"};
+const std::string APOLLO_LOCAL_MAX_CONCURRENCY{"local_max_concurrency"};
+// JPEG缩小解码的目标长边，0表示按原图解码
+const std::string APOLLO_LOCAL_DECODE_TARGET_SIDE{"local_decode_target_side"};
+// URL图片边下载边解码(JPEG/PNG)：0/1
+const std::string APOLLO_LOCAL_STREAM_DECODE{"local_stream_decode"};
+// 对外HTTP请求是否使用HTTP/2：0/1
+const std::string APOLLO_LOCAL_HTTP2{"local_http2"};
+// URL转换缓存：本地LRU容量(默认0，不缓存，每次同步转换；按部署在apollo中开启，如10000)、过期时间(秒)、是否使用redis共享层(0/1)
+const std::string APOLLO_LOCAL_URL_CACHE_SIZE{"local_url_cache_size"};
+const std::string APOLLO_LOCAL_URL_CACHE_TTL{"local_url_cache_ttl"};
+const std::string APOLLO_LOCAL_URL_CACHE_REDIS{"local_url_cache_redis"};
+// 响应压缩(gzip/deflate)：是否启用(0/1)、最小长度(字节)、zlib压缩级别(1-9)、压缩线程数
+const std::string APOLLO_LOCAL_COMPRESS{"local_compress"};
+const std::string APOLLO_LOCAL_COMPRESS_MIN_SIZE{"local_compress_min_size"};
+const std::string APOLLO_LOCAL_COMPRESS_LEVEL{"local_compress_level"};
+const std::string APOLLO_LOCAL_COMPRESS_THREADS{"local_compress_threads"};
+// 每个io线程一个SO_REUSEPORT监听socket，由内核分发连接：0/1
+// 内核按四元组哈希把连接固定分给某个线程，不再按线程负载挑选：handler阻塞的线程仍会收到新连接，
+// 换来的是accept不经过单个线程；handler耗时差异大时保持0
+const std::string APOLLO_LOCAL_REUSE_PORT{"local_reuse_port"};
+// 请求体最大字节数，超过时收到header后直接返回413，0表示不限制
+const std::string APOLLO_LOCAL_MAX_BODY_SIZE{"local_max_body_size"};
+// 请求体剩余字节数不小于此值时直接读入请求体(不经过4KB缓冲区)，0表示不启用
+const std::string APOLLO_LOCAL_DIRECT_READ_THRESHOLD{"local_direct_read_threshold"};
+// 连接超时时间轮的精度(毫秒)
+const std::string APOLLO_LOCAL_TIMER_GRANULARITY_MS{"local_timer_granularity_ms"};
+// 连接超时(毫秒)：等待请求(含keep-alive空闲，默认5000)、写响应(默认30000)、
+// 处理请求(默认0)，超时关闭连接，0表示不启用。
+// 处理超时只对异步完成的响应(如压缩)生效，阻塞io线程的同步推理不会被中断
+const std::string APOLLO_LOCAL_READ_TIMEOUT_MS{"local_read_timeout_ms"};
+const std::string APOLLO_LOCAL_WRITE_TIMEOUT_MS{"local_write_timeout_ms"};
+const std::string APOLLO_LOCAL_HANDLER_TIMEOUT_MS{"local_handler_timeout_ms"};
+// 并发连接数和接收/处理中的请求体字节数上限，达到时暂停accept，0表示不限制
+const std::string APOLLO_LOCAL_MAX_CONNECTIONS{"local_max_connections"};
+const std::string APOLLO_LOCAL_MAX_INFLIGHT_BODY_BYTES{"local_max_inflight_body_bytes"};
+// 两者都降到上限的此百分比以下时恢复accept
+const std::string APOLLO_LOCAL_ACCEPT_LOW_WATER_PERCENT{"local_accept_low_water_percent"};
+// SIGTERM摘流：注销Eureka并让就绪检查失败后，继续接收请求的时间(毫秒)，
+// 留给注册中心和负载均衡感知下线
+const std::string APOLLO_LOCAL_DRAIN_DELAY_MS{"local_drain_delay_ms"};
+// 从收到SIGTERM到退出的最长时间(毫秒)，包括等待处理中的请求和Kafka队列
+const std::string APOLLO_LOCAL_DRAIN_TIMEOUT_MS{"local_drain_timeout_ms"};
+// 就绪检查的路由，摘流期间返回503
+const std::string APOLLO_LOCAL_READINESS_URL{"local_readiness_url"};
 
 
 const std::string APOLLO_BASE_CONF_ITEM[] = {
@@ -46,7 +92,32 @@ const std::string APOLLO_BASE_CONF_ITEM[] = {
     APOLLO_DATAFLOW_URL_TRANS_HOST, 
     APOLLO_DATAFLOW_URL_TRANS_TIMEOUT, 
     APOLLO_DATAFLOW_URL_TRANS_RETRY,
-    APOLLO_AUTOMATIC_URL
+    APOLLO_AUTOMATIC_URL,
+    APOLLO_LOCAL_CPU_THREADS,
+    APOLLO_LOCAL_MAX_CONCURRENCY,
+    APOLLO_LOCAL_DECODE_TARGET_SIDE,
+    APOLLO_LOCAL_STREAM_DECODE,
+    APOLLO_LOCAL_HTTP2,
+    APOLLO_LOCAL_URL_CACHE_SIZE,
+    APOLLO_LOCAL_URL_CACHE_TTL,
+    APOLLO_LOCAL_URL_CACHE_REDIS,
+    APOLLO_LOCAL_COMPRESS,
+    APOLLO_LOCAL_COMPRESS_MIN_SIZE,
+    APOLLO_LOCAL_COMPRESS_LEVEL,
+    APOLLO_LOCAL_COMPRESS_THREADS,
+    APOLLO_LOCAL_REUSE_PORT,
+    APOLLO_LOCAL_MAX_BODY_SIZE,
+    APOLLO_LOCAL_DIRECT_READ_THRESHOLD,
+    APOLLO_LOCAL_TIMER_GRANULARITY_MS,
+    APOLLO_LOCAL_READ_TIMEOUT_MS,
+    APOLLO_LOCAL_WRITE_TIMEOUT_MS,
+    APOLLO_LOCAL_HANDLER_TIMEOUT_MS,
+    APOLLO_LOCAL_MAX_CONNECTIONS,
+    APOLLO_LOCAL_MAX_INFLIGHT_BODY_BYTES,
+    APOLLO_LOCAL_ACCEPT_LOW_WATER_PERCENT,
+    APOLLO_LOCAL_DRAIN_DELAY_MS,
+    APOLLO_LOCAL_DRAIN_TIMEOUT_MS,
+    APOLLO_LOCAL_READINESS_URL
 };
 
 
@@ -36,9 +36,12 @@ void MicroserviceDemo::ProcessRequest(std::string &response) {
 TALError MicroserviceDemo::handler(Json::Value &result) {
     TALError res;
 
-    if (!Composion::instance()->parse_task(m_details, m_precision, request_id_, cv_image_, result)) {
+    // 直接输出data的字节，不构建result
+    if (!Composion::instance()->parse_task(m_details, m_precision, request_id_, cv_image_, 
+                                          response_format_, encoded_data_, image_scale_, m_fields)) {
     	return SERVICE_ERROR.E_INTERNAL_ERROR;
     }
+    has_encoded_data_ = true;
 
     return SERVICE_ERROR.E_OK;
 }
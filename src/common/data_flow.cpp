@@ -1,4 +1,7 @@
 #include "data_flow.h"
+#include "response_writer.h"
+
+#include <algorithm>
 
 std::string DataFlow::api_type_{"0"};
 std::string DataFlow::biz_type_{"datawork-image"};
@@ -12,57 +15,91 @@ DataFlow::~DataFlow() {
 }
 
 void DataFlow::SetSourceInfos(bool b_url, 
-                              const std::string &value, 
+                              const base::StringPiece &value, 
                               const std::string &request_id) {
     if (value.empty()) {
         m_root_[data_source_infos] = Json::arrayValue;
         return;
     }
 
-    Json::Value source_info;
-    source_info[data_source_id] = request_id;
-    source_info[data_source_content] = value;
+    m_root_.removeMember(data_source_infos);
+    m_source_content_ = value;
+    m_source_info_[data_source_id] = request_id;
     if (b_url) {
-        source_info[data_source_type] = "url";
+        m_source_info_[data_source_type] = "url";
     } else {
-        source_info[data_source_type] = "base64";
+        m_source_info_[data_source_type] = "base64";
     }
-    m_root_[data_source_infos].append(source_info);
 }
 
-void DataFlow::TransDataToJson(const std::string &type, 
-                               const std::string &data) {
-    Json::Value json_root;
-    Json::Reader json_reader;
-    if (json_reader.parse(data.data(), json_root)) {
-        if (type == trans_body_json) {
-            if (json_root.isObject() && 
-                json_root.isMember("image_base64") && 
-                json_root["image_base64"].isString() && 
-                !((json_root["image_base64"].asString()).empty())) {
-                Json::FastWriter writer;
-                Json::Value del_data;
-                json_root.removeMember("image_base64", &del_data);
-                std::string str_source = writer.write(json_root);
-                Json::Value json_param;
-                json_param["requestParam"] = str_source;
-                m_root_[data_source_remark] = json_param;
-            } else {
-                Json::Value json_param;
-                json_param["requestParam"] = data;
-                m_root_[data_source_remark] = json_param;
-            }
-        } else if (type == trans_response_json) {
-            m_root_[data_ret_data] = json_root;
-        }
+void DataFlow::SetResponse(const base::StringPiece &response) {
+    m_root_.removeMember(data_ret_data);
+    m_response_ = response;
+    while (!m_response_.empty() && m_response_[m_response_.size() - 1] == '\n') {
+        m_response_.remove_suffix(1);
+    }
+}
+
+void DataFlow::SetRequestParam(const base::StringPiece &body, 
+                               size_t erase_begin, 
+                               size_t erase_end) {
+    m_root_.removeMember(data_source_remark);
+    m_request_param_.clear();
+    if (erase_begin < erase_end && erase_end <= body.size()) {
+        m_request_param_.reserve(body.size() - (erase_end - erase_begin));
+        m_request_param_.append(body.data(), erase_begin);
+        m_request_param_.append(body.data() + erase_end, body.size() - erase_end);
     } else {
-        Json::Value json_param;
-        json_param["requestParam"] = data;
-        m_root_[data_source_remark] = json_param;
+        body.CopyToString(&m_request_param_);
     }
+    m_has_request_param_ = true;
 }
 
 std::string DataFlow::GetJsonData() {
-    Json::FastWriter writer;
-    return std::move(writer.write(m_root_));
+    std::vector<std::string> keys = m_root_.getMemberNames();
+    if (!m_source_content_.empty()) {
+        keys.push_back(data_source_infos);
+    }
+    if (!m_response_.empty()) {
+        keys.push_back(data_ret_data);
+    }
+    if (m_has_request_param_) {
+        keys.push_back(data_source_remark);
+    }
+    // 与Json::FastWriter一致，key按字典序输出
+    std::sort(keys.begin(), keys.end());
+
+    std::string message;
+    message.reserve(m_source_content_.size() + m_response_.size() + 
+                    m_request_param_.size() + 1024);
+    auto writer = ResponseWriter::Create(ResponseFormat::JSON, message);
+    writer->StartObject(keys.size());
+    for (const auto &key : keys) {
+        writer->Key(key);
+        if (key == data_source_infos && !m_source_content_.empty()) {
+            // 只有一个来源：{"content","id","sourceType"}
+            writer->StartArray(1);
+            writer->StartObject(3);
+            writer->Key(data_source_content);
+            writer->String(m_source_content_);
+            writer->Key(data_source_id);
+            writer->Value(m_source_info_[data_source_id]);
+            writer->Key(data_source_type);
+            writer->Value(m_source_info_[data_source_type]);
+            writer->EndObject();
+            writer->EndArray();
+        } else if (key == data_ret_data && !m_response_.empty()) {
+            writer->Raw(m_response_);
+        } else if (key == data_source_remark && m_has_request_param_) {
+            writer->StartObject(1);
+            writer->Key("requestParam");
+            writer->String(m_request_param_);
+            writer->EndObject();
+        } else {
+            writer->Value(m_root_[key]);
+        }
+    }
+    writer->EndObject();
+    writer->Finish();
+    return message;
 }
@@ -2,6 +2,7 @@
 
 #include "eureka/json/json.h"
 #include "kafka_client.h"
+#include "base/strings/string_piece.h"
 
 const std::string data_api_id = "apiId";
 const std::string data_api_name = "apiName";
@@ -27,8 +28,6 @@ const std::string data_source_remark = "sourceRemark";
 const std::string data_ret_data = "data";
 const std::string data_remark = "dataRemark";
 const std::string data_tag = "tag";
-const std::string trans_body_json = "body";
-const std::string trans_response_json = "response";
 
 class DataFlow {
 public:
@@ -40,15 +39,32 @@ public:
     void SetValue(const std::string &key, const V &value);
     // 目前只支持：图像url、base64，暂不支持其他类型
     void SetSourceInfos(bool b_url, 
-                        const std::string &value, 
+                        const base::StringPiece &value, 
                         const std::string &request_id);
 
-    void TransDataToJson(const std::string &type, 
-                         const std::string &data);
+    /**
+     * 接口的响应原样作为data，不再解析和序列化
+     * response必须是Json::FastWriter格式的JSON(ResponseWriter的输出)，末尾的换行会被去掉
+     */
+    void SetResponse(const base::StringPiece &response);
+    /**
+     * 请求体去掉[erase_begin, erase_end)后作为requestParam，一般为image_base64成员的区间
+     * (JsonStringSpan::member_begin/member_end)，不需要删除时两者相等
+     */
+    void SetRequestParam(const base::StringPiece &body, 
+                         size_t erase_begin, 
+                         size_t erase_end);
+    // 拼接各部分：SetSourceInfos和SetResponse的数据在此之前必须有效
     std::string GetJsonData();
 
 private:
     Json::Value m_root_;
+    // 以下部分不放入m_root_，GetJsonData时直接写出，避免拷贝和重新编码
+    base::StringPiece m_source_content_;  // 图片url或base64
+    Json::Value m_source_info_;           // sourceInfos中content以外的字段
+    base::StringPiece m_response_;
+    std::string m_request_param_;
+    bool m_has_request_param_{false};
 
     // 接口类型：0-同步；1-异步
     static std::string api_type_;
@@ -0,0 +1,274 @@
+#include "fast_base64.h"
+
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+
+namespace {
+
+const uint8_t kInvalid = 0xFF;
+const uint8_t kSpace = 0xFE;
+
+struct DecodeTable {
+    uint8_t value[256];
+
+    DecodeTable() {
+        memset(value, kInvalid, sizeof(value));
+        const char *alphabet =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; ++i) {
+            value[static_cast<uint8_t>(alphabet[i])] = i;
+        }
+        value[' '] = value['\t'] = value['\r'] = value['\n'] = kSpace;
+    }
+};
+
+const DecodeTable kTable;
+
+/**
+ * 向量化解码：从src开始解码尽可能多的完整块，遇到包含非base64字符(空白、'='等)的块
+ * 或者剩余输入/输出不足一个块时停止，由标量实现继续处理
+ * 算法参考Wojciech Muła的base64 SIMD解码：查表校验字符，再按字符区间加偏移得到6bit值
+ */
+typedef void (*BlockDecoder)(uint8_t *&out, uint8_t *out_end,
+                             const uint8_t *&src, const uint8_t *src_end);
+
+void DecodeBlocksScalar(uint8_t *&out, uint8_t *out_end,
+                        const uint8_t *&src, const uint8_t *src_end) {
+    const uint8_t *table = kTable.value;
+    // 每次4个字符，任一字符不是base64字符(最高两位非0)时停止
+    while (src_end - src >= 4 && out_end - out >= 3) {
+        uint32_t a = table[src[0]], b = table[src[1]];
+        uint32_t c = table[src[2]], d = table[src[3]];
+        if ((a | b | c | d) & 0xC0) {
+            break;
+        }
+        uint32_t quad = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<uint8_t>(quad >> 16);
+        out[1] = static_cast<uint8_t>(quad >> 8);
+        out[2] = static_cast<uint8_t>(quad);
+        src += 4;
+        out += 3;
+    }
+}
+
+__attribute__((target("ssse3")))
+void DecodeBlocksSSSE3(uint8_t *&out, uint8_t *out_end,
+                       const uint8_t *&src, const uint8_t *src_end) {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i pack_shuffle = _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    // 每次读16个字符，写16字节(有效12字节)
+    while (src_end - src >= 16 && out_end - out >= 16) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi),
+                                             _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+        __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        str = _mm_add_epi8(str, roll);
+
+        // 4个6bit -> 3个字节
+        __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, pack_shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), merged);
+        src += 16;
+        out += 12;
+    }
+    DecodeBlocksScalar(out, out_end, src, src_end);
+}
+
+__attribute__((target("avx2")))
+void DecodeBlocksAVX2(uint8_t *&out, uint8_t *out_end,
+                      const uint8_t *&src, const uint8_t *src_end) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    const __m256i pack_shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i pack_permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    // 每次读32个字符，写32字节(有效24字节)
+    while (src_end - src >= 32 && out_end - out >= 32) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack_shuffle);
+        merged = _mm256_permutevar8x32_epi32(merged, pack_permute);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), merged);
+        src += 32;
+        out += 24;
+    }
+    // 剩余部分不走SSSE3实现：非VEX编码的SSE指令与AVX混用有状态切换开销
+    DecodeBlocksScalar(out, out_end, src, src_end);
+}
+
+struct Impl {
+    const char *name;
+    BlockDecoder decoder;
+};
+
+Impl SelectImpl() {
+    if (__builtin_cpu_supports("avx2")) {
+        return Impl{"avx2", &DecodeBlocksAVX2};
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return Impl{"ssse3", &DecodeBlocksSSSE3};
+    }
+    return Impl{"scalar", &DecodeBlocksScalar};
+}
+
+Impl g_impl = SelectImpl();
+
+// 跳过开头的空白和data URI前缀("data:image/jpeg;base64,")
+const uint8_t *SkipPrefix(const uint8_t *src, const uint8_t *src_end) {
+    while (src < src_end && kTable.value[*src] == kSpace) {
+        ++src;
+    }
+    const size_t prefix_len = 5;
+    if (src_end - src >= static_cast<ptrdiff_t>(prefix_len) &&
+        memcmp(src, "data:", prefix_len) == 0) {
+        auto comma = static_cast<const uint8_t *>(memchr(src, ',', src_end - src));
+        if (comma) {
+            src = comma + 1;
+        }
+    }
+    return src;
+}
+
+}  // namespace
+
+size_t FastBase64Decode(char *dest, size_t dest_len, const char *src, size_t len) {
+    const uint8_t *in = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *in_end = in + len;
+    uint8_t *out = reinterpret_cast<uint8_t *>(dest);
+    uint8_t *out_end = out + dest_len;
+    BlockDecoder decode_blocks = g_impl.decoder;
+
+    in = SkipPrefix(in, in_end);
+    uint32_t quad = 0;
+    int count = 0;  // quad中已有的6bit个数
+    bool padded = false;
+    while (true) {
+        if (count == 0) {
+            decode_blocks(out, out_end, in, in_end);
+        }
+        if (in == in_end) {
+            break;
+        }
+        uint8_t value = kTable.value[*in++];
+        if (value < 64) {
+            quad = (quad << 6) | value;
+            if (++count == 4) {
+                if (out_end - out < 3) {
+                    return FAST_BASE64_ERROR;
+                }
+                out[0] = static_cast<uint8_t>(quad >> 16);
+                out[1] = static_cast<uint8_t>(quad >> 8);
+                out[2] = static_cast<uint8_t>(quad);
+                out += 3;
+                quad = 0;
+                count = 0;
+            }
+        } else if (value == kSpace) {
+            continue;
+        } else if (in[-1] == '=') {
+            padded = true;
+            break;
+        } else {
+            return FAST_BASE64_ERROR;
+        }
+    }
+
+    if (!padded) {
+        return count == 0 ? out - reinterpret_cast<uint8_t *>(dest) : FAST_BASE64_ERROR;
+    }
+
+    // 末尾的'='：只能是 xx== 或 xxx=，之后只允许空白
+    int padding = 1;
+    for (; in < in_end; ++in) {
+        if (*in == '=') {
+            ++padding;
+        } else if (kTable.value[*in] != kSpace) {
+            return FAST_BASE64_ERROR;
+        }
+    }
+    if (count < 2 || count + padding != 4 || out_end - out < count - 1) {
+        return FAST_BASE64_ERROR;
+    }
+    quad <<= 6 * padding;
+    out[0] = static_cast<uint8_t>(quad >> 16);
+    if (count == 3) {
+        out[1] = static_cast<uint8_t>(quad >> 8);
+    }
+    out += count - 1;
+    return out - reinterpret_cast<uint8_t *>(dest);
+}
+
+bool FastBase64Decode(const base::StringPiece &input, std::string *output) {
+    output->resize(FastBase64DecodeLen(input.size()));
+    size_t size = FastBase64Decode(&(*output)[0], output->size(),
+                                   input.data(), input.size());
+    if (size == FAST_BASE64_ERROR) {
+        output->clear();
+        return false;
+    }
+    output->resize(size);
+    return true;
+}
+
+const char *FastBase64Impl() {
+    return g_impl.name;
+}
+
+bool FastBase64SetImpl(const std::string &impl) {
+    if (impl == "avx2" && __builtin_cpu_supports("avx2")) {
+        g_impl = Impl{"avx2", &DecodeBlocksAVX2};
+    } else if (impl == "ssse3" && __builtin_cpu_supports("ssse3")) {
+        g_impl = Impl{"ssse3", &DecodeBlocksSSSE3};
+    } else if (impl == "scalar") {
+        g_impl = Impl{"scalar", &DecodeBlocksScalar};
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "base/strings/string_piece.h"
+
+#include <string>
+#include <cstddef>
+
+
+/**
+ * base64解码：AVX2/SSSE3向量化，运行时根据CPU选择，不支持时使用标量实现
+ * 1.对标准输入(无空白)的结果与base::Base64Decode(modp_b64)一致：
+ *   有效字符数必须是4的倍数，末尾最多两个'='
+ * 2.额外容忍客户端常见的格式：空白字符(空格、\t、\r、\n)和"data:image/jpeg;base64,"前缀
+ */
+const size_t FAST_BASE64_ERROR = static_cast<size_t>(-1);
+
+// 解码len个字符所需的最大输出长度
+inline size_t FastBase64DecodeLen(size_t len) {
+    return len / 4 * 3 + 2;
+}
+
+// 解码到dest中，dest_len不小于FastBase64DecodeLen(len)，返回解码长度，失败返回FAST_BASE64_ERROR
+size_t FastBase64Decode(char *dest, size_t dest_len, const char *src, size_t len);
+
+// 解码到output中，output原有的内存会被复用
+bool FastBase64Decode(const base::StringPiece &input, std::string *output);
+
+// 当前使用的实现：avx2/ssse3/scalar
+const char *FastBase64Impl();
+
+// 指定实现，CPU不支持时返回false，仅用于测试和性能对比
+bool FastBase64SetImpl(const std::string &impl);
@@ -15,11 +15,17 @@
 #include "breakpad/src/client/linux/handler/exception_handler.h"
 #include "json/json.h"
 #include "curl/curl.h"
+#include "http_client.h"
+#include "metrics.h"
 
 #include <iostream>
 #include <stdlib.h>
 #include <unistd.h>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <algorithm>
 
 
 using namespace base;
@@ -50,7 +56,8 @@ bool Trans2InnerUrl(const std::string &request_id,
     Json::FastWriter writer;
     std::string trans_body = writer.write(root);
 
-    CURL *curl = curl_easy_init();
+    HttpClient::Handle handle;
+    CURL *curl = handle.Get();
     if (!curl) {
         err_msg = "failed to init curl";
         return false;
@@ -69,7 +76,7 @@ bool Trans2InnerUrl(const std::string &request_id,
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 1);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_seconds);
-    CURLcode ret = curl_easy_perform(curl);
+    CURLcode ret = handle.Perform();
 
     long res_code = 0;
     if(ret == CURLE_OK) {
@@ -78,7 +85,6 @@ bool Trans2InnerUrl(const std::string &request_id,
     if (li) {
         curl_slist_free_all(li);
     }
-    curl_easy_cleanup(curl);
 
     if (ret == CURLE_COULDNT_CONNECT) {
         err_msg = "connection disconnect";
@@ -171,7 +177,8 @@ bool DownloadImage(const std::string &image_url,
                    double &img_size, 
                    std::string &err_msg, 
                    unsigned int timeout_seconds) {
-    CURL *curl = curl_easy_init();
+    HttpClient::Handle handle;
+    CURL *curl = handle.Get();
     if (!curl) {
         err_msg = "failed to curl init";
         return false;
@@ -184,7 +191,7 @@ bool DownloadImage(const std::string &image_url,
     curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 60 * 60 * 72);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &WriteImageData);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &image_data);
-    CURLcode ret_code = curl_easy_perform (curl);
+    CURLcode ret_code = handle.Perform();
     curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &img_size);
     bool res = true;
     if (ret_code != CURLE_OK) {
@@ -202,7 +209,226 @@ bool DownloadImage(const std::string &image_url,
             res = false;
         }
     }
-    curl_easy_cleanup(curl);
 
     return res;
 }
+
+/**
+ * 近期成功下载的耗时，用于计算对冲阈值
+ */
+class DownloadLatency {
+public:
+    static void Add(double ms) {
+        std::lock_guard<std::mutex> guard(lock_);
+        samples_[next_++ % kMaxSamples] = ms;
+        count_ = std::min(count_ + 1, kMaxSamples);
+    }
+
+    // 样本不足时返回def_ms
+    static double Percentile(double p, double def_ms) {
+        std::vector<double> samples;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (count_ < kMinSamples) {
+                return def_ms;
+            }
+            samples.assign(samples_, samples_ + count_);
+        }
+        auto nth = samples.begin() + static_cast<size_t>(p * (samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    }
+
+private:
+    static const size_t kMaxSamples = 256;
+    static const size_t kMinSamples = 20;
+    static std::mutex lock_;
+    static double samples_[kMaxSamples];
+    static size_t next_;
+    static size_t count_;
+};
+
+const size_t DownloadLatency::kMaxSamples;
+const size_t DownloadLatency::kMinSamples;
+std::mutex DownloadLatency::lock_;
+double DownloadLatency::samples_[DownloadLatency::kMaxSamples];
+size_t DownloadLatency::next_{0};
+size_t DownloadLatency::count_{0};
+
+static Metrics::Counter *g_download_attempts = 
+    Metrics::GetCounter("image_download_attempts_total");
+static Metrics::Counter *g_download_hedged = 
+    Metrics::GetCounter("image_download_hedged_total");
+static Metrics::Counter *g_download_hedge_won = 
+    Metrics::GetCounter("image_download_hedge_won_total");
+
+namespace {
+
+struct DownloadAttempt {
+    HttpClient::Handle handle;
+    std::string *sink{nullptr};  // 第一个请求直接写到调用方的缓冲区
+    std::string buffer;
+    bool hedge{false};
+    bool reserved{false};
+    const DownloadProgress *progress{nullptr};
+};
+
+size_t WriteAttemptData(void *buffer, size_t size, size_t nmemb, void *stream) {
+    auto attempt = static_cast<DownloadAttempt *>(stream);
+    size_t len = size * nmemb;
+    if (!attempt->reserved) {
+        // 按Content-Length一次分配，避免追加时反复扩容
+        attempt->reserved = true;
+        curl_off_t content_length = -1;
+        curl_easy_getinfo(attempt->handle.Get(), 
+                          CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, 
+                          &content_length);
+        if (content_length > 0 && content_length <= (64 << 20)) {
+            attempt->sink->reserve(static_cast<size_t>(content_length));
+        }
+    }
+    attempt->sink->append(static_cast<char *>(buffer), len);
+    if (attempt->progress && *attempt->progress) {
+        (*attempt->progress)(*attempt->sink);
+    }
+    return len;
+}
+
+}  // namespace
+
+bool DownloadImageHedged(const std::string &image_url, 
+                         std::string &image_data, 
+                         std::string &err_msg, 
+                         unsigned int deadline_ms, 
+                         unsigned int max_attempts, 
+                         const DownloadProgress &progress) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    auto elapsed_ms = [&start]() -> long {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - start).count();
+    };
+    // 对冲阈值：p95，限制在[50ms, deadline/2]
+    long hedge_ms = static_cast<long>(DownloadLatency::Percentile(0.95, 300.0));
+    hedge_ms = std::max(50L, std::min(hedge_ms, static_cast<long>(deadline_ms / 2)));
+
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        err_msg = "failed to init curl multi";
+        return false;
+    }
+
+    std::vector<std::unique_ptr<DownloadAttempt>> attempts;
+    unsigned int running = 0;
+    auto start_attempt = [&](bool hedge) -> bool {
+        long remain_ms = static_cast<long>(deadline_ms) - elapsed_ms();
+        if (attempts.size() >= max_attempts || remain_ms <= 0) {
+            return false;
+        }
+        std::unique_ptr<DownloadAttempt> attempt{new DownloadAttempt};
+        CURL *curl = attempt->handle.Get();
+        if (!curl) {
+            err_msg = "failed to curl init";
+            return false;
+        }
+        attempt->hedge = hedge;
+        if (attempts.empty()) {
+            image_data.clear();
+            attempt->sink = &image_data;
+            attempt->progress = &progress;
+        } else {
+            attempt->sink = &attempt->buffer;
+        }
+        curl_easy_setopt(curl, CURLOPT_URL, image_url.c_str());
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, remain_ms);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 60 * 60 * 72);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &WriteAttemptData);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, attempt.get());
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, attempt.get());
+        curl_multi_add_handle(multi, curl);
+        attempts.emplace_back(std::move(attempt));
+        ++running;
+        g_download_attempts->Add();
+        return true;
+    };
+
+    DownloadAttempt *winner = nullptr;
+    bool hedged = false;
+    start_attempt(false);
+    while (running > 0 && !winner) {
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        CURLMsg *msg = nullptr;
+        int queued = 0;
+        while (!winner && (msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            // remove_handle之后msg失效，先取出需要的内容
+            CURL *easy = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            DownloadAttempt *attempt = nullptr;
+            long http_code = 0;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &attempt);
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &http_code);
+            curl_multi_remove_handle(multi, easy);
+            attempt->handle.RecordStats();
+            --running;
+
+            if (result == CURLE_OK && http_code == 200) {
+                winner = attempt;
+            } else if (result != CURLE_OK) {
+                err_msg = "download image error, code: " + std::to_string(result);
+                err_msg += std::string{", msg: "} + curl_easy_strerror(result);
+                err_msg += ", image_url: " + image_url;
+            } else {
+                err_msg = "download image error, code: " + std::to_string(http_code);
+            }
+        }
+        if (winner) {
+            break;
+        }
+
+        long now_ms = elapsed_ms();
+        if (now_ms >= static_cast<long>(deadline_ms)) {
+            err_msg = "download image timeout, image_url: " + image_url;
+            break;
+        }
+        // 全部失败时立即重试；首个请求超过阈值还没完成时发起对冲请求
+        if (running == 0) {
+            start_attempt(false);
+        } else if (!hedged && now_ms >= hedge_ms) {
+            hedged = start_attempt(true);
+            if (hedged) {
+                g_download_hedged->Add();
+            }
+        }
+
+        long wait_ms = static_cast<long>(deadline_ms) - now_ms;
+        if (!hedged) {
+            wait_ms = std::min(wait_ms, hedge_ms - now_ms);
+        }
+        curl_multi_wait(multi, nullptr, 0, 
+                        static_cast<int>(std::max(1L, std::min(wait_ms, 100L))), nullptr);
+    }
+
+    // 未完成的请求直接取消，连接由curl关闭
+    for (auto &attempt : attempts) {
+        curl_multi_remove_handle(multi, attempt->handle.Get());
+    }
+    curl_multi_cleanup(multi);
+
+    if (!winner) {
+        return false;
+    }
+    if (winner->hedge) {
+        g_download_hedge_won->Add();
+    }
+    DownloadLatency::Add(std::chrono::duration<double, std::milli>(
+        Clock::now() - start).count());
+    if (winner->sink != &image_data) {
+        image_data.swap(winner->buffer);
+    }
+    return true;
+}
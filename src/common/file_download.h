@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 
 
 bool Trans2InnerUrl(const std::string &request_id, 
@@ -16,3 +17,20 @@ bool DownloadImage(const std::string &image_url,
                    std::string &err_msg, 
                    unsigned int timeout_seconds=1);
 
+// 下载过程中数据到达时的回调，参数为目前收到的全部数据
+using DownloadProgress = std::function<void(const std::string &data)>;
+
+/**
+ * 对冲下载：第一个请求在自适应阈值(近期下载耗时的p95)内没有完成时，
+ * 并行发起第二个请求，取先成功的结果；请求失败时立即重新发起，不再sleep
+ * deadline_ms为整个下载的总时限，max_attempts为最多发起的请求数(含对冲请求)
+ * progress只跟随第一个请求(直接写入image_data的请求)，用于边下载边解码；
+ * 对冲或重试的请求胜出时image_data被替换为它的数据，不再回调
+ */
+bool DownloadImageHedged(const std::string &image_url, 
+                         std::string &image_data, 
+                         std::string &err_msg, 
+                         unsigned int deadline_ms=3000, 
+                         unsigned int max_attempts=3, 
+                         const DownloadProgress &progress=nullptr);
+
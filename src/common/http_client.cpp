@@ -0,0 +1,127 @@
+#include "http_client.h"
+#include "metrics.h"
+#include "base/logging.h"
+
+#include <mutex>
+#include <vector>
+
+
+CURLSH *HttpClient::share_{nullptr};
+bool HttpClient::http2_{false};
+
+// 每种共享数据一把锁
+static std::mutex g_share_locks[CURL_LOCK_DATA_LAST];
+
+static Metrics::Counter *g_requests = Metrics::GetCounter("http_client_requests_total");
+static Metrics::Counter *g_connections = Metrics::GetCounter("http_client_connections_total");
+static Metrics::Counter *g_connect_us = Metrics::GetCounter("http_client_connect_us_total");
+static Metrics::Counter *g_tls_us = Metrics::GetCounter("http_client_tls_us_total");
+
+namespace {
+
+// 线程退出时释放该线程缓存的handle
+struct HandleCache {
+    std::vector<CURL *> handles;
+
+    ~HandleCache() {
+        for (auto curl : handles) {
+            curl_easy_cleanup(curl);
+        }
+    }
+};
+
+thread_local HandleCache t_cache;
+
+}  // namespace
+
+void HttpClient::Lock(CURL *handle, curl_lock_data data, 
+                      curl_lock_access access, void *userptr) {
+    g_share_locks[data].lock();
+}
+
+void HttpClient::Unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    g_share_locks[data].unlock();
+}
+
+void HttpClient::Init(bool http2) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    http2_ = http2;
+    // share_在进程生命周期内有效，各线程的handle在线程退出时才释放，因此不做cleanup
+    share_ = curl_share_init();
+    if (share_) {
+        curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &HttpClient::Lock);
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &HttpClient::Unlock);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    } else {
+        LOG(ERROR) << "failed to init curl share";
+    }
+
+    Metrics::SetGauge("http_client_connection_reuse_ratio", []() {
+        double requests = g_requests->Value();
+        return requests == 0 ? 0.0 : 1.0 - g_connections->Value() / requests;
+    });
+    LOG(INFO) << "http client: http2=" << http2_;
+}
+
+void HttpClient::Setup(CURL *curl) {
+    if (share_) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+    if (http2_) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+}
+
+HttpClient::Handle::Handle() {
+    auto &handles = t_cache.handles;
+    if (!handles.empty()) {
+        curl_ = handles.back();
+        handles.pop_back();
+        // 只重置选项，连接和缓存保留
+        curl_easy_reset(curl_);
+    } else {
+        curl_ = curl_easy_init();
+    }
+    if (curl_) {
+        Setup(curl_);
+    }
+}
+
+HttpClient::Handle::~Handle() {
+    if (curl_) {
+        t_cache.handles.push_back(curl_);
+    }
+}
+
+CURLcode HttpClient::Handle::Perform() {
+    CURLcode code = curl_easy_perform(curl_);
+    RecordStats();
+    return code;
+}
+
+void HttpClient::Handle::RecordStats() {
+    g_requests->Add();
+
+    long new_connects = 0;
+    curl_easy_getinfo(curl_, CURLINFO_NUM_CONNECTS, &new_connects);
+    if (new_connects > 0) {
+        double connect_time = 0.0, tls_time = 0.0;
+        curl_easy_getinfo(curl_, CURLINFO_CONNECT_TIME, &connect_time);
+        curl_easy_getinfo(curl_, CURLINFO_APPCONNECT_TIME, &tls_time);
+        g_connections->Add(new_connects);
+        g_connect_us->Add(static_cast<uint64_t>(connect_time * 1e6));
+        // APPCONNECT_TIME从请求开始计时，包含了TCP连接的时间
+        if (tls_time > connect_time) {
+            g_tls_us->Add(static_cast<uint64_t>((tls_time - connect_time) * 1e6));
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "curl/curl.h"
+
+
+/**
+ * 共享的HTTP客户端：图片下载、URL转换、其他对外请求共用
+ * 1.每个线程缓存easy handle并复用，handle保留自己的连接
+ * 2.所有handle通过CURLSH共享DNS、连接、TLS session缓存，不同线程访问同一个
+ *   OSS域名时也可以复用已有连接，避免每次请求重新握手
+ * 3.开启TCP keep-alive；可选HTTP/2(服务端支持时使用)
+ * 4.指标：http_client_requests_total、http_client_connections_total(新建连接数)、
+ *   http_client_connection_reuse_ratio、http_client_connect_us_total/tls_us_total(握手耗时)
+ * 使用方式：
+ *     HttpClient::Handle handle;
+ *     curl_easy_setopt(handle.Get(), CURLOPT_URL, ...);
+ *     CURLcode code = handle.Perform();
+ */
+class HttpClient {
+public:
+    class Handle {
+    public:
+        Handle();
+        ~Handle();
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+
+        // 已重置为默认选项并设置了共享缓存，初始化失败时为nullptr
+        CURL *Get() const { return curl_; }
+
+        // curl_easy_perform，并统计连接复用和握手耗时
+        CURLcode Perform();
+        // 通过curl_multi完成的传输，结束后调用以统计连接复用和握手耗时
+        void RecordStats();
+
+    private:
+        CURL *curl_{nullptr};
+    };
+
+public:
+    // http2：服务端支持时使用HTTP/2(https通过ALPN协商)
+    static void Init(bool http2);
+
+private:
+    static void Lock(CURL *handle, curl_lock_data data, 
+                     curl_lock_access access, void *userptr);
+    static void Unlock(CURL *handle, curl_lock_data data, void *userptr);
+    static void Setup(CURL *curl);
+
+private:
+    static CURLSH *share_;
+    static bool http2_;
+};
@@ -0,0 +1,34 @@
+#include "image_buffer.h"
+
+
+std::mutex ImageBuffer::lock_;
+std::vector<std::string> ImageBuffer::pool_;
+unsigned ImageBuffer::max_pooled_{16};
+size_t ImageBuffer::max_capacity_{8 << 20};
+
+void ImageBuffer::Init(unsigned max_pooled, size_t max_capacity) {
+    std::lock_guard<std::mutex> guard(lock_);
+    max_pooled_ = max_pooled;
+    max_capacity_ = max_capacity;
+    pool_.reserve(max_pooled_);
+}
+
+ImageBuffer::ImageBuffer() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!pool_.empty()) {
+        data_.swap(pool_.back());
+        pool_.pop_back();
+    }
+}
+
+ImageBuffer::~ImageBuffer() {
+    if (data_.capacity() > max_capacity_) {
+        return;
+    }
+    // 保留内容不清空：下次resize到相近大小时不需要重新填充
+    std::lock_guard<std::mutex> guard(lock_);
+    if (pool_.size() < max_pooled_) {
+        pool_.emplace_back();
+        pool_.back().swap(data_);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+
+/**
+ * 图片二进制数据的缓冲区池，避免每个请求都重新分配几MB的内存
+ * 1.base64直接解码到缓冲区中，下载的数据直接追加到缓冲区中
+ * 2.DecodeImage用cv::Mat头包装缓冲区后调用imdecode，中间不再拷贝
+ * 使用方式：请求处理期间持有一个ImageBuffer，析构时归还到池中
+ */
+class ImageBuffer {
+public:
+    ImageBuffer();
+    ~ImageBuffer();
+    ImageBuffer(const ImageBuffer &) = delete;
+    ImageBuffer &operator=(const ImageBuffer &) = delete;
+
+    std::string &Data() { return data_; }
+    const std::string &Data() const { return data_; }
+
+public:
+    // max_pooled：池中最多保留的缓冲区个数；max_capacity：超过此容量的缓冲区不归还
+    static void Init(unsigned max_pooled, size_t max_capacity);
+
+private:
+    std::string data_;
+
+    static std::mutex lock_;
+    static std::vector<std::string> pool_;
+    static unsigned max_pooled_;
+    static size_t max_capacity_;
+};
@@ -0,0 +1,545 @@
+#include "json_scanner.h"
+
+#include <cstring>
+#include <cstdlib>
+
+
+namespace {
+
+class Scanner {
+public:
+    explicit Scanner(const base::StringPiece &json)
+        : data_{json.data()}, size_{json.size()} {}
+
+    size_t Pos() const { return pos_; }
+
+    void SkipSpace() {
+        while (pos_ < size_ && 
+               (data_[pos_] == ' ' || data_[pos_] == '\t' || 
+                data_[pos_] == '\r' || data_[pos_] == '\n')) {
+            ++pos_;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipSpace();
+        if (pos_ < size_ && data_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool Peek(char c) {
+        SkipSpace();
+        return pos_ < size_ && data_[pos_] == c;
+    }
+
+    // 下一个非空白字符，数据结束时返回false
+    bool Current(char &c) {
+        SkipSpace();
+        if (pos_ >= size_) {
+            return false;
+        }
+        c = data_[pos_];
+        return true;
+    }
+
+    bool End() {
+        SkipSpace();
+        return pos_ == size_;
+    }
+
+    bool Literal(const char *text, size_t len) {
+        SkipSpace();
+        if (size_ - pos_ < len || memcmp(data_ + pos_, text, len) != 0) {
+            return false;
+        }
+        pos_ += len;
+        return true;
+    }
+
+    // 数字只确定区间，是否合法在转换时检查
+    bool Number(size_t &begin, size_t &end) {
+        SkipSpace();
+        begin = pos_;
+        if (pos_ >= size_ || (data_[pos_] != '-' && 
+            (data_[pos_] < '0' || data_[pos_] > '9'))) {
+            return false;
+        }
+        ++pos_;
+        while (pos_ < size_ && ((data_[pos_] >= '0' && data_[pos_] <= '9') || 
+               data_[pos_] == '.' || data_[pos_] == 'e' || data_[pos_] == 'E' || 
+               data_[pos_] == '+' || data_[pos_] == '-')) {
+            ++pos_;
+        }
+        end = pos_;
+        return true;
+    }
+
+    // 当前位置为'"'，跳过整个字符串，返回内容区间
+    bool String(size_t &begin, size_t &end, bool &escaped) {
+        if (!Consume('"')) {
+            return false;
+        }
+        begin = pos_;
+        escaped = false;
+        while (pos_ < size_) {
+            // 大字符串主要耗时在这里，用memchr找下一个引号，再检查其中是否有转义
+            auto quote = static_cast<const char *>(
+                memchr(data_ + pos_, '"', size_ - pos_));
+            if (!quote) {
+                return false;
+            }
+            size_t quote_pos = quote - data_;
+            if (!escaped && memchr(data_ + pos_, '\\', quote_pos - pos_)) {
+                escaped = true;
+            }
+            // 引号前连续的反斜杠为奇数个时，引号是被转义的
+            size_t slashes = 0;
+            while (quote_pos - slashes > begin && 
+                   data_[quote_pos - slashes - 1] == '\\') {
+                ++slashes;
+            }
+            pos_ = quote_pos + 1;
+            if (slashes % 2 == 0) {
+                end = quote_pos;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 跳过任意一个值：字符串、对象、数组、数字/true/false/null
+    bool Value() {
+        SkipSpace();
+        if (pos_ >= size_) {
+            return false;
+        }
+        size_t begin = 0, end = 0;
+        bool escaped = false;
+        char c = data_[pos_];
+        if (c == '"') {
+            return String(begin, end, escaped);
+        }
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (pos_ < size_) {
+                c = data_[pos_];
+                if (c == '"') {
+                    if (!String(begin, end, escaped)) {
+                        return false;
+                    }
+                    continue;
+                }
+                ++pos_;
+                if (c == '{' || c == '[') {
+                    ++depth;
+                } else if ((c == '}' || c == ']') && --depth == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        size_t start = pos_;
+        while (pos_ < size_ && data_[pos_] != ',' && data_[pos_] != '}' && 
+               data_[pos_] != ' ' && data_[pos_] != '\t' && 
+               data_[pos_] != '\r' && data_[pos_] != '\n') {
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_{0};
+};
+
+}  // namespace
+
+bool ScanJsonStringField(const base::StringPiece &json, 
+                         const std::string &key, 
+                         JsonStringSpan &span) {
+    span = JsonStringSpan();
+    Scanner scanner{json};
+    if (!scanner.Consume('{')) {
+        return false;
+    }
+    if (scanner.Consume('}')) {
+        return true;
+    }
+
+    bool key_seen = false;
+    size_t comma = std::string::npos;  // 当前成员之前的逗号
+    bool take_next_comma = false;      // 匹配的是第一个成员时，删除时带上之后的逗号
+    for (;;) {
+        size_t key_begin = 0, key_end = 0;
+        bool key_escaped = false;
+        if (!scanner.String(key_begin, key_end, key_escaped) || 
+            !scanner.Consume(':')) {
+            return false;
+        }
+        bool match = !key_escaped && key_end - key_begin == key.size() && 
+            memcmp(json.data() + key_begin, key.data(), key.size()) == 0;
+        if (match && key_seen) {
+            return false;
+        }
+        key_seen = key_seen || match;
+
+        if (match && scanner.Peek('"')) {
+            span.found = scanner.String(span.begin, span.end, span.escaped);
+            if (!span.found) {
+                return false;
+            }
+            span.member_begin = comma != std::string::npos ? comma : key_begin - 1;
+            span.member_end = span.end + 1;
+            take_next_comma = comma == std::string::npos;
+        } else if (!scanner.Value()) {
+            return false;
+        }
+
+        if (!scanner.Consume(',')) {
+            break;
+        }
+        comma = scanner.Pos() - 1;
+        if (take_next_comma) {
+            span.member_end = scanner.Pos();
+            take_next_comma = false;
+        }
+    }
+
+    return scanner.Consume('}');
+}
+
+static bool CheckEscapes(const char *begin, const char *end);
+
+// 与Json::Reader的嵌套深度限制一致
+static const uint32_t kMaxDepth = 1000;
+
+// 用Scanner逐个记录值的区间，nodes扩容后引用失效，只通过下标访问
+static bool IndexValue(Scanner &scanner, std::vector<JsonIndex::Node> &nodes, 
+                       uint32_t depth) {
+    char c = 0;
+    if (depth > kMaxDepth || !scanner.Current(c)) {
+        return false;
+    }
+    uint32_t index = nodes.size();
+    uint32_t pos = scanner.Pos();
+    nodes.push_back(JsonIndex::Node{JsonIndex::NULL_VALUE, false, pos, pos, 
+                                    0, 0, JsonIndex::kNone, JsonIndex::kNone, 0});
+    if (c == '"') {
+        size_t begin = 0, end = 0;
+        bool escaped = false;
+        if (!scanner.String(begin, end, escaped)) {
+            return false;
+        }
+        nodes[index].type = JsonIndex::STRING_VALUE;
+        nodes[index].escaped = escaped;
+        nodes[index].begin = begin;
+        nodes[index].end = end;
+        return true;
+    }
+
+    if (c == '{' || c == '[') {
+        bool object = c == '{';
+        char close = object ? '}' : ']';
+        nodes[index].type = object ? JsonIndex::OBJECT_VALUE : JsonIndex::ARRAY_VALUE;
+        scanner.Consume(c);
+        if (!scanner.Consume(close)) {
+            uint32_t last = JsonIndex::kNone;
+            do {
+                size_t key_begin = 0, key_end = 0;
+                if (object) {
+                    bool key_escaped = false;
+                    if (!scanner.String(key_begin, key_end, key_escaped) || 
+                        key_escaped || !scanner.Consume(':')) {
+                        return false;
+                    }
+                }
+                uint32_t child = nodes.size();
+                if (!IndexValue(scanner, nodes, depth + 1)) {
+                    return false;
+                }
+                nodes[child].key_begin = key_begin;
+                nodes[child].key_end = key_end;
+                if (last == JsonIndex::kNone) {
+                    nodes[index].child = child;
+                } else {
+                    nodes[last].next = child;
+                }
+                last = child;
+                ++nodes[index].size;
+            } while (scanner.Consume(','));
+            if (!scanner.Consume(close)) {
+                return false;
+            }
+        }
+        nodes[index].end = scanner.Pos();
+        return true;
+    }
+
+    // 数字的范围与Json::Reader相同，是否合法在转换时检查
+    size_t begin = 0, end = 0;
+    if (scanner.Number(begin, end)) {
+        nodes[index].type = JsonIndex::NUMBER_VALUE;
+        nodes[index].end = end;
+        return true;
+    }
+
+    static const struct {
+        const char *text;
+        size_t len;
+        JsonIndex::Type type;
+    } kLiterals[] = {{"true", 4, JsonIndex::TRUE_VALUE}, 
+                     {"false", 5, JsonIndex::FALSE_VALUE}, 
+                     {"null", 4, JsonIndex::NULL_VALUE}};
+    for (const auto &literal : kLiterals) {
+        if (scanner.Literal(literal.text, literal.len)) {
+            nodes[index].type = literal.type;
+            nodes[index].end = scanner.Pos();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool JsonIndex::Parse(const base::StringPiece &json) {
+    data_ = json.data();
+    size_ = json.size();
+    nodes_.clear();
+    if (size_ >= kNone) {
+        return false;
+    }
+    Scanner scanner{json};
+    if (!IndexValue(scanner, nodes_, 0) || !scanner.End()) {
+        return false;
+    }
+    // Json::Reader解析时就会拒绝非法的转义，这里同样检查，即使调用方不读取这个值
+    for (const auto &node : nodes_) {
+        if (node.escaped && !CheckEscapes(data_ + node.begin, data_ + node.end)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t JsonIndex::Find(uint32_t object, const base::StringPiece &key) const {
+    if (nodes_[object].type != OBJECT_VALUE) {
+        return kNone;
+    }
+    uint32_t found = kNone;
+    for (uint32_t i = nodes_[object].child; i != kNone; i = nodes_[i].next) {
+        const Node &node = nodes_[i];
+        if (node.key_end - node.key_begin == key.size() && 
+            memcmp(data_ + node.key_begin, key.data(), key.size()) == 0) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+static void AppendUtf8(unsigned code, std::string &out) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+// \uXXXX中的4位十六进制数，p指向'u'
+static bool DecodeHex4(const char *p, unsigned &code) {
+    code = 0;
+    for (int k = 1; k <= 4; ++k) {
+        char h = p[k];
+        code <<= 4;
+        if (h >= '0' && h <= '9') {
+            code += h - '0';
+        } else if (h >= 'a' && h <= 'f') {
+            code += h - 'a' + 10;
+        } else if (h >= 'A' && h <= 'F') {
+            code += h - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 只检查转义是否合法，规则与StringValue相同，不解码
+static bool CheckEscapes(const char *begin, const char *end) {
+    for (const char *p = begin; p < end; ++p) {
+        if (*p != '\\') {
+            continue;
+        }
+        if (++p >= end) {
+            return false;
+        }
+        switch (*p) {
+        case '"': case '/': case '\\': case 'b': case 'f': case 'n': case 'r': case 't':
+            break;
+        case 'u': {
+            unsigned code = 0;
+            if (end - p < 5 || !DecodeHex4(p, code)) {
+                return false;
+            }
+            p += 4;
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                unsigned low = 0;
+                if (end - p < 7 || p[1] != '\\' || p[2] != 'u' || !DecodeHex4(p + 2, low)) {
+                    return false;
+                }
+                p += 6;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonIndex::StringValue(uint32_t i, std::string &scratch, 
+                            base::StringPiece &value) const {
+    const Node &node = nodes_[i];
+    if (node.type != STRING_VALUE) {
+        return false;
+    }
+    if (!node.escaped) {
+        value.set(data_ + node.begin, node.end - node.begin);
+        return true;
+    }
+
+    scratch.clear();
+    for (uint32_t pos = node.begin; pos < node.end; ++pos) {
+        char c = data_[pos];
+        if (c != '\\') {
+            scratch += c;
+            continue;
+        }
+        if (++pos >= node.end) {
+            return false;
+        }
+        switch (data_[pos]) {
+        case '"': scratch += '"'; break;
+        case '/': scratch += '/'; break;
+        case '\\': scratch += '\\'; break;
+        case 'b': scratch += '\b'; break;
+        case 'f': scratch += '\f'; break;
+        case 'n': scratch += '\n'; break;
+        case 'r': scratch += '\r'; break;
+        case 't': scratch += '\t'; break;
+        case 'u': {
+            unsigned code = 0;
+            if (node.end - pos < 5 || !DecodeHex4(data_ + pos, code)) {
+                return false;
+            }
+            pos += 4;
+            // 与Json::Reader一致：高位代理后必须紧跟\u，组合为一个码点；单独的低位代理按原值编码
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                unsigned low = 0;
+                if (node.end - pos < 7 || data_[pos + 1] != '\\' || data_[pos + 2] != 'u' ||
+                    !DecodeHex4(data_ + pos + 2, low)) {
+                    return false;
+                }
+                code = 0x10000 + ((code & 0x3FF) << 10) + (low & 0x3FF);
+                pos += 6;
+            }
+            AppendUtf8(code, scratch);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    value.set(scratch.data(), scratch.size());
+    return true;
+}
+
+// 与Json::Reader::decodeDouble一致，数字必须完整
+static bool DecodeDouble(const char *begin, const char *end, Json::Value &value) {
+    std::string buffer(begin, end);
+    char *parsed = nullptr;
+    double real = strtod(buffer.c_str(), &parsed);
+    if (parsed != buffer.c_str() + buffer.size()) {
+        return false;
+    }
+    value = Json::Value(real);
+    return true;
+}
+
+// 与Json::Reader::decodeNumber一致：整数优先，超出范围的按double
+static bool DecodeNumber(const char *begin, const char *end, Json::Value &value) {
+    bool is_double = false;
+    for (const char *p = begin; p != end; ++p) {
+        is_double = is_double || *p == '.' || *p == 'e' || *p == 'E' || 
+                    *p == '+' || (*p == '-' && p != begin);
+    }
+    if (is_double) {
+        return DecodeDouble(begin, end, value);
+    }
+
+    typedef Json::Value::LargestUInt LargestUInt;
+    const char *p = begin;
+    bool negative = *p == '-';
+    if (negative) {
+        ++p;
+    }
+    if (p == end) {
+        return false;
+    }
+    LargestUInt max_value = negative ? 
+        LargestUInt(Json::Value::maxLargestInt) + 1 : Json::Value::maxLargestUInt;
+    LargestUInt threshold = max_value / 10;
+    unsigned last_digit = static_cast<unsigned>(max_value % 10);
+    LargestUInt number = 0;
+    for (; p != end; ++p) {
+        unsigned digit = static_cast<unsigned>(*p - '0');
+        if (number >= threshold && 
+            (number > threshold || p + 1 != end || digit > last_digit)) {
+            return DecodeDouble(begin, end, value);
+        }
+        number = number * 10 + digit;
+    }
+    if (negative && number == max_value) {
+        value = Json::Value(Json::Value::minLargestInt);
+    } else if (negative) {
+        value = Json::Value(-Json::Value::LargestInt(number));
+    } else if (number <= LargestUInt(Json::Value::maxInt)) {
+        value = Json::Value(Json::Value::LargestInt(number));
+    } else {
+        value = Json::Value(number);
+    }
+    return true;
+}
+
+bool JsonIndex::ScalarValue(uint32_t i, Json::Value &value) const {
+    const Node &node = nodes_[i];
+    switch (node.type) {
+    case NULL_VALUE:
+        value = Json::Value();
+        return true;
+    case TRUE_VALUE:
+        value = Json::Value(true);
+        return true;
+    case FALSE_VALUE:
+        value = Json::Value(false);
+        return true;
+    case NUMBER_VALUE:
+        return DecodeNumber(data_ + node.begin, data_ + node.end, value);
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "base/strings/string_piece.h"
+
+#include "json/json.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * 顶层JSON对象的流式扫描：不构建DOM，只定位指定key的字符串值在原始数据中的位置
+ * 用于从请求体中直接取出几MB的image_base64，其余的小字段再交给jsoncpp解析
+ */
+struct JsonStringSpan {
+    bool found{false};    // key存在且值为字符串
+    bool escaped{false};  // 值中包含转义字符，不能直接使用原始数据
+    size_t begin{0};      // 值(不含引号)在数据中的起始位置
+    size_t end{0};
+    // 删除整个成员(key、值和相邻的一个逗号)的区间，删除后仍是合法的JSON对象
+    size_t member_begin{0};
+    size_t member_end{0};
+};
+
+/**
+ * 扫描顶层JSON对象，查找key对应的字符串值
+ * 返回false表示数据不是能识别的JSON对象，或者key出现了多次，调用方应回退到完整解析
+ */
+bool ScanJsonStringField(const base::StringPiece &json, 
+                         const std::string &key, 
+                         JsonStringSpan &span);
+
+/**
+ * 只读的JSON索引：一次扫描记录每个值在原始数据中的位置和层级关系，不拷贝字符串、不建map
+ * 用于按固定格式转换较大的JSON(例如模型输出)，代替jsoncpp解析后再逐个取值
+ * 1.数字按需转换为Json::Value，类型(int/uint/double)与Json::Reader一致
+ * 2.同一对象中重复的key取最后一个，与Json::Reader一致
+ * 3.注释、key中的转义等少见的格式Parse返回false，调用方回退到jsoncpp；非法的转义(例如不完整的代理对)同样返回false
+ * 4.词法扫描与ScanJsonStringField共用同一个Scanner
+ */
+class JsonIndex {
+public:
+    enum Type : uint8_t {
+        NULL_VALUE, TRUE_VALUE, FALSE_VALUE, NUMBER_VALUE, STRING_VALUE, ARRAY_VALUE, OBJECT_VALUE
+    };
+
+    struct Node {
+        Type type;
+        bool escaped;        // 字符串中有转义字符
+        uint32_t begin;      // 值的区间，字符串不含引号
+        uint32_t end;
+        uint32_t key_begin;  // 对象成员的key(不含引号)
+        uint32_t key_end;
+        uint32_t child;      // 第一个子节点
+        uint32_t next;       // 下一个兄弟节点
+        uint32_t size;       // 子节点数
+    };
+
+    static const uint32_t kNone = 0xffffffff;
+
+public:
+    bool Parse(const base::StringPiece &json);
+
+    uint32_t Root() const { return 0; }
+    const Node &Get(uint32_t i) const { return nodes_[i]; }
+    Type TypeOf(uint32_t i) const { return nodes_[i].type; }
+    // 对象、数组的子节点数，其他类型为0(与Json::Value::size一致)
+    uint32_t Size(uint32_t i) const { return nodes_[i].size; }
+    uint32_t Child(uint32_t i) const { return nodes_[i].child; }
+    uint32_t Next(uint32_t i) const { return nodes_[i].next; }
+
+    // 对象中key对应的节点，不是对象或没有此key时返回kNone
+    uint32_t Find(uint32_t object, const base::StringPiece &key) const;
+
+    // 字符串的值：没有转义时直接指向原始数据，否则解码到scratch
+    bool StringValue(uint32_t i, std::string &scratch, base::StringPiece &value) const;
+    // 数字、true/false/null转换为Json::Value
+    bool ScalarValue(uint32_t i, Json::Value &value) const;
+
+private:
+    const char *data_{nullptr};
+    size_t size_{0};
+    std::vector<Node> nodes_;
+};
@@ -51,3 +51,18 @@ void KafkaClient::SendMsg(const std::string &msg) {
         std::cout<<"mq send msg error" << std::endl;
     }
 }
+
+bool KafkaClient::Flush(std::chrono::milliseconds timeout) {
+    if (!p_producer_) {
+        return true;
+    }
+    try {
+        p_producer_->flush(timeout);
+        return true;
+    } catch (const std::exception &e) {
+        std::cout<<"mq flush exception: "<< e.what() << std::endl;
+    } catch (...) {
+        std::cout<<"mq flush error" << std::endl;
+    }
+    return false;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
 #include <mutex>
 #include "cppkafka/cppkafka.h"
@@ -16,6 +17,8 @@ public:
     static KafkaClient *GetInstance();
 
     void SendMsg(const std::string &msg);
+    // 等待队列中的消息发送完成，超时返回false
+    bool Flush(std::chrono::milliseconds timeout);
     std::string &Topic() { return m_topic_; }
 
 private:
@@ -0,0 +1,105 @@
+#include "metrics.h"
+
+
+/**
+ * 注册表使用函数内的静态变量：其他文件的全局变量初始化时就可能调用GetCounter，
+ * 不能依赖不同文件间全局变量的初始化顺序
+ */
+std::mutex &Metrics::Lock() {
+    static std::mutex lock;
+    return lock;
+}
+
+std::map<std::string, std::unique_ptr<Metrics::Counter>> &Metrics::Counters() {
+    static std::map<std::string, std::unique_ptr<Counter>> counters;
+    return counters;
+}
+
+std::map<std::string, std::function<double()>> &Metrics::Gauges() {
+    static std::map<std::string, std::function<double()>> gauges;
+    return gauges;
+}
+
+std::map<std::string, std::unique_ptr<Metrics::Histogram>> &Metrics::Histograms() {
+    static std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    return histograms;
+}
+
+Metrics::Histogram::Histogram(const std::vector<uint64_t> &bounds) : 
+    bounds_(bounds), buckets_(new std::atomic<uint64_t>[bounds.size() + 1]) {
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::Observe(uint64_t value) {
+    size_t i = 0;
+    while (i < bounds_.size() && value > bounds_[i]) {
+        ++i;
+    }
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+Metrics::Counter *Metrics::GetCounter(const std::string &name) {
+    std::lock_guard<std::mutex> guard(Lock());
+    auto &counter = Counters()[name];
+    if (!counter) {
+        counter.reset(new Counter);
+    }
+    return counter.get();
+}
+
+void Metrics::SetGauge(const std::string &name, std::function<double()> func) {
+    std::lock_guard<std::mutex> guard(Lock());
+    Gauges()[name] = std::move(func);
+}
+
+Metrics::Histogram *Metrics::GetHistogram(const std::string &name, 
+                                          const std::vector<uint64_t> &bounds) {
+    std::lock_guard<std::mutex> guard(Lock());
+    auto &histogram = Histograms()[name];
+    if (!histogram) {
+        histogram.reset(new Histogram(bounds));
+    }
+    return histogram.get();
+}
+
+std::string Metrics::Export() {
+    std::string text;
+    std::string last_name;
+    std::lock_guard<std::mutex> guard(Lock());
+    // map按名称排序，同名不同label的计数相邻，只输出一次TYPE
+    for (auto &item : Counters()) {
+        std::string name = item.first.substr(0, item.first.find('{'));
+        if (name != last_name) {
+            text += "# TYPE " + name + " counter\n";
+            last_name = name;
+        }
+        text += item.first + " " + std::to_string(item.second->Value()) + "\n";
+    }
+    for (auto &item : Gauges()) {
+        std::string name = item.first.substr(0, item.first.find('{'));
+        if (name != last_name) {
+            text += "# TYPE " + name + " gauge\n";
+            last_name = name;
+        }
+        text += item.first + " " + std::to_string(item.second()) + "\n";
+    }
+    for (auto &item : Histograms()) {
+        auto &histogram = *item.second;
+        text += "# TYPE " + item.first + " histogram\n";
+        uint64_t count = 0;
+        for (size_t i = 0; i <= histogram.bounds_.size(); ++i) {
+            count += histogram.buckets_[i].load(std::memory_order_relaxed);
+            std::string le = i < histogram.bounds_.size() ? 
+                std::to_string(histogram.bounds_[i]) : "+Inf";
+            text += item.first + "_bucket{le=\"" + le + "\"} " + 
+                std::to_string(count) + "\n";
+        }
+        text += item.first + "_sum " + 
+            std::to_string(histogram.sum_.load(std::memory_order_relaxed)) + "\n";
+        text += item.first + "_count " + std::to_string(count) + "\n";
+    }
+    return text;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+/**
+ * 进程内的指标计数，通过/metrics接口以prometheus文本格式导出
+ * 名称可以带label，例如：image_reject_total{reason="too_large"}
+ * 使用方式：频繁调用的位置保存GetCounter返回的指针，指针在进程生命周期内有效
+ */
+class Metrics {
+public:
+    class Counter {
+    public:
+        void Add(uint64_t value = 1) { 
+            value_.fetch_add(value, std::memory_order_relaxed); 
+        }
+        uint64_t Value() const { 
+            return value_.load(std::memory_order_relaxed); 
+        }
+
+    private:
+        std::atomic<uint64_t> value_{0};
+    };
+
+    // 整数观测值的分布，导出为prometheus histogram(累计的bucket、sum、count)
+    class Histogram {
+    public:
+        explicit Histogram(const std::vector<uint64_t> &bounds);
+        void Observe(uint64_t value);
+
+    private:
+        friend class Metrics;
+        std::vector<uint64_t> bounds_;
+        // 每个bound一个桶，最后一个为+Inf；导出时再累加
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+        std::atomic<uint64_t> sum_{0};
+    };
+
+public:
+    static Counter *GetCounter(const std::string &name);
+    static void Add(const std::string &name, uint64_t value = 1) {
+        GetCounter(name)->Add(value);
+    }
+
+    // 导出时调用func取当前值，同名的gauge只保留最后一次注册的；func中不能再调用Metrics的接口
+    static void SetGauge(const std::string &name, std::function<double()> func);
+
+    // bounds为升序的bucket上界，同名的histogram以第一次注册的bounds为准；名称不能带label
+    static Histogram *GetHistogram(const std::string &name, const std::vector<uint64_t> &bounds);
+
+    // prometheus文本格式
+    static std::string Export();
+
+private:
+    static std::mutex &Lock();
+    static std::map<std::string, std::unique_ptr<Counter>> &Counters();
+    static std::map<std::string, std::function<double()>> &Gauges();
+    static std::map<std::string, std::unique_ptr<Histogram>> &Histograms();
+};
@@ -0,0 +1,141 @@
+#include "response_compress.h"
+#include "metrics.h"
+#include "threadpool.hpp"
+#include "base/logging.h"
+
+#include <ctime>
+#include <mutex>
+#include <cstdlib>
+#include <strings.h>
+#include "zlib.h"
+
+
+size_t ResponseCompressor::min_size_{0};
+int ResponseCompressor::level_{Z_DEFAULT_COMPRESSION};
+unsigned ResponseCompressor::threads_{1};
+
+// 压缩线程池，进程退出前不释放
+static std::ThreadPool *g_compress_pool{nullptr};
+static std::once_flag g_compress_pool_once;
+
+static Metrics::Counter *g_gzip = 
+    Metrics::GetCounter("response_compress_total{encoding=\"gzip\"}");
+static Metrics::Counter *g_deflate = 
+    Metrics::GetCounter("response_compress_total{encoding=\"deflate\"}");
+static Metrics::Counter *g_input_bytes = 
+    Metrics::GetCounter("response_compress_input_bytes_total");
+static Metrics::Counter *g_output_bytes = 
+    Metrics::GetCounter("response_compress_output_bytes_total");
+static Metrics::Counter *g_cpu_us = 
+    Metrics::GetCounter("response_compress_cpu_microseconds_total");
+
+static int64_t ThreadCpuMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void ResponseCompressor::Init(size_t min_size, int level, unsigned threads) {
+    min_size_ = min_size;
+    level_ = level >= 1 && level <= 9 ? level : Z_DEFAULT_COMPRESSION;
+    threads_ = threads > 0 ? threads : 1;
+    LOG(INFO) << "response compress: min_size=" << min_size_ 
+        << ", level=" << level_ << ", threads=" << threads_;
+}
+
+ResponseCompressor::Encoding ResponseCompressor::Negotiate(const std::string &accept_encoding) {
+    Encoding encoding = Encoding::NONE;
+    double best_q = 0.0;
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t comma = accept_encoding.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = accept_encoding.size();
+        }
+        std::string item = accept_encoding.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        size_t semicolon = item.find(';');
+        std::string name = item.substr(0, semicolon);
+        size_t begin = name.find_first_not_of(" \t");
+        size_t end = name.find_last_not_of(" \t");
+        if (begin == std::string::npos) {
+            continue;
+        }
+        name = name.substr(begin, end - begin + 1);
+        double q = 1.0;
+        if (semicolon != std::string::npos) {
+            size_t q_pos = item.find("q=", semicolon);
+            if (q_pos != std::string::npos) {
+                q = strtod(item.c_str() + q_pos + 2, nullptr);
+            }
+        }
+
+        Encoding current = Encoding::NONE;
+        if (strcasecmp(name.c_str(), "gzip") == 0 || 
+            strcasecmp(name.c_str(), "x-gzip") == 0) {
+            current = Encoding::GZIP;
+        } else if (strcasecmp(name.c_str(), "deflate") == 0) {
+            current = Encoding::DEFLATE;
+        } else {
+            continue;
+        }
+        if (q > best_q || (q == best_q && q > 0 && current == Encoding::GZIP)) {
+            encoding = current;
+            best_q = q;
+        }
+    }
+    return encoding;
+}
+
+const char *ResponseCompressor::Name(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::GZIP:
+        return "gzip";
+    case Encoding::DEFLATE:
+        return "deflate";
+    default:
+        return "identity";
+    }
+}
+
+bool ResponseCompressor::Compress(Encoding encoding, 
+                                  const std::string &data, 
+                                  std::string &compressed) {
+    if (encoding == Encoding::NONE) {
+        return false;
+    }
+    int64_t start = ThreadCpuMicros();
+
+    // HTTP的deflate为zlib格式(RFC 1950)，gzip在windowBits上加16
+    z_stream stream{};
+    int window_bits = encoding == Encoding::GZIP ? 15 + 16 : 15;
+    if (deflateInit2(&stream, level_, Z_DEFLATED, window_bits, 8, 
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    compressed.resize(deflateBound(&stream, data.size()));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&compressed[0]);
+    stream.avail_out = compressed.size();
+    int ret = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    g_cpu_us->Add(ThreadCpuMicros() - start);
+    if (ret != Z_STREAM_END || compressed.size() >= data.size()) {
+        return false;
+    }
+    (encoding == Encoding::GZIP ? g_gzip : g_deflate)->Add();
+    g_input_bytes->Add(data.size());
+    g_output_bytes->Add(compressed.size());
+    return true;
+}
+
+void ResponseCompressor::Submit(std::function<void()> task) {
+    std::call_once(g_compress_pool_once, []() {
+        g_compress_pool = new std::ThreadPool(threads_);
+    });
+    g_compress_pool->commit(std::move(task));
+}
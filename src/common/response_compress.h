@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <functional>
+
+
+/**
+ * 响应压缩：按Accept-Encoding协商gzip/deflate
+ * 1.小于最小长度的响应不压缩，压缩收益不足以抵消CPU开销
+ * 2.压缩在独立的线程池中执行，crow的io线程可以继续处理其他连接
+ * 3.指标：response_compress_total{encoding}、压缩前后的字节数(比值即压缩率)、
+ *   压缩消耗的CPU时间
+ */
+class ResponseCompressor {
+public:
+    enum class Encoding {NONE, GZIP, DEFLATE};
+
+public:
+    // min_size为0时不压缩；level为zlib的压缩级别1-9
+    static void Init(size_t min_size, int level, unsigned threads);
+
+    // 协商编码：取q值最大的，相同时优先gzip；identity或不支持时为NONE
+    static Encoding Negotiate(const std::string &accept_encoding);
+    static const char *Name(Encoding encoding);
+
+    static bool ShouldCompress(size_t size) {
+        return min_size_ > 0 && size >= min_size_;
+    }
+
+    // 压缩后不小于原数据时返回false
+    static bool Compress(Encoding encoding, 
+                         const std::string &data, 
+                         std::string &compressed);
+
+    // 在压缩线程池中执行
+    static void Submit(std::function<void()> task);
+
+private:
+    static size_t min_size_;
+    static int level_;
+    static unsigned threads_;
+};
@@ -0,0 +1,634 @@
+#include "response_writer.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+
+std::unique_ptr<ResponseWriter> ResponseWriter::Create(ResponseFormat format, 
+                                                       std::string &out) {
+    switch (format) {
+    case ResponseFormat::CBOR:
+        return std::unique_ptr<ResponseWriter>(new CborResponseWriter(out));
+    case ResponseFormat::MSGPACK:
+        return std::unique_ptr<ResponseWriter>(new MsgpackResponseWriter(out));
+    default:
+        return std::unique_ptr<ResponseWriter>(new JsonResponseWriter(out));
+    }
+}
+
+static std::string Trim(const std::string &value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+ResponseFormat ResponseWriter::FromAccept(const std::string &accept) {
+    // 取q值最大的支持的类型，q相同时取靠前的；application/json和*/*按JSON处理
+    ResponseFormat format = ResponseFormat::JSON;
+    double best_q = 0.0;
+    size_t pos = 0;
+    while (pos <= accept.size()) {
+        size_t comma = accept.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = accept.size();
+        }
+        std::string item = accept.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        size_t semicolon = item.find(';');
+        std::string type = Trim(item.substr(0, semicolon));
+        double q = 1.0;
+        if (semicolon != std::string::npos) {
+            size_t q_pos = item.find("q=", semicolon);
+            if (q_pos != std::string::npos) {
+                q = strtod(item.c_str() + q_pos + 2, nullptr);
+            }
+        }
+        if (q <= best_q) {
+            continue;
+        }
+
+        if (strcasecmp(type.c_str(), "application/cbor") == 0) {
+            format = ResponseFormat::CBOR;
+        } else if (strcasecmp(type.c_str(), "application/msgpack") == 0 || 
+                   strcasecmp(type.c_str(), "application/x-msgpack") == 0) {
+            format = ResponseFormat::MSGPACK;
+        } else if (strcasecmp(type.c_str(), "application/json") == 0 || 
+                   type == "*/*" || strcasecmp(type.c_str(), "application/*") == 0) {
+            format = ResponseFormat::JSON;
+        } else {
+            continue;
+        }
+        best_q = q;
+    }
+    return format;
+}
+
+const char *ResponseWriter::ContentType(ResponseFormat format) {
+    switch (format) {
+    case ResponseFormat::CBOR:
+        return "application/cbor";
+    case ResponseFormat::MSGPACK:
+        return "application/msgpack";
+    default:
+        return "application/json";
+    }
+}
+
+void JsonResponseWriter::Separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!first_.empty()) {
+        if (!first_.back()) {
+            out_ += ',';
+        }
+        first_.back() = false;
+    }
+}
+
+void JsonResponseWriter::Quote(const base::StringPiece &value) {
+    // 可打印ASCII且没有引号、反斜杠时不需要转义，各版本jsoncpp的结果相同
+    bool plain = true;
+    for (char c : value) {
+        if (c < 0x20 || c > 0x7E || c == '"' || c == '\\') {
+            plain = false;
+            break;
+        }
+    }
+    if (plain) {
+        out_ += '"';
+        out_.append(value.data(), value.size());
+        out_ += '"';
+    } else {
+        out_ += Json::valueToQuotedString(value.as_string().c_str());
+    }
+}
+
+void JsonResponseWriter::StartObject(size_t size) {
+    Separate();
+    out_ += '{';
+    first_.push_back(true);
+}
+
+void JsonResponseWriter::EndObject() {
+    out_ += '}';
+    first_.pop_back();
+}
+
+void JsonResponseWriter::StartArray(size_t size) {
+    Separate();
+    out_ += '[';
+    first_.push_back(true);
+}
+
+void JsonResponseWriter::EndArray() {
+    out_ += ']';
+    first_.pop_back();
+}
+
+void JsonResponseWriter::Key(const base::StringPiece &key) {
+    Separate();
+    Quote(key);
+    out_ += ':';
+    after_key_ = true;
+}
+
+void JsonResponseWriter::Null() {
+    Separate();
+    out_ += "null";
+}
+
+void JsonResponseWriter::String(const base::StringPiece &value) {
+    Separate();
+    Quote(value);
+}
+
+void JsonResponseWriter::Value(const Json::Value &value) {
+    switch (value.type()) {
+    case Json::nullValue:
+        Null();
+        break;
+    case Json::intValue:
+        Separate();
+        out_ += Json::valueToString(value.asLargestInt());
+        break;
+    case Json::uintValue:
+        Separate();
+        out_ += Json::valueToString(value.asLargestUInt());
+        break;
+    case Json::realValue:
+        Separate();
+        out_ += Json::valueToString(value.asDouble());
+        break;
+    case Json::booleanValue:
+        Separate();
+        out_ += value.asBool() ? "true" : "false";
+        break;
+    case Json::stringValue:
+        String(value.asString());
+        break;
+    default: {
+        // 对象、数组直接用FastWriter，去掉末尾的换行
+        Json::FastWriter writer;
+        std::string encoded = writer.write(value);
+        encoded.pop_back();
+        Raw(encoded);
+        break;
+    }
+    }
+}
+
+void JsonResponseWriter::Raw(const base::StringPiece &encoded) {
+    Separate();
+    out_.append(encoded.data(), encoded.size());
+}
+
+void JsonResponseWriter::Finish() {
+    out_ += '\n';
+}
+
+void BinaryResponseWriter::Value(const Json::Value &value) {
+    switch (value.type()) {
+    case Json::nullValue:
+        Null();
+        break;
+    case Json::intValue:
+        Int(value.asLargestInt());
+        break;
+    case Json::uintValue:
+        UInt(value.asLargestUInt());
+        break;
+    case Json::realValue:
+        Double(value.asDouble());
+        break;
+    case Json::booleanValue:
+        Bool(value.asBool());
+        break;
+    case Json::stringValue:
+        String(value.asString());
+        break;
+    case Json::arrayValue:
+        StartArray(value.size());
+        for (const auto &item : value) {
+            Value(item);
+        }
+        EndArray();
+        break;
+    case Json::objectValue:
+        // Json::Value的成员按key排序
+        StartObject(value.size());
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            Key(it.name());
+            Value(*it);
+        }
+        EndObject();
+        break;
+    }
+}
+
+void BinaryResponseWriter::Raw(const base::StringPiece &encoded) {
+    out_.append(encoded.data(), encoded.size());
+}
+
+void BinaryResponseWriter::BigEndian(uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out_ += static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+void BinaryResponseWriter::Float(double value, char float_tag, char double_tag) {
+    float narrow = static_cast<float>(value);
+    if (static_cast<double>(narrow) == value) {
+        uint32_t bits = 0;
+        memcpy(&bits, &narrow, sizeof(bits));
+        out_ += float_tag;
+        BigEndian(bits, 4);
+    } else {
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+        out_ += double_tag;
+        BigEndian(bits, 8);
+    }
+}
+
+void CborResponseWriter::Head(int major, uint64_t value) {
+    char type = static_cast<char>(major << 5);
+    if (value < 24) {
+        out_ += static_cast<char>(type | value);
+    } else if (value <= 0xFF) {
+        out_ += static_cast<char>(type | 24);
+        BigEndian(value, 1);
+    } else if (value <= 0xFFFF) {
+        out_ += static_cast<char>(type | 25);
+        BigEndian(value, 2);
+    } else if (value <= 0xFFFFFFFFULL) {
+        out_ += static_cast<char>(type | 26);
+        BigEndian(value, 4);
+    } else {
+        out_ += static_cast<char>(type | 27);
+        BigEndian(value, 8);
+    }
+}
+
+void CborResponseWriter::Null() {
+    out_ += '\xF6';
+}
+
+void CborResponseWriter::String(const base::StringPiece &value) {
+    Head(3, value.size());
+    out_.append(value.data(), value.size());
+}
+
+void CborResponseWriter::Bool(bool value) {
+    out_ += value ? '\xF5' : '\xF4';
+}
+
+void CborResponseWriter::Int(int64_t value) {
+    if (value >= 0) {
+        Head(0, static_cast<uint64_t>(value));
+    } else {
+        Head(1, static_cast<uint64_t>(-(value + 1)));
+    }
+}
+
+void CborResponseWriter::Double(double value) {
+    Float(value, '\xFA', '\xFB');
+}
+
+void MsgpackResponseWriter::StartObject(size_t size) {
+    if (size < 16) {
+        out_ += static_cast<char>(0x80 | size);
+    } else if (size <= 0xFFFF) {
+        out_ += '\xDE';
+        BigEndian(size, 2);
+    } else {
+        out_ += '\xDF';
+        BigEndian(size, 4);
+    }
+}
+
+void MsgpackResponseWriter::StartArray(size_t size) {
+    if (size < 16) {
+        out_ += static_cast<char>(0x90 | size);
+    } else if (size <= 0xFFFF) {
+        out_ += '\xDC';
+        BigEndian(size, 2);
+    } else {
+        out_ += '\xDD';
+        BigEndian(size, 4);
+    }
+}
+
+void MsgpackResponseWriter::Null() {
+    out_ += '\xC0';
+}
+
+void MsgpackResponseWriter::String(const base::StringPiece &value) {
+    size_t size = value.size();
+    if (size < 32) {
+        out_ += static_cast<char>(0xA0 | size);
+    } else if (size <= 0xFF) {
+        out_ += '\xD9';
+        BigEndian(size, 1);
+    } else if (size <= 0xFFFF) {
+        out_ += '\xDA';
+        BigEndian(size, 2);
+    } else {
+        out_ += '\xDB';
+        BigEndian(size, 4);
+    }
+    out_.append(value.data(), size);
+}
+
+void MsgpackResponseWriter::Bool(bool value) {
+    out_ += value ? '\xC3' : '\xC2';
+}
+
+void MsgpackResponseWriter::Int(int64_t value) {
+    if (value >= 0) {
+        UInt(static_cast<uint64_t>(value));
+    } else if (value >= -32) {
+        out_ += static_cast<char>(value);
+    } else if (value >= INT8_MIN) {
+        out_ += '\xD0';
+        BigEndian(static_cast<uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+        out_ += '\xD1';
+        BigEndian(static_cast<uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+        out_ += '\xD2';
+        BigEndian(static_cast<uint64_t>(value), 4);
+    } else {
+        out_ += '\xD3';
+        BigEndian(static_cast<uint64_t>(value), 8);
+    }
+}
+
+void MsgpackResponseWriter::UInt(uint64_t value) {
+    if (value < 0x80) {
+        out_ += static_cast<char>(value);
+    } else if (value <= 0xFF) {
+        out_ += '\xCC';
+        BigEndian(value, 1);
+    } else if (value <= 0xFFFF) {
+        out_ += '\xCD';
+        BigEndian(value, 2);
+    } else if (value <= 0xFFFFFFFFULL) {
+        out_ += '\xCE';
+        BigEndian(value, 4);
+    } else {
+        out_ += '\xCF';
+        BigEndian(value, 8);
+    }
+}
+
+void MsgpackResponseWriter::Double(double value) {
+    Float(value, '\xCA', '\xCB');
+}
+
+namespace {
+
+// 与Json::Reader的嵌套深度限制一致
+const int kMaxDepth = 1000;
+
+/**
+ * 读取CborResponseWriter/MsgpackResponseWriter输出的数据，按事件写入JSON
+ * 只支持两者会输出的类型
+ */
+class BinaryReader {
+public:
+    BinaryReader(ResponseFormat format, const base::StringPiece &data, ResponseWriter &json)
+        : format_{format}, 
+          data_{reinterpret_cast<const uint8_t *>(data.data())}, 
+          size_{data.size()}, 
+          json_(json) {}
+
+    bool Read() {
+        if (!Item(0, false) || pos_ != size_) {
+            return false;
+        }
+        json_.Finish();
+        return true;
+    }
+
+private:
+    bool Byte(uint8_t &value) {
+        if (pos_ >= size_) {
+            return false;
+        }
+        value = data_[pos_++];
+        return true;
+    }
+
+    bool BigEndian(int bytes, uint64_t &value) {
+        if (size_ - pos_ < static_cast<size_t>(bytes)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value = (value << 8) | data_[pos_++];
+        }
+        return true;
+    }
+
+    bool Float(int bytes, double &value) {
+        uint64_t bits = 0;
+        if (!BigEndian(bytes, bits)) {
+            return false;
+        }
+        if (bytes == 4) {
+            uint32_t narrow_bits = static_cast<uint32_t>(bits);
+            float narrow = 0;
+            memcpy(&narrow, &narrow_bits, sizeof(narrow));
+            value = narrow;
+        } else {
+            memcpy(&value, &bits, sizeof(value));
+        }
+        return true;
+    }
+
+    // key为true时当前值必须是字符串，写为对象的key
+    bool Text(uint64_t size, bool key) {
+        if (size > size_ - pos_) {
+            return false;
+        }
+        base::StringPiece value(reinterpret_cast<const char *>(data_ + pos_), size);
+        pos_ += size;
+        if (key) {
+            json_.Key(value);
+        } else {
+            json_.String(value);
+        }
+        return true;
+    }
+
+    bool Container(int depth, bool object, uint64_t size) {
+        // 每个元素至少一个字节，防止长度字段异常时循环过多
+        if (depth >= kMaxDepth || size > size_ - pos_) {
+            return false;
+        }
+        if (object) {
+            json_.StartObject(size);
+        } else {
+            json_.StartArray(size);
+        }
+        for (uint64_t i = 0; i < size; ++i) {
+            if ((object && !Item(depth + 1, true)) || !Item(depth + 1, false)) {
+                return false;
+            }
+        }
+        if (object) {
+            json_.EndObject();
+        } else {
+            json_.EndArray();
+        }
+        return true;
+    }
+
+    bool Item(int depth, bool key) {
+        return format_ == ResponseFormat::CBOR ? Cbor(depth, key) : Msgpack(depth, key);
+    }
+
+    bool Cbor(int depth, bool key) {
+        uint8_t head = 0;
+        if (!Byte(head)) {
+            return false;
+        }
+        int major = head >> 5;
+        int info = head & 0x1F;
+        if (major == 7) {
+            double real = 0.0;
+            if (key) {
+                return false;
+            }
+            switch (head) {
+            case 0xF4: json_.Value(Json::Value(false)); return true;
+            case 0xF5: json_.Value(Json::Value(true)); return true;
+            case 0xF6: json_.Null(); return true;
+            case 0xFA: 
+            case 0xFB: 
+                if (!Float(head == 0xFA ? 4 : 8, real)) {
+                    return false;
+                }
+                json_.Value(Json::Value(real));
+                return true;
+            default: return false;
+            }
+        }
+
+        uint64_t value = info;
+        if (info >= 24 && (info > 27 || !BigEndian(1 << (info - 24), value))) {
+            return false;
+        }
+        if (key && major != 3) {
+            return false;
+        }
+        switch (major) {
+        case 0:
+            json_.Value(Json::Value(static_cast<Json::UInt64>(value)));
+            return true;
+        case 1:
+            if (value > static_cast<uint64_t>(INT64_MAX)) {
+                return false;
+            }
+            json_.Value(Json::Value(-1 - static_cast<Json::Int64>(value)));
+            return true;
+        case 3:
+            return Text(value, key);
+        case 4:
+            return Container(depth, false, value);
+        case 5:
+            return Container(depth, true, value);
+        default:
+            return false;
+        }
+    }
+
+    bool Msgpack(int depth, bool key) {
+        uint8_t head = 0;
+        if (!Byte(head)) {
+            return false;
+        }
+        uint64_t value = 0;
+        if ((head >= 0xA0 && head <= 0xBF) || (head >= 0xD9 && head <= 0xDB)) {
+            if (head <= 0xBF) {
+                value = head & 0x1F;
+            } else if (!BigEndian(1 << (head - 0xD9), value)) {
+                return false;
+            }
+            return Text(value, key);
+        }
+        if (key) {
+            return false;
+        }
+
+        double real = 0.0;
+        if (head <= 0x7F) {
+            json_.Value(Json::Value(static_cast<Json::UInt64>(head)));
+        } else if (head >= 0xE0) {
+            json_.Value(Json::Value(static_cast<Json::Int64>(static_cast<int8_t>(head))));
+        } else if (head <= 0x8F) {
+            return Container(depth, true, head & 0x0F);
+        } else if (head <= 0x9F) {
+            return Container(depth, false, head & 0x0F);
+        } else if (head == 0xC0) {
+            json_.Null();
+        } else if (head == 0xC2 || head == 0xC3) {
+            json_.Value(Json::Value(head == 0xC3));
+        } else if (head == 0xCA || head == 0xCB) {
+            if (!Float(head == 0xCA ? 4 : 8, real)) {
+                return false;
+            }
+            json_.Value(Json::Value(real));
+        } else if (head >= 0xCC && head <= 0xCF) {
+            if (!BigEndian(1 << (head - 0xCC), value)) {
+                return false;
+            }
+            json_.Value(Json::Value(static_cast<Json::UInt64>(value)));
+        } else if (head >= 0xD0 && head <= 0xD3) {
+            int bytes = 1 << (head - 0xD0);
+            if (!BigEndian(bytes, value)) {
+                return false;
+            }
+            // 按字节数做符号扩展
+            int shift = 64 - bytes * 8;
+            int64_t number = static_cast<int64_t>(value << shift) >> shift;
+            json_.Value(Json::Value(static_cast<Json::Int64>(number)));
+        } else if (head == 0xDC || head == 0xDD) {
+            return BigEndian(head == 0xDC ? 2 : 4, value) && Container(depth, false, value);
+        } else if (head == 0xDE || head == 0xDF) {
+            return BigEndian(head == 0xDE ? 2 : 4, value) && Container(depth, true, value);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    ResponseFormat format_;
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_{0};
+    ResponseWriter &json_;
+};
+
+}  // namespace
+
+bool ResponseWriter::ToJson(ResponseFormat format, 
+                            const base::StringPiece &encoded, 
+                            std::string &json) {
+    json.clear();
+    JsonResponseWriter writer(json);
+    if (format == ResponseFormat::JSON) {
+        writer.Raw(encoded);
+        return true;
+    }
+    BinaryReader reader(format, encoded, writer);
+    return reader.Read();
+}
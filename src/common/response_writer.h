@@ -0,0 +1,150 @@
+#pragma once
+
+#include "base/strings/string_piece.h"
+#include "json/json.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+
+enum class ResponseFormat {JSON, CBOR, MSGPACK};
+
+/**
+ * 按事件直接输出响应的字节，代替构建Json::Value后再序列化
+ * 1.对象的key由调用方按字典序输出，与Json::Value(std::map)序列化的顺序一致
+ * 2.容器的元素个数在开始时给出，JSON不使用，二进制格式需要写在头部
+ * 3.Raw写入同一格式已经编码好的完整值，用于拼接分别生成的片段
+ * 4.CBOR/MessagePack与JSON的结构相同，整数、浮点数按原始类型编码，
+ *   浮点数能无损表示为float时使用4字节
+ */
+class ResponseWriter {
+public:
+    static std::unique_ptr<ResponseWriter> Create(ResponseFormat format, 
+                                                  std::string &out);
+
+    // 按Accept头协商格式：application/cbor、application/msgpack，其他情况为JSON
+    static ResponseFormat FromAccept(const std::string &accept);
+    static const char *ContentType(ResponseFormat format);
+
+    /**
+     * 二进制格式的响应转换为JSON，结果与直接输出JSON一致
+     * 用于数据流等只接受JSON的地方，数据不是本类输出的格式时返回false
+     */
+    static bool ToJson(ResponseFormat format, 
+                       const base::StringPiece &encoded, 
+                       std::string &json);
+
+    virtual ~ResponseWriter() {}
+
+    virtual void StartObject(size_t size) = 0;
+    virtual void EndObject() = 0;
+    virtual void StartArray(size_t size) = 0;
+    virtual void EndArray() = 0;
+    virtual void Key(const base::StringPiece &key) = 0;
+
+    virtual void Null() = 0;
+    // UTF-8字符串
+    virtual void String(const base::StringPiece &value) = 0;
+    // 任意的Json::Value，标量按原始类型输出
+    virtual void Value(const Json::Value &value) = 0;
+    virtual void Raw(const base::StringPiece &encoded) = 0;
+
+    // 整个响应结束，JSON与Json::FastWriter一样以换行结尾
+    virtual void Finish() {}
+};
+
+/**
+ * 输出与Json::FastWriter逐字节一致：数字、字符串的格式化使用jsoncpp的valueToString/valueToQuotedString
+ */
+class JsonResponseWriter : public ResponseWriter {
+public:
+    explicit JsonResponseWriter(std::string &out) : out_(out) {}
+
+    void StartObject(size_t size) override;
+    void EndObject() override;
+    void StartArray(size_t size) override;
+    void EndArray() override;
+    void Key(const base::StringPiece &key) override;
+
+    void Null() override;
+    void String(const base::StringPiece &value) override;
+    void Value(const Json::Value &value) override;
+    void Raw(const base::StringPiece &encoded) override;
+    void Finish() override;
+
+private:
+    // 值之前的逗号
+    void Separate();
+    void Quote(const base::StringPiece &value);
+
+private:
+    std::string &out_;
+    std::vector<bool> first_;  // 每层容器是否还没有元素
+    bool after_key_{false};
+};
+
+/**
+ * CBOR(RFC 7049)和MessagePack的公共部分：定长容器，不需要分隔符和结束标记
+ */
+class BinaryResponseWriter : public ResponseWriter {
+public:
+    explicit BinaryResponseWriter(std::string &out) : out_(out) {}
+
+    void EndObject() override {}
+    void EndArray() override {}
+    void Key(const base::StringPiece &key) override { String(key); }
+    void Value(const Json::Value &value) override;
+    void Raw(const base::StringPiece &encoded) override;
+
+protected:
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int64_t value) = 0;
+    virtual void UInt(uint64_t value) = 0;
+    virtual void Double(double value) = 0;
+
+    // 大端序写入value的低bytes个字节
+    void BigEndian(uint64_t value, int bytes);
+    void Float(double value, char float_tag, char double_tag);
+
+protected:
+    std::string &out_;
+};
+
+class CborResponseWriter : public BinaryResponseWriter {
+public:
+    explicit CborResponseWriter(std::string &out) : BinaryResponseWriter(out) {}
+
+    void StartObject(size_t size) override { Head(5, size); }
+    void StartArray(size_t size) override { Head(4, size); }
+    void Null() override;
+    void String(const base::StringPiece &value) override;
+
+protected:
+    void Bool(bool value) override;
+    void Int(int64_t value) override;
+    void UInt(uint64_t value) override { Head(0, value); }
+    void Double(double value) override;
+
+private:
+    // major type和长度/数值
+    void Head(int major, uint64_t value);
+};
+
+class MsgpackResponseWriter : public BinaryResponseWriter {
+public:
+    explicit MsgpackResponseWriter(std::string &out) : BinaryResponseWriter(out) {}
+
+    void StartObject(size_t size) override;
+    void StartArray(size_t size) override;
+    void Null() override;
+    void String(const base::StringPiece &value) override;
+
+protected:
+    void Bool(bool value) override;
+    void Int(int64_t value) override;
+    void UInt(uint64_t value) override;
+    void Double(double value) override;
+};
@@ -0,0 +1,382 @@
+#include "stream_decoder.h"
+#include "metrics.h"
+
+#include <cstdio>
+#include <csetjmp>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include "jpeglib.h"
+#include "png.h"
+
+
+// 与CheckImageSize的上限一致，超出的图片会被拒绝，不必解码
+static const int kMaxSide = 4096;
+
+static Metrics::Counter *g_streamed =
+    Metrics::GetCounter("image_stream_decode_total{result=\"streamed\"}");
+static Metrics::Counter *g_fallback =
+    Metrics::GetCounter("image_stream_decode_total{result=\"fallback\"}");
+
+struct StreamDecoder::Impl {
+    virtual ~Impl() {}
+    // 处理新到达的数据，出错或格式不支持时返回false
+    virtual bool Feed(const std::string &data) = 0;
+    virtual bool Done() const = 0;
+
+    cv::Mat image;
+    int scale{1};
+};
+
+namespace {
+
+struct JpegError {
+    jpeg_error_mgr pub;
+    jmp_buf jmp;
+};
+
+struct JpegSource {
+    jpeg_source_mgr pub;
+    size_t skip{0};  // skip_input_data超出已有数据的部分，新数据到达时跳过
+};
+
+void JpegErrorExit(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jmp, 1);
+}
+
+void JpegOutputMessage(j_common_ptr cinfo) {
+}
+
+void JpegInitSource(j_decompress_ptr cinfo) {
+}
+
+// 没有更多数据时挂起，libjpeg回退到可以重新开始的位置
+boolean JpegFillInputBuffer(j_decompress_ptr cinfo) {
+    return FALSE;
+}
+
+void JpegSkipInputData(j_decompress_ptr cinfo, long num_bytes) {
+    if (num_bytes <= 0) {
+        return;
+    }
+    auto src = reinterpret_cast<JpegSource *>(cinfo->src);
+    size_t num = static_cast<size_t>(num_bytes);
+    if (num <= src->pub.bytes_in_buffer) {
+        src->pub.next_input_byte += num;
+        src->pub.bytes_in_buffer -= num;
+    } else {
+        src->skip += num - src->pub.bytes_in_buffer;
+        src->pub.next_input_byte += src->pub.bytes_in_buffer;
+        src->pub.bytes_in_buffer = 0;
+    }
+}
+
+void JpegTermSource(j_decompress_ptr cinfo) {
+}
+
+uint16_t ReadU16(const uint8_t *p, bool big_endian) {
+    return big_endian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+}
+
+uint32_t ReadU32(const uint8_t *p, bool big_endian) {
+    return big_endian ?
+        (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3] :
+        (uint32_t(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+// APP1中EXIF的Orientation，没有时返回1
+int ExifOrientation(j_decompress_ptr cinfo) {
+    for (auto marker = cinfo->marker_list; marker; marker = marker->next) {
+        const uint8_t *data = marker->data;
+        size_t len = marker->data_length;
+        if (marker->marker != JPEG_APP0 + 1 || len < 14 ||
+            std::memcmp(data, "Exif\0\0", 6) != 0) {
+            continue;
+        }
+        const uint8_t *tiff = data + 6;
+        len -= 6;
+        bool big_endian = tiff[0] == 'M';
+        uint32_t ifd = ReadU32(tiff + 4, big_endian);
+        if (ifd + 2 > len) {
+            return 1;
+        }
+        uint16_t count = ReadU16(tiff + ifd, big_endian);
+        for (uint16_t i = 0; i < count; ++i) {
+            size_t entry = ifd + 2 + i * 12;
+            if (entry + 12 > len) {
+                break;
+            }
+            if (ReadU16(tiff + entry, big_endian) == 0x0112) {
+                return ReadU16(tiff + entry + 8, big_endian);
+            }
+        }
+        return 1;
+    }
+    return 1;
+}
+
+/**
+ * 挂起式数据源：数据不足时libjpeg返回JPEG_SUSPENDED，新数据到达后从回退的位置继续
+ * 缓冲区追加数据时可能重新分配，因此只记录已消费的偏移
+ */
+class JpegStream : public StreamDecoder::Impl {
+public:
+    explicit JpegStream(int target_side) : target_side_{target_side} {
+        cinfo_.err = jpeg_std_error(&err_.pub);
+        err_.pub.error_exit = JpegErrorExit;
+        err_.pub.output_message = JpegOutputMessage;
+        jpeg_create_decompress(&cinfo_);
+        src_.pub.init_source = JpegInitSource;
+        src_.pub.fill_input_buffer = JpegFillInputBuffer;
+        src_.pub.skip_input_data = JpegSkipInputData;
+        src_.pub.resync_to_restart = jpeg_resync_to_restart;
+        src_.pub.term_source = JpegTermSource;
+        src_.pub.next_input_byte = nullptr;
+        src_.pub.bytes_in_buffer = 0;
+        cinfo_.src = &src_.pub;
+        jpeg_save_markers(&cinfo_, JPEG_APP0 + 1, 0xffff);
+    }
+
+    ~JpegStream() override {
+        jpeg_destroy_decompress(&cinfo_);
+    }
+
+    bool Feed(const std::string &data) override {
+        size_t pos = offset_;
+        if (src_.skip > 0) {
+            size_t n = std::min(src_.skip, data.size() - pos);
+            pos += n;
+            src_.skip -= n;
+        }
+        auto base = reinterpret_cast<const JOCTET *>(data.data());
+        src_.pub.next_input_byte = base + pos;
+        src_.pub.bytes_in_buffer = data.size() - pos;
+        bool res = Step();
+        offset_ = src_.pub.next_input_byte - base;
+        return res;
+    }
+
+    bool Done() const override {
+        return stage_ == Stage::DONE;
+    }
+
+private:
+    // 尽可能向前解码，libjpeg出错时longjmp回到这里；此函数内不能有需要析构的局部对象
+    bool Step() {
+        if (setjmp(err_.jmp)) {
+            return false;
+        }
+        if (stage_ == Stage::HEADER) {
+            if (jpeg_read_header(&cinfo_, TRUE) == JPEG_SUSPENDED) {
+                return true;
+            }
+            // CMYK需要额外转换、EXIF旋转需要在解码后处理，交给imdecode
+            if (cinfo_.num_components == 4 || ExifOrientation(&cinfo_) > 1 ||
+                cinfo_.image_width > kMaxSide || cinfo_.image_height > kMaxSide) {
+                return false;
+            }
+            scale = StreamDecoder::JpegScale(cinfo_.image_width,
+                                             cinfo_.image_height,
+                                             target_side_);
+            cinfo_.scale_num = 1;
+            cinfo_.scale_denom = scale;
+            cinfo_.out_color_space = JCS_EXT_BGR;
+            cinfo_.out_color_components = 3;
+            stage_ = Stage::START;
+        }
+        if (stage_ == Stage::START) {
+            // 渐进式JPEG在这里读完所有扫描
+            if (!jpeg_start_decompress(&cinfo_)) {
+                return true;
+            }
+            image.create(cinfo_.output_height, cinfo_.output_width, CV_8UC3);
+            stage_ = Stage::SCANLINES;
+        }
+        while (stage_ == Stage::SCANLINES &&
+               cinfo_.output_scanline < cinfo_.output_height) {
+            JSAMPROW row = image.ptr(cinfo_.output_scanline);
+            if (jpeg_read_scanlines(&cinfo_, &row, 1) == 0) {
+                return true;
+            }
+        }
+        stage_ = Stage::DONE;
+        return true;
+    }
+
+private:
+    enum class Stage {HEADER, START, SCANLINES, DONE};
+
+    int target_side_;
+    Stage stage_{Stage::HEADER};
+    size_t offset_{0};
+    jpeg_decompress_struct cinfo_;
+    JpegError err_;
+    JpegSource src_;
+};
+
+/**
+ * libpng的progressive读取：数据全部交给libpng，按行回调
+ * 转换与OpenCV的PNG解码(IMREAD_COLOR)一致：8位BGR，去掉alpha
+ */
+class PngStream : public StreamDecoder::Impl {
+public:
+    PngStream() {
+        png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        if (png_) {
+            info_ = png_create_info_struct(png_);
+        }
+        if (info_) {
+            png_set_progressive_read_fn(png_, this, OnInfo, OnRow, OnEnd);
+        }
+    }
+
+    ~PngStream() override {
+        png_destroy_read_struct(&png_, &info_, nullptr);
+    }
+
+    bool Feed(const std::string &data) override {
+        if (!info_) {
+            return false;
+        }
+        if (setjmp(png_jmpbuf(png_))) {
+            return false;
+        }
+        auto base = reinterpret_cast<png_bytep>(const_cast<char *>(data.data()));
+        png_process_data(png_, info_, base + offset_, data.size() - offset_);
+        offset_ = data.size();
+        return true;
+    }
+
+    bool Done() const override {
+        return done_;
+    }
+
+private:
+    static void OnInfo(png_structp png, png_infop info) {
+        auto self = static_cast<PngStream *>(png_get_progressive_ptr(png));
+        png_uint_32 width = 0, height = 0;
+        int bit_depth = 0, color_type = 0;
+        png_get_IHDR(png, info, &width, &height, &bit_depth, &color_type,
+                     nullptr, nullptr, nullptr);
+        if (width > kMaxSide || height > kMaxSide) {
+            png_error(png, "image too large for stream decode");
+        }
+
+        if (bit_depth == 16) {
+            png_set_strip_16(png);
+        }
+        png_set_strip_alpha(png);
+        if (color_type == PNG_COLOR_TYPE_PALETTE) {
+            png_set_palette_to_rgb(png);
+        }
+        if ((color_type & PNG_COLOR_MASK_COLOR) == 0 && bit_depth < 8) {
+            png_set_expand_gray_1_2_4_to_8(png);
+        }
+        if (color_type & PNG_COLOR_MASK_COLOR) {
+            png_set_bgr(png);
+        } else {
+            png_set_gray_to_rgb(png);
+        }
+        png_set_interlace_handling(png);
+        png_read_update_info(png, info);
+        if (png_get_rowbytes(png, info) != width * 3) {
+            png_error(png, "unexpected row bytes");
+        }
+        self->image.create(height, width, CV_8UC3);
+    }
+
+    static void OnRow(png_structp png, png_bytep new_row,
+                      png_uint_32 row_num, int pass) {
+        auto self = static_cast<PngStream *>(png_get_progressive_ptr(png));
+        if (new_row && row_num < static_cast<png_uint_32>(self->image.rows)) {
+            // 隔行扫描时与之前的pass合并
+            png_progressive_combine_row(png, self->image.ptr(row_num), new_row);
+        }
+    }
+
+    static void OnEnd(png_structp png, png_infop info) {
+        static_cast<PngStream *>(png_get_progressive_ptr(png))->done_ = true;
+    }
+
+private:
+    png_structp png_{nullptr};
+    png_infop info_{nullptr};
+    size_t offset_{0};
+    bool done_{false};
+};
+
+}  // namespace
+
+StreamDecoder::StreamDecoder(int target_side) : target_side_{target_side} {
+}
+
+StreamDecoder::~StreamDecoder() {
+}
+
+void StreamDecoder::Feed(const std::string &data) {
+    if (failed_) {
+        return;
+    }
+    fed_data_ = data.data();
+    fed_size_ = data.size();
+    if (!impl_) {
+        if (data.size() < 8) {
+            return;
+        }
+        auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+        if (bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF) {
+            impl_.reset(new JpegStream(target_side_));
+        } else if (png_sig_cmp(bytes, 0, 8) == 0) {
+            impl_.reset(new PngStream);
+        } else {
+            failed_ = true;
+            return;
+        }
+    }
+    if (!impl_->Feed(data)) {
+        // 提前释放解码状态和已分配的图片
+        failed_ = true;
+        impl_.reset();
+    }
+}
+
+bool StreamDecoder::Finish(const std::string &data, cv::Mat &image, int &scale) {
+    if (!impl_ && !failed_) {
+        // 没有经过流式下载(例如base64)
+        return false;
+    }
+    bool done = impl_ && impl_->Done() &&
+                data.data() == fed_data_ && data.size() == fed_size_;
+    if (done) {
+        image = impl_->image;
+        scale = impl_->scale;
+        g_streamed->Add();
+    } else {
+        g_fallback->Add();
+    }
+    Reset();
+    return done;
+}
+
+void StreamDecoder::Reset() {
+    impl_.reset();
+    failed_ = false;
+    fed_data_ = nullptr;
+    fed_size_ = 0;
+}
+
+bool StreamDecoder::Active() const {
+    return !failed_ && impl_;
+}
+
+int StreamDecoder::JpegScale(int width, int height, int target_side) {
+    int scale = 1;
+    if (target_side <= 0) {
+        return scale;
+    }
+    int max_side = std::max(width, height);
+    while (scale < 8 && max_side / (scale * 2) >= target_side) {
+        scale *= 2;
+    }
+    return scale;
+}
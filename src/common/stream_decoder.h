@@ -0,0 +1,56 @@
+#pragma once
+
+#include "opencv2/core.hpp"
+
+#include <string>
+#include <memory>
+
+
+/**
+ * 边下载边解码：下载的数据到达时增量解码，数据接收完时大部分像素已经解码完成
+ * 1.JPEG：libjpeg的挂起式数据源，顺序JPEG逐行输出；
+ *   渐进式JPEG在数据到达时完成熵解码，最后做反量化和颜色转换
+ * 2.PNG：libpng的progressive读取接口，支持隔行扫描
+ * 3.其他格式、CMYK JPEG、带EXIF旋转的JPEG、解码出错时不再处理，
+ *   由调用方按缓冲的数据调用cv::imdecode，结果与imdecode(IMREAD_COLOR)一致
+ * 使用方式：
+ *     StreamDecoder decoder(target_side);
+ *     每次数据到达：decoder.Feed(data);  // data为目前收到的全部数据
+ *     接收完成：decoder.Finish(data, image, scale)返回false时走缓冲解码
+ */
+class StreamDecoder {
+public:
+    // target_side：同DecodeImage，大于0时较大的JPEG按1/2、1/4、1/8缩小解码
+    explicit StreamDecoder(int target_side = 0);
+    ~StreamDecoder();
+    StreamDecoder(const StreamDecoder &) = delete;
+    StreamDecoder &operator=(const StreamDecoder &) = delete;
+
+    // data为目前收到的全部数据(只会在末尾追加)，内部只记录已消费的偏移
+    void Feed(const std::string &data);
+
+    /**
+     * data为最终的完整数据，必须是Feed过的同一个缓冲区且没有新的数据，
+     * 解码完成时返回true并输出图片和缩小比例
+     */
+    bool Finish(const std::string &data, cv::Mat &image, int &scale);
+
+    // 重新开始(例如换一个URL重新下载)
+    void Reset();
+
+    // Feed过数据且没有放弃时为true
+    bool Active() const;
+
+    // libjpeg的DCT缩放比例：1/2/4/8，缩小后长边不小于target_side
+    static int JpegScale(int width, int height, int target_side);
+
+    struct Impl;
+
+private:
+    int target_side_;
+    bool failed_{false};
+    // 最近一次Feed的缓冲区，Finish时确认数据没有被替换(例如对冲请求的结果)
+    const char *fed_data_{nullptr};
+    size_t fed_size_{0};
+    std::unique_ptr<Impl> impl_;
+};
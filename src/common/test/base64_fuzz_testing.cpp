@@ -0,0 +1,120 @@
+#include "fast_base64.h"
+#include "third_party/modp_b64/modp_b64.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+using namespace std;
+
+/*
+ * FastBase64Decode与modp_b64的等价性测试：
+ * 1.随机数据的标准编码、随机篡改(非法字符、'='位置、截断)后的输入，两者的成功/失败和结果完全一致
+ * 2.插入空白、加data URI前缀后，解码结果与原始数据一致
+ * 每种实现(avx2/ssse3/scalar)分别测试
+ */
+
+static std::string modp_encode(const std::string &data) {
+	std::string out(modp_b64_encode_len(data.size()), '\0');
+	out.resize(modp_b64_encode(&out[0], data.data(), data.size()));
+	return out;
+}
+
+static bool modp_decode(const std::string &input, std::string &output) {
+	output.resize(modp_b64_decode_len(input.size()));
+	size_t size = modp_b64_decode(&output[0], input.data(), input.size());
+	if (size == MODP_B64_ERROR) {
+		return false;
+	}
+	output.resize(size);
+	return true;
+}
+
+static std::string random_bytes(std::mt19937 &rng, size_t size) {
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::string data(size, '\0');
+	for (auto &c : data) {
+		c = (char)byte(rng);
+	}
+	return data;
+}
+
+static void mutate(std::mt19937 &rng, std::string &input) {
+	if (input.empty()) {
+		return;
+	}
+	std::uniform_int_distribution<size_t> pos(0, input.size() - 1);
+	std::uniform_int_distribution<int> byte(0, 255);
+	switch (rng() % 4) {
+	case 0:
+		input[pos(rng)] = (char)byte(rng);
+		break;
+	case 1:
+		input[pos(rng)] = '=';
+		break;
+	case 2:
+		input.resize(pos(rng));
+		break;
+	default:
+		input.insert(pos(rng), 1, "A+/="[rng() % 4]);
+		break;
+	}
+}
+
+static std::string add_noise(std::mt19937 &rng, const std::string &input) {
+	static const char *spaces = " \t\r\n";
+	std::string out = rng() % 2 ? "data:image/jpeg;base64," : "";
+	for (size_t i = 0; i < input.size(); ++i) {
+		// 模拟MIME每76个字符换行以及随机位置的空白
+		if ((i > 0 && i % 76 == 0) || rng() % 97 == 0) {
+			out += i % 76 == 0 ? "\r\n" : std::string(1, spaces[rng() % 4]);
+		}
+		out += input[i];
+	}
+	return out + (rng() % 2 ? "\n" : "");
+}
+
+static int run(const std::string &impl, int rounds) {
+	if (!FastBase64SetImpl(impl)) {
+		std::cout << impl << " not supported, skip" << std::endl;
+		return 0;
+	}
+	std::mt19937 rng(20201016);
+	int failed = 0;
+	for (int i = 0; i < rounds && failed < 10; ++i) {
+		size_t size = rng() % 4 == 0 ? rng() % 8192 : rng() % 96;
+		std::string data = random_bytes(rng, size);
+		std::string encoded = modp_encode(data);
+		std::string input = encoded;
+		if (rng() % 2) {
+			mutate(rng, input);
+		}
+
+		std::string expect, actual;
+		bool expect_ok = modp_decode(input, expect);
+		bool actual_ok = FastBase64Decode(input, &actual);
+		if (expect_ok != actual_ok || (expect_ok && expect != actual)) {
+			std::cerr << impl << " mismatch with modp_b64, input: " << input.substr(0, 128)
+					<< ", modp: " << expect_ok << ", fast: " << actual_ok << std::endl;
+			++failed;
+			continue;
+		}
+
+		std::string noisy = add_noise(rng, encoded);
+		if (!FastBase64Decode(noisy, &actual) || actual != data) {
+			std::cerr << impl << " failed on whitespace/data uri input: " << noisy.substr(0, 128) << std::endl;
+			++failed;
+		}
+	}
+	std::cout << impl << ": " << rounds << " rounds, " << failed << " failed" << std::endl;
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	const int rounds = argc > 1 ? std::stoi(argv[1]) : 200000;
+	int failed = 0;
+	for (const auto &impl : {"scalar", "ssse3", "avx2"}) {
+		failed += run(impl, rounds);
+	}
+	return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,73 @@
+#include "fast_base64.h"
+#include "third_party/modp_b64/modp_b64.h"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * base64解码吞吐量：modp_b64 与 FastBase64Decode(avx2/ssse3/scalar)
+ * 输入为随机数据的标准编码，大小与客户端上传的图片相当(默认4MB)
+ */
+
+template <typename F>
+static void report(const std::string &name, size_t input_size, int repeat_count, F decode) {
+	std::vector<double> cost;
+	for (int i = 0; i < repeat_count; ++i) {
+		auto t0 = std::chrono::steady_clock::now();
+		if (!decode()) {
+			std::cerr << name << " decode failed" << std::endl;
+			return;
+		}
+		cost.emplace_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+	}
+	std::sort(cost.begin(), cost.end());
+	double sum = 0.0;
+	for (auto c : cost) {
+		sum += c;
+	}
+	double average = sum / cost.size();
+	std::cout << name << " average time: " << average << " ms"
+			<< ", p90 time: " << cost[(int)(0.9 * cost.size())]
+			<< ", throughput: " << input_size / average / 1000.0 << " MB/s" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	const size_t data_size = argc > 1 ? std::stoul(argv[1]) : (4 << 20);
+	const int repeat_count = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	std::mt19937 rng(1234);
+	std::string data(data_size, '\0');
+	for (auto &c : data) {
+		c = (char)(rng() & 0xff);
+	}
+	std::string encoded(modp_b64_encode_len(data.size()), '\0');
+	encoded.resize(modp_b64_encode(&encoded[0], data.data(), data.size()));
+	std::cout << "encoded size: " << encoded.size() << ", default impl: " << FastBase64Impl() << std::endl;
+
+	std::string output(modp_b64_decode_len(encoded.size()), '\0');
+	report("modp_b64", encoded.size(), repeat_count, [&]() {
+		return modp_b64_decode(&output[0], encoded.data(), encoded.size()) != MODP_B64_ERROR;
+	});
+	// 每76个字符换行的MIME格式，modp_b64不支持
+	std::string mime;
+	for (size_t i = 0; i < encoded.size(); i += 76) {
+		mime.append(encoded, i, 76).append("\r\n");
+	}
+	for (const auto &impl : {"scalar", "ssse3", "avx2"}) {
+		if (!FastBase64SetImpl(impl)) {
+			continue;
+		}
+		report(std::string("fast ") + impl, encoded.size(), repeat_count, [&]() {
+			return FastBase64Decode(&output[0], output.size(), encoded.data(), encoded.size()) != FAST_BASE64_ERROR;
+		});
+		report(std::string("fast ") + impl + " mime", mime.size(), repeat_count, [&]() {
+			return FastBase64Decode(&output[0], output.size(), mime.data(), mime.size()) != FAST_BASE64_ERROR;
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,124 @@
+#include "image_buffer.h"
+#include "third_party/modp_b64/modp_b64.h"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdlib>
+
+using namespace std;
+
+/*
+ * 图片接入阶段的内存峰值：旧路径与ImageBuffer路径对比
+ * 1.旧路径：Base64Decode解码到临时string再swap，DecodeImage逐字节push_back拷贝到vector<uchar>后imdecode
+ * 2.新路径：modp_b64直接解码到池化的ImageBuffer，用Mat头包装后imdecode
+ * 请求体和base64字符串两条路径都持有，只统计路径自身申请的内存(operator new)，
+ * 解码后的图片由OpenCV分配，按大小另外加上
+ */
+
+static size_t g_live = 0;
+static size_t g_peak = 0;
+
+void *operator new(size_t size) {
+	// 多申请16字节记录大小，保持对齐
+	char *p = static_cast<char *>(std::malloc(size + 16));
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<size_t *>(p) = size;
+	g_live += size;
+	if (g_live > g_peak) {
+		g_peak = g_live;
+	}
+	return p + 16;
+}
+
+void operator delete(void *ptr) noexcept {
+	if (!ptr) {
+		return;
+	}
+	char *p = static_cast<char *>(ptr) - 16;
+	g_live -= *reinterpret_cast<size_t *>(p);
+	std::free(p);
+}
+
+static std::string read_file(const std::string &path) {
+	std::ifstream ifs(path, std::ios::binary);
+	std::stringstream ss;
+	ss << ifs.rdbuf();
+	return ss.str();
+}
+
+// 旧路径，与改动前的GetImageData(base::Base64Decode) + DecodeImage一致
+static bool old_path(const std::string &image_base64, cv::Mat &image) {
+	std::string image_binary;
+	std::string temp;
+	temp.resize(modp_b64_decode_len(image_base64.size()));
+	size_t size = modp_b64_decode(&temp[0], image_base64.data(), image_base64.size());
+	if (size == MODP_B64_ERROR) {
+		return false;
+	}
+	temp.resize(size);
+	image_binary.swap(temp);
+
+	std::vector<uchar> buf;
+	for (const auto &item : image_binary) {
+		buf.push_back(item);
+	}
+	image = cv::imdecode(buf, cv::IMREAD_COLOR);
+	return !image.empty();
+}
+
+// 新路径，与ImageInterface::HandleImage中的ImageBuffer + GetImageData + DecodeImage一致
+static bool new_path(const std::string &image_base64, cv::Mat &image) {
+	ImageBuffer image_binary;
+	std::string &data = image_binary.Data();
+	data.resize(modp_b64_decode_len(image_base64.size()));
+	size_t size = modp_b64_decode(&data[0], image_base64.data(), image_base64.size());
+	if (size == MODP_B64_ERROR) {
+		return false;
+	}
+	data.resize(size);
+
+	const cv::Mat buf(1, static_cast<int>(data.size()), CV_8UC1, const_cast<char *>(data.data()));
+	image = cv::imdecode(buf, cv::IMREAD_COLOR);
+	return !image.empty();
+}
+
+template <typename F>
+static void report(const std::string &name, const std::string &image_base64, size_t held, F ingest) {
+	cv::Mat image;
+	size_t base = g_live;
+	g_peak = g_live;
+	if (!ingest(image_base64, image)) {
+		std::cerr << name << " decode failed" << std::endl;
+		return;
+	}
+	size_t path_peak = g_peak - base;
+	size_t image_bytes = image.total() * image.elemSize();
+	std::cout << name << " peak bytes: " << held + path_peak + image_bytes
+			<< ", path: " << path_peak
+			<< ", image: " << image_bytes << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " image_file" << std::endl;
+		return -1;
+	}
+	std::string image = read_file(argv[1]);
+	std::string image_base64(modp_b64_encode_len(image.size()), '\0');
+	image_base64.resize(modp_b64_encode(&image_base64[0], image.data(), image.size()));
+	std::string body = "{\"image_base64\":\"" + image_base64 + "\"}";
+	size_t held = body.size() + image_base64.capacity();
+	std::cout << "image size: " << image.size() << ", base64 size: " << image_base64.size() << std::endl;
+
+	report("old", image_base64, held, old_path);
+	// 冷启动：池为空，与旧路径一样需要新申请缓冲区
+	report("new (empty pool)", image_base64, held, new_path);
+	report("new (pooled)", image_base64, held, new_path);
+	return 0;
+}
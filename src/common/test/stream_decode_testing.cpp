@@ -0,0 +1,110 @@
+#include "stream_decoder.h"
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <random>
+
+using namespace std;
+
+/*
+ * StreamDecoder的一致性和耗时测试：
+ * 1.目录下每张图片按随机大小分块送入StreamDecoder，结果与cv::imdecode逐像素比较
+ *   (流式解码放弃的格式走imdecode，计为fallback)
+ * 2.按指定带宽模拟下载，对比"下载完再解码"和"边下载边解码"从开始到拿到图片的耗时
+ */
+
+static std::string read_file(const std::string &path) {
+	std::ifstream ifs(path, std::ios::binary);
+	std::stringstream ss;
+	ss << ifs.rdbuf();
+	return ss.str();
+}
+
+static int imdecode_flags(int scale) {
+	return scale == 2 ? cv::IMREAD_REDUCED_COLOR_2 :
+			scale == 4 ? cv::IMREAD_REDUCED_COLOR_4 :
+			scale == 8 ? cv::IMREAD_REDUCED_COLOR_8 : cv::IMREAD_COLOR;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " image_folder [target_side] [bandwidth_kBps]" << std::endl;
+		return 1;
+	}
+	const int target_side = argc > 2 ? std::stoi(argv[2]) : 0;
+	const double bandwidth = argc > 3 ? std::stod(argv[3]) : 1000.0;  // KB/s
+	const size_t chunk = 16 << 10;  // curl的写回调一般每次16KB
+
+	std::mt19937 rng(1234);
+	int total = 0, streamed = 0, mismatch = 0;
+	double buffered_ms = 0.0, pipelined_ms = 0.0;
+	for (boost::filesystem::directory_iterator it(argv[1]), end; it != end; ++it) {
+		std::string img = read_file(it->path().string());
+		if (img.empty()) {
+			continue;
+		}
+		++total;
+
+		// 一致性：随机分块
+		StreamDecoder decoder(target_side);
+		std::string data;
+		for (size_t pos = 0; pos < img.size();) {
+			size_t n = std::min<size_t>(img.size() - pos, 1 + rng() % (64 << 10));
+			data.append(img, pos, n);
+			pos += n;
+			decoder.Feed(data);
+		}
+		cv::Mat image;
+		int scale = 1;
+		if (!decoder.Finish(data, image, scale)) {
+			continue;
+		}
+		++streamed;
+		const cv::Mat buf(1, (int)img.size(), CV_8UC1, const_cast<char *>(img.data()));
+		cv::Mat expect = cv::imdecode(buf, imdecode_flags(scale));
+		if (expect.size() != image.size() || cv::norm(expect, image, cv::NORM_INF) != 0) {
+			std::cout << "mismatch: " << it->path().string() << std::endl;
+			++mismatch;
+		}
+
+		// 耗时：按带宽模拟分块到达
+		auto chunk_delay = std::chrono::microseconds((long)(chunk / bandwidth * 1000.0 * 1000.0 / 1024.0));
+		auto start = std::chrono::steady_clock::now();
+		data.clear();
+		for (size_t pos = 0; pos < img.size(); pos += chunk) {
+			std::this_thread::sleep_for(chunk_delay);
+			data.append(img, pos, chunk);
+		}
+		cv::imdecode(cv::Mat(1, (int)data.size(), CV_8UC1, &data[0]), imdecode_flags(scale));
+		buffered_ms += elapsed_ms(start);
+
+		start = std::chrono::steady_clock::now();
+		data.clear();
+		StreamDecoder pipelined(target_side);
+		for (size_t pos = 0; pos < img.size(); pos += chunk) {
+			std::this_thread::sleep_for(chunk_delay);
+			data.append(img, pos, chunk);
+			pipelined.Feed(data);
+		}
+		pipelined.Finish(data, image, scale);
+		pipelined_ms += elapsed_ms(start);
+	}
+
+	std::cout << "images: " << total << ", streamed: " << streamed
+			<< ", fallback: " << total - streamed << ", mismatch: " << mismatch << std::endl;
+	if (streamed > 0) {
+		std::cout << "buffered average: " << buffered_ms / streamed << " ms"
+				<< ", pipelined average: " << pipelined_ms / streamed << " ms" << std::endl;
+	}
+	return mismatch == 0 ? 0 : 1;
+}
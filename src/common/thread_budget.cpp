@@ -0,0 +1,62 @@
+#include "thread_budget.h"
+#include "base/logging.h"
+#include "opencv2/core.hpp"
+
+#include <thread>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+unsigned ThreadBudget::total_threads_{1};
+unsigned ThreadBudget::concurrency_{1};
+std::atomic<unsigned> ThreadBudget::in_flight_{0};
+std::mutex ThreadBudget::cv_mutex_;
+int ThreadBudget::cv_threads_{-1};
+
+void ThreadBudget::Init(unsigned total_threads, unsigned max_concurrency) {
+    unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    total_threads_ = total_threads == 0 ? cores : total_threads;
+    concurrency_ = max_concurrency == 0 ? cores : max_concurrency;
+    Apply(total_threads_);
+    LOG(INFO) << "thread budget: total_threads=" << total_threads_
+        << ", concurrency=" << concurrency_;
+}
+
+unsigned ThreadBudget::IntraOpThreads(unsigned in_flight) {
+    if (in_flight <= 1) {
+        return total_threads_;
+    }
+    return std::max(total_threads_ / in_flight, 1u);
+}
+
+void ThreadBudget::Apply(unsigned threads) {
+    // cv::setNumThreads是进程级的设置，只在值变化时调用；
+    // 加锁保证缓存的值和OpenCV实际生效的值一致
+    {
+        std::lock_guard<std::mutex> lock(cv_mutex_);
+        if (cv_threads_ != static_cast<int>(threads)) {
+            cv_threads_ = threads;
+            cv::setNumThreads(threads);
+        }
+    }
+#ifdef _OPENMP
+    // OpenMP的线程数对调用线程生效
+    omp_set_num_threads(threads);
+#endif
+}
+
+ThreadBudget::Scope::Scope() {
+    unsigned in_flight = ++in_flight_;
+    threads_ = IntraOpThreads(in_flight);
+    Apply(threads_);
+}
+
+ThreadBudget::Scope::~Scope() {
+    unsigned in_flight = --in_flight_;
+    // 负载下降后放宽其他仍在处理的请求后续可用的线程数
+    if (in_flight > 0) {
+        Apply(IntraOpThreads(in_flight));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+
+/**
+ * CPU线程预算：在请求并发(crow的io线程)和单次推理内部的并行线程
+ * (cv::setNumThreads、OpenMP)之间分配CPU核数，避免高负载时线程超订
+ * 1.低负载：只有一个请求在处理时，该请求可以使用全部核数
+ * 2.高负载：in-flight请求数达到核数时，每个请求只使用一个线程
+ * 使用方式：请求处理期间持有一个ThreadBudget::Scope
+ */
+class ThreadBudget {
+public:
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        // 当前请求可使用的intra-op线程数
+        unsigned Threads() const { return threads_; }
+
+    private:
+        unsigned threads_{1};
+    };
+
+public:
+    // total_threads/max_concurrency为0时使用hardware_concurrency
+    static void Init(unsigned total_threads, unsigned max_concurrency);
+
+    static unsigned TotalThreads() { return total_threads_; }
+    static unsigned Concurrency() { return concurrency_; }
+    static unsigned InFlight() { return in_flight_.load(); }
+
+private:
+    static unsigned IntraOpThreads(unsigned in_flight);
+    static void Apply(unsigned threads);
+
+private:
+    static unsigned total_threads_;
+    static unsigned concurrency_;
+    static std::atomic<unsigned> in_flight_;
+    // cv_threads_是最后一次传给cv::setNumThreads的值，比较和设置在cv_mutex_下一起完成
+    static std::mutex cv_mutex_;
+    static int cv_threads_;
+};
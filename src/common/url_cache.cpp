@@ -0,0 +1,153 @@
+#include "url_cache.h"
+#include "metrics.h"
+#include "redis_conn_pool.h"
+#include "threadpool.hpp"
+#include "base/logging.h"
+
+#include <chrono>
+
+
+size_t UrlTransCache::capacity_{0};
+int UrlTransCache::ttl_seconds_{0};
+bool UrlTransCache::use_redis_{false};
+std::mutex UrlTransCache::lock_;
+std::list<UrlTransCache::Entry> UrlTransCache::entries_;
+std::unordered_map<std::string, std::list<UrlTransCache::Entry>::iterator> UrlTransCache::index_;
+std::unordered_map<std::string, std::shared_future<std::string>> UrlTransCache::pending_;
+
+// 后台转换线程池，进程退出前不释放
+static std::ThreadPool *g_trans_pool{nullptr};
+static const unsigned kTransThreads = 4;
+static const std::string kRedisKeyPrefix{"url_trans:"};
+
+static Metrics::Counter *g_hit = Metrics::GetCounter("url_trans_cache_total{result=\"hit\"}");
+static Metrics::Counter *g_redis_hit = Metrics::GetCounter("url_trans_cache_total{result=\"redis_hit\"}");
+static Metrics::Counter *g_miss = Metrics::GetCounter("url_trans_cache_total{result=\"miss\"}");
+
+static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void UrlTransCache::Init(size_t capacity, int ttl_seconds, bool use_redis) {
+    capacity_ = capacity;
+    ttl_seconds_ = ttl_seconds > 0 ? ttl_seconds : 1;
+    use_redis_ = use_redis && redis_utils::RedisConnPool::GetInstance();
+    LOG(INFO) << "url trans cache: capacity=" << capacity_
+        << ", ttl=" << ttl_seconds_ << "s, redis=" << use_redis_;
+}
+
+bool UrlTransCache::Get(const std::string &url, std::string &inner_url) {
+    if (!Enabled()) {
+        return false;
+    }
+    if (GetLocal(url, inner_url)) {
+        g_hit->Add();
+        return true;
+    }
+    if (use_redis_ && GetRedis(url, inner_url)) {
+        PutLocal(url, inner_url);
+        g_redis_hit->Add();
+        return true;
+    }
+    g_miss->Add();
+    return false;
+}
+
+void UrlTransCache::Put(const std::string &url, const std::string &inner_url) {
+    if (!Enabled()) {
+        return;
+    }
+    PutLocal(url, inner_url);
+    if (use_redis_) {
+        PutRedis(url, inner_url);
+    }
+}
+
+std::shared_future<std::string> UrlTransCache::TransAsync(const std::string &url,
+                                                          TransFunc trans) {
+    auto task = [url, trans]() -> std::string {
+        std::string inner_url;
+        if (trans(inner_url)) {
+            Put(url, inner_url);
+        } else {
+            inner_url.clear();
+        }
+        std::lock_guard<std::mutex> guard{lock_};
+        pending_.erase(url);
+        return inner_url;
+    };
+
+    // 持有锁提交，保证任务结束时从pending_中删除的是本次加入的记录
+    std::lock_guard<std::mutex> guard{lock_};
+    auto it = pending_.find(url);
+    if (it != pending_.end()) {
+        return it->second;
+    }
+    if (!g_trans_pool) {
+        g_trans_pool = new std::ThreadPool(kTransThreads);
+    }
+    std::shared_future<std::string> future = g_trans_pool->commit(task).share();
+    pending_.emplace(url, future);
+    return future;
+}
+
+bool UrlTransCache::GetLocal(const std::string &url, std::string &inner_url) {
+    std::lock_guard<std::mutex> guard{lock_};
+    auto it = index_.find(url);
+    if (it == index_.end()) {
+        return false;
+    }
+    if (it->second->expire_ms <= NowMs()) {
+        entries_.erase(it->second);
+        index_.erase(it);
+        return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    inner_url = it->second->inner_url;
+    return true;
+}
+
+void UrlTransCache::PutLocal(const std::string &url, const std::string &inner_url) {
+    int64_t expire_ms = NowMs() + ttl_seconds_ * 1000LL;
+    std::lock_guard<std::mutex> guard{lock_};
+    auto it = index_.find(url);
+    if (it != index_.end()) {
+        it->second->inner_url = inner_url;
+        it->second->expire_ms = expire_ms;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    entries_.push_front(Entry{url, inner_url, expire_ms});
+    index_.emplace(url, entries_.begin());
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().url);
+        entries_.pop_back();
+    }
+}
+
+bool UrlTransCache::GetRedis(const std::string &url, std::string &inner_url) {
+    // 不等待连接，连接池繁忙时按未命中处理
+    redis_utils::RedisClient client(0);
+    std::string key = kRedisKeyPrefix + url;
+    const char *argv[] = {"GET", key.c_str()};
+    const size_t argvlen[] = {3, key.size()};
+    std::string msg;
+    if (!client.ExecuteCmdv(2, argv, argvlen, msg) || msg.empty()) {
+        return false;
+    }
+    inner_url.swap(msg);
+    return true;
+}
+
+void UrlTransCache::PutRedis(const std::string &url, const std::string &inner_url) {
+    redis_utils::RedisClient client(1);
+    std::string key = kRedisKeyPrefix + url;
+    std::string ttl = std::to_string(ttl_seconds_);
+    const char *argv[] = {"SET", key.c_str(), inner_url.c_str(), "EX", ttl.c_str()};
+    const size_t argvlen[] = {3, key.size(), inner_url.size(), 2, ttl.size()};
+    std::string msg;
+    if (!client.ExecuteCmdv(5, argv, argvlen, msg)) {
+        LOG(WARNING) << "url trans cache: redis set failed, " << url;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <cstdint>
+#include <unordered_map>
+
+
+/**
+ * 外网URL到内网URL的转换缓存
+ * 1.本地：容量和过期时间有限的LRU
+ * 2.可选的redis共享层：多个实例共享转换结果，本地未命中时查询
+ * 3.未命中时转换在后台线程执行，同一个URL同时只转换一次，
+ *   调用方直接下载原始URL，转换结果写入缓存供后续请求使用
+ * 4.指标：url_trans_cache_total{result="hit|redis_hit|miss"}
+ */
+class UrlTransCache {
+public:
+    // 转换函数：成功时返回true并填充inner_url
+    using TransFunc = std::function<bool(std::string &inner_url)>;
+
+public:
+    // capacity为0时不缓存，use_redis需要先初始化redis连接池
+    static void Init(size_t capacity, int ttl_seconds, bool use_redis);
+
+    static bool Enabled() { return capacity_ > 0; }
+
+    static bool Get(const std::string &url, std::string &inner_url);
+    static void Put(const std::string &url, const std::string &inner_url);
+
+    // 后台转换并写入缓存，返回的future结果为内网URL，转换失败时为空
+    static std::shared_future<std::string> TransAsync(const std::string &url,
+                                                      TransFunc trans);
+
+private:
+    static bool GetLocal(const std::string &url, std::string &inner_url);
+    static void PutLocal(const std::string &url, const std::string &inner_url);
+    static bool GetRedis(const std::string &url, std::string &inner_url);
+    static void PutRedis(const std::string &url, const std::string &inner_url);
+
+private:
+    struct Entry {
+        std::string url;
+        std::string inner_url;
+        int64_t expire_ms;
+    };
+
+    static size_t capacity_;
+    static int ttl_seconds_;
+    static bool use_redis_;
+    static std::mutex lock_;
+    static std::list<Entry> entries_;  // 头部为最近使用
+    static std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    static std::unordered_map<std::string, std::shared_future<std::string>> pending_;
+};
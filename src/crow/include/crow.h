@@ -8,7 +8,7 @@
 #include "crow/json.h"
 #include "crow/mustache.h"
 #include "crow/logging.h"
-#include "crow/dumb_timer_queue.h"
+#include "crow/timer_wheel.h"
 #include "crow/utility.h"
 #include "crow/common.h"
 #include "crow/http_request.h"
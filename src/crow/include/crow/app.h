@@ -90,6 +90,58 @@ namespace crow
             return *this;
         }
 
+        // one SO_REUSEPORT acceptor per thread: the kernel hashes each connection to a fixed thread,
+        // so new connections no longer go to the least-loaded worker
+        self_t& reuseport(bool enabled = true)
+        {
+            reuse_port_ = enabled;
+            return *this;
+        }
+
+        self_t& max_body_size(uint64_t size)
+        {
+            connection_settings_.max_body_size = size;
+            return *this;
+        }
+
+        self_t& direct_read_threshold(uint64_t size)
+        {
+            connection_settings_.direct_read_threshold = size;
+            return *this;
+        }
+
+        self_t& timer_granularity(std::chrono::milliseconds granularity)
+        {
+            connection_settings_.timer_granularity_ms = granularity.count();
+            return *this;
+        }
+
+        // connection deadlines, 0 disables one. the handler deadline cannot interrupt a handler
+        // blocking the io thread, it only covers responses completed later from another thread
+        self_t& timeouts(std::chrono::milliseconds read, std::chrono::milliseconds write, std::chrono::milliseconds handler)
+        {
+            connection_settings_.read_timeout_ms = read.count();
+            connection_settings_.write_timeout_ms = write.count();
+            connection_settings_.handler_timeout_ms = handler.count();
+            return *this;
+        }
+
+        // accepting pauses at max_connections or max_body_bytes in flight (0: no limit)
+        // and resumes once both are below low_water_percent of them
+        self_t& accept_limits(uint64_t max_connections, uint64_t max_body_bytes, uint64_t low_water_percent = 90)
+        {
+            connection_settings_.max_connections = max_connections;
+            connection_settings_.max_body_bytes_in_flight = max_body_bytes;
+            connection_settings_.low_water_percent = std::min<uint64_t>(low_water_percent, 100);
+            return *this;
+        }
+
+        self_t& request_body_observer(std::function<void(uint64_t, bool)> f)
+        {
+            connection_settings_.on_request_body = std::move(f);
+            return *this;
+        }
+
         void validate()
         {
             router_.validate();
@@ -101,15 +153,19 @@ namespace crow
 #ifdef CROW_ENABLE_SSL
             if (use_ssl_)
             {
-                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_)));
+                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_, reuse_port_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_connection_settings(connection_settings_);
+                ssl_server_->set_signal_function(signal_function_);
                 ssl_server_->run();
             }
             else
 #endif
             {
-                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr)));
+                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr, reuse_port_)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_connection_settings(connection_settings_);
+                server_->set_signal_function(signal_function_);
                 server_->run();
             }
         }
@@ -128,6 +184,50 @@ namespace crow
             }
         }
 
+        // called on SIGINT/SIGTERM instead of stop(), on the acceptor thread: it must not block
+        self_t& signal_handler(std::function<void(int)> f)
+        {
+            signal_function_ = std::move(f);
+            return *this;
+        }
+
+        // stops accepting and waits for the requests in flight, see Server::drain; call stop() afterwards
+        bool drain(std::chrono::milliseconds timeout)
+        {
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_->drain(timeout);
+            }
+#endif
+            return server_->drain(timeout);
+        }
+
+        // load of a worker thread of the running server, nullptr before run()
+        const detail::worker_load* worker_load(uint16_t index)
+        {
+            if (index >= concurrency_)
+                return nullptr;
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_ ? &ssl_server_->worker_load(index) : nullptr;
+            }
+#endif
+            return server_ ? &server_->worker_load(index) : nullptr;
+        }
+
+        bool accept_paused()
+        {
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_ && ssl_server_->accept_paused();
+            }
+#endif
+            return server_ && server_->accept_paused();
+        }
+
         void debug_print()
         {
             CROW_LOG_DEBUG << "Routing:";
@@ -229,6 +329,9 @@ namespace crow
     private:
         uint16_t port_ = 80;
         uint16_t concurrency_ = 1;
+        bool reuse_port_ = false;
+        detail::connection_settings connection_settings_;
+        std::function<void(int)> signal_function_;
         std::string bindaddr_ = "0.0.0.0";
         Router router_;
 
@@ -13,7 +13,7 @@
 #include "crow/http_response.h"
 #include "crow/logging.h"
 #include "crow/settings.h"
-#include "crow/dumb_timer_queue.h"
+#include "crow/timer_wheel.h"
 #include "crow/middleware_context.h"
 #include "crow/socket_adaptors.h"
 
@@ -175,6 +175,52 @@ namespace crow
         }
     }
 
+    namespace detail
+    {
+        // load of one worker io_service: updated by its connections, read when picking a worker
+        struct worker_load
+        {
+            std::atomic<int> connections{0};
+            std::atomic<int> handlers{0};
+            // capacity of the request bodies being received or handled
+            std::atomic<int64_t> body_bytes{0};
+            // responses being written
+            std::atomic<int> writes{0};
+        };
+
+        // limits and hooks shared by all connections of a server
+        struct connection_settings
+        {
+            // 0: no limit; larger bodies are answered with 413 as soon as the headers are parsed
+            uint64_t max_body_size{0};
+            // called with the body size of each request, rejected is true for a 413
+            std::function<void(uint64_t size, bool rejected)> on_request_body;
+            // bodies with at least this much left are read straight into the request body
+            // instead of through the 4 KB buffer; 0 disables
+            uint64_t direct_read_threshold{64 * 1024};
+            // tick of the per-worker timer wheel, deadlines are rounded up to it
+            uint64_t timer_granularity_ms{100};
+            // the connection is closed when a deadline passes; 0 disables it
+            // waiting for (the rest of) a request, keep-alive idle time included
+            uint64_t read_timeout_ms{5000};
+            // writing one response to the peer
+            uint64_t write_timeout_ms{0};
+            // from routing a request until the handler completes the response.
+            // the wheel runs on the connection's io thread: a handler blocking that thread is not
+            // interrupted, only responses completed later (from another thread) are covered
+            uint64_t handler_timeout_ms{0};
+            // accepting pauses at this many connections or body bytes in flight, 0: no limit
+            uint64_t max_connections{0};
+            uint64_t max_body_bytes_in_flight{0};
+            // and resumes once both are below this percentage of their limit
+            uint64_t low_water_percent{90};
+            // set by the server: a connection closed or released body bytes
+            std::function<void()> on_released;
+            // set by the server: while draining, every response closes its connection
+            const std::atomic<bool>* draining{};
+        };
+    }
+
 #ifdef CROW_ENABLE_DEBUG
     static std::atomic<int> connectionCount;
 #endif
@@ -188,8 +234,10 @@ namespace crow
             const std::string& server_name,
             std::tuple<Middlewares...>* middlewares,
             std::function<std::string()>& get_cached_date_str_f,
-            detail::dumb_timer_queue& timer_queue,
-            typename Adaptor::context* adaptor_ctx_
+            detail::timer_wheel& timer_queue,
+            typename Adaptor::context* adaptor_ctx_,
+            detail::worker_load& load,
+            const detail::connection_settings& settings
             ) 
             : adaptor_(io_service, adaptor_ctx_), 
             handler_(handler), 
@@ -197,8 +245,12 @@ namespace crow
             server_name_(server_name),
             middlewares_(middlewares),
             get_cached_date_str(get_cached_date_str_f),
-            timer_queue(timer_queue)
+            timer_queue(timer_queue),
+            load_(load),
+            settings_(settings)
         {
+            parser_.max_body_size = settings_.max_body_size;
+            load_.connections ++;
 #ifdef CROW_ENABLE_DEBUG
             connectionCount ++;
             CROW_LOG_DEBUG << "Connection open, total " << connectionCount << ", " << this;
@@ -208,7 +260,14 @@ namespace crow
         ~Connection()
         {
             res.complete_request_handler_ = nullptr;
-            cancel_deadline_timer();
+            cancel_deadline(read_timer_);
+            cancel_deadline(write_timer_);
+            cancel_deadline(handler_timer_);
+            leave_handler();
+            update_body_bytes(true);
+            load_.connections --;
+            if (settings_.on_released)
+                settings_.on_released();
 #ifdef CROW_ENABLE_DEBUG
             connectionCount --;
             CROW_LOG_DEBUG << "Connection closed, total " << connectionCount << ", " << this;
@@ -225,7 +284,7 @@ namespace crow
             adaptor_.start([this](const boost::system::error_code& ec) {
                 if (!ec)
                 {
-                    start_deadline();
+                    start_deadline(read_timer_, settings_.read_timeout_ms);
 
                     do_read();
                 }
@@ -236,6 +295,18 @@ namespace crow
             });
         }
 
+        void handle_body_too_large(uint64_t size)
+        {
+            CROW_LOG_INFO << "Request body too large: " << this << ' ' << size << " > " << parser_.max_body_size;
+            if (settings_.on_request_body)
+                settings_.on_request_body(size, true);
+            // the rest of the body is never read, the connection closes after the response
+            close_connection_ = true;
+            add_keep_alive_ = false;
+            res = response(413);
+            complete_request();
+        }
+
         void handle_header()
         {
             // HTTP 1.1 Expect: 100-continue
@@ -250,12 +321,14 @@ namespace crow
 
         void handle()
         {
-            cancel_deadline_timer();
+            cancel_deadline(read_timer_);
             bool is_invalid_request = false;
             add_keep_alive_ = false;
 
-            req_ = std::move(parser_.to_request());
+            req_ = std::move(parser_).to_request();
             request& req = req_;
+            if (settings_.on_request_body)
+                settings_.on_request_body(req.body.size(), false);
 
             if (parser_.check_version(1, 0))
             {
@@ -318,6 +391,9 @@ namespace crow
                 {
                     res.complete_request_handler_ = [this]{ this->complete_request(); };
                     need_to_call_after_handlers_ = true;
+                    in_handler_ = true;
+                    load_.handlers ++;
+                    start_deadline(handler_timer_, settings_.handler_timeout_ms);
                     handler_->handle(req, res);
                     if (add_keep_alive_)
                         res.set_header("connection", "Keep-Alive");
@@ -336,6 +412,9 @@ namespace crow
         void complete_request()
         {
             CROW_LOG_INFO << "Response: " << this << ' ' << req_.raw_url << ' ' << res.code << ' ' << close_connection_;
+            leave_handler();
+            cancel_deadline(handler_timer_);
+            update_body_bytes();
 
             if (need_to_call_after_handlers_)
             {
@@ -351,11 +430,19 @@ namespace crow
 
             //auto self = this->shared_from_this();
             res.complete_request_handler_ = nullptr;
+            // the request is finished with its response, its body buffer serves the next request
+            parser_.recycle_body(req_.body);
             
             if (!adaptor_.is_open())
             {
-                //CROW_LOG_DEBUG << this << " delete (socket is closed) " << is_reading << ' ' << is_writing;
-                //delete this;
+                // closed by the handler deadline: no read is pending to clean up the connection
+                if (need_to_start_read_after_complete_)
+                {
+                    need_to_start_read_after_complete_ = false;
+                    is_reading = false;
+                    CROW_LOG_DEBUG << this << " from complete_request (socket is closed)";
+                    check_destroy();
+                }
                 return;
             }
 
@@ -374,6 +461,7 @@ namespace crow
                 {401, "HTTP/1.1 401 Unauthorized\r\n"},
                 {403, "HTTP/1.1 403 Forbidden\r\n"},
                 {404, "HTTP/1.1 404 Not Found\r\n"},
+                {413, "HTTP/1.1 413 Payload Too Large\r\n"},
                 {422, "HTTP/1.1 422 Unprocessable Entity\r\n"},
 
                 {500, "HTTP/1.1 500 Internal Server Error\r\n"},
@@ -388,6 +476,14 @@ namespace crow
             buffers_.clear();
             buffers_.reserve(4*(res.headers.size()+5)+3);
 
+            // keep-alive clients send their next request to another instance
+            if (settings_.draining && *settings_.draining && !close_connection_)
+            {
+                close_connection_ = true;
+                add_keep_alive_ = false;
+                res.set_header("connection", "close");
+            }
+
             if (res.body.empty() && res.json_value.t() == json::type::Object)
             {
                 res.body = json::dump(res.json_value);
@@ -451,7 +547,13 @@ namespace crow
             if (need_to_start_read_after_complete_)
             {
                 need_to_start_read_after_complete_ = false;
-                start_deadline();
+                if (close_connection_)
+                {
+                    // the write in flight keeps the connection until it closes the adaptor
+                    is_reading = false;
+                    return;
+                }
+                start_read_deadline();
                 do_read();
             }
         }
@@ -461,57 +563,86 @@ namespace crow
         {
             //auto self = this->shared_from_this();
             is_reading = true;
+            if (parser_.can_read_body_directly(settings_.direct_read_threshold))
+            {
+                size_t length;
+                char* data = parser_.direct_body_buffer(length);
+                adaptor_.socket().async_read_some(boost::asio::buffer(data, length), 
+                    [this, data](const boost::system::error_code& ec, std::size_t bytes_transferred)
+                    {
+                        handle_read(ec, data, bytes_transferred);
+                    });
+                return;
+            }
             adaptor_.socket().async_read_some(boost::asio::buffer(buffer_), 
                 [this](const boost::system::error_code& ec, std::size_t bytes_transferred)
                 {
-                    bool error_while_reading = true;
-                    if (!ec)
-                    {
-                        bool ret = parser_.feed(buffer_.data(), bytes_transferred);
-                        if (ret && adaptor_.is_open())
-                        {
-                            error_while_reading = false;
-                        }
-                    }
-
-                    if (error_while_reading)
-                    {
-                        cancel_deadline_timer();
-                        parser_.done();
-                        adaptor_.close();
-                        is_reading = false;
-                        CROW_LOG_DEBUG << this << " from read(1)";
-                        check_destroy();
-                    }
-                    else if (close_connection_)
-                    {
-                        cancel_deadline_timer();
-                        parser_.done();
-                        is_reading = false;
-                        check_destroy();
-                        // adaptor will close after write
-                    }
-                    else if (!need_to_call_after_handlers_)
-                    {
-                        start_deadline();
-                        do_read();
-                    }
-                    else
-                    {
-                        // res will be completed later by user
-                        need_to_start_read_after_complete_ = true;
-                    }
+                    handle_read(ec, buffer_.data(), bytes_transferred);
                 });
         }
 
+        void handle_read(const boost::system::error_code& ec, const char* data, std::size_t bytes_transferred)
+        {
+            bool error_while_reading = true;
+            if (!ec)
+            {
+                bool ret = parser_.feed(data, bytes_transferred);
+                update_body_bytes();
+                // a rejected body stops the parser, the 413 is still being written
+                if ((ret || parser_.body_too_large) && adaptor_.is_open())
+                {
+                    error_while_reading = false;
+                }
+            }
+
+            if (error_while_reading)
+            {
+                cancel_deadline(read_timer_);
+                parser_.done();
+                adaptor_.close();
+                is_reading = false;
+                CROW_LOG_DEBUG << this << " from read(1)";
+                check_destroy();
+            }
+            else if (close_connection_)
+            {
+                cancel_deadline(read_timer_);
+                parser_.done();
+                if (need_to_call_after_handlers_)
+                {
+                    // res will be completed later by user: the connection and res stay alive until then,
+                    // complete_request stops reading and the write closes the connection
+                    need_to_start_read_after_complete_ = true;
+                    return;
+                }
+                is_reading = false;
+                check_destroy();
+                // adaptor will close after write
+            }
+            else if (!need_to_call_after_handlers_)
+            {
+                start_read_deadline();
+                do_read();
+            }
+            else
+            {
+                // res will be completed later by user
+                need_to_start_read_after_complete_ = true;
+            }
+        }
+
         void do_write()
         {
             //auto self = this->shared_from_this();
             is_writing = true;
+            load_.writes ++;
+            start_deadline(write_timer_, settings_.write_timeout_ms);
             boost::asio::async_write(adaptor_.socket(), buffers_, 
                 [&](const boost::system::error_code& ec, std::size_t /*bytes_transferred*/)
                 {
                     is_writing = false;
+                    load_.writes --;
+                    cancel_deadline(write_timer_);
                     res.clear();
                     res_body_copy_.clear();
                     if (!ec)
@@ -522,6 +653,10 @@ namespace crow
                             CROW_LOG_DEBUG << this << " from write(1)";
                             check_destroy();
                         }
+                        else if (is_reading && !need_to_call_after_handlers_)
+                        {
+                            start_read_deadline();
+                        }
                     }
                     else
                     {
@@ -541,17 +676,58 @@ namespace crow
             }
         }
 
-        void cancel_deadline_timer()
+        void leave_handler()
         {
-            CROW_LOG_DEBUG << this << " timer cancelled: " << timer_cancel_key_.first << ' ' << timer_cancel_key_.second;
-            timer_queue.cancel(timer_cancel_key_);
+            if (in_handler_)
+            {
+                in_handler_ = false;
+                load_.handlers --;
+            }
         }
 
-        void start_deadline(/*int timeout = 5*/)
+        // the body being parsed and the one of the request in the handler count against max_body_bytes_in_flight
+        void update_body_bytes(bool closing = false)
         {
-            cancel_deadline_timer();
-            
-            timer_cancel_key_ = timer_queue.add([this]
+            uint64_t bytes = 0;
+            if (!closing)
+            {
+                if (parser_.reading_body || !parser_.body.empty())
+                    bytes += parser_.body.capacity();
+                if (in_handler_)
+                    bytes += req_.body.capacity();
+            }
+            if (bytes == body_bytes_)
+                return;
+            load_.body_bytes += (int64_t)bytes - (int64_t)body_bytes_;
+            bool released = bytes < body_bytes_;
+            body_bytes_ = bytes;
+            if (released && !closing && settings_.on_released)
+                settings_.on_released();
+        }
+
+        // a response being written is covered by the write deadline only,
+        // the read deadline starts again once it completes
+        void start_read_deadline()
+        {
+            if (is_writing)
+                cancel_deadline(read_timer_);
+            else
+                start_deadline(read_timer_, settings_.read_timeout_ms);
+        }
+
+        void cancel_deadline(detail::timer_wheel::key& timer)
+        {
+            CROW_LOG_DEBUG << this << " timer cancelled: " << timer.wheel << ' ' << timer.index;
+            timer_queue.cancel(timer);
+        }
+
+        void start_deadline(detail::timer_wheel::key& timer, uint64_t timeout_ms)
+        {
+            cancel_deadline(timer);
+            if (!timeout_ms)
+                return;
+
+            timer = timer_queue.add(std::chrono::milliseconds(timeout_ms), [this]
             {
                 if (!adaptor_.is_open())
                 {
@@ -559,7 +735,7 @@ namespace crow
                 }
                 adaptor_.close();
             });
-            CROW_LOG_DEBUG << this << " timer added: " << timer_cancel_key_.first << ' ' << timer_cancel_key_.second;
+            CROW_LOG_DEBUG << this << " timer added: " << timer.wheel << ' ' << timer.index;
         }
 
     private:
@@ -580,21 +756,26 @@ namespace crow
         std::string content_length_;
         std::string date_str_;
         std::string res_body_copy_;
+        uint64_t body_bytes_{};
 
-        //boost::asio::deadline_timer deadline_;
-        detail::dumb_timer_queue::key timer_cancel_key_;
+        detail::timer_wheel::key read_timer_;
+        detail::timer_wheel::key write_timer_;
+        detail::timer_wheel::key handler_timer_;
 
         bool is_reading{};
         bool is_writing{};
         bool need_to_call_after_handlers_{};
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
+        bool in_handler_{};
 
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
 
         std::function<std::string()>& get_cached_date_str;
-        detail::dumb_timer_queue& timer_queue;
+        detail::timer_wheel& timer_queue;
+        detail::worker_load& load_;
+        const detail::connection_settings& settings_;
     };
 
 }
@@ -9,25 +9,36 @@
 #include <cstdint>
 #include <atomic>
 #include <future>
+#include <thread>
 #include <vector>
+#include <limits>
+#include <utility>
 
 #include <memory>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "crow/http_connection.h"
 #include "crow/logging.h"
-#include "crow/dumb_timer_queue.h"
+#include "crow/timer_wheel.h"
 
 namespace crow
 {
     using namespace boost;
     using tcp = asio::ip::tcp;
 
+#ifdef SO_REUSEPORT
+    using reuse_port_option = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
     template <typename Handler, typename Adaptor = SocketAdaptor, typename ... Middlewares>
     class Server
     {
     public:
-    Server(Handler* handler, std::string bindaddr, uint16_t port, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, typename Adaptor::context* adaptor_ctx = nullptr)
-            : acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address::from_string(bindaddr), port)),
+    Server(Handler* handler, std::string bindaddr, uint16_t port, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, typename Adaptor::context* adaptor_ctx = nullptr, bool reuse_port = false)
+            : acceptor_(io_service_),
+            accept_socket_(io_service_),
             signals_(io_service_, SIGINT, SIGTERM),
             tick_timer_(io_service_),
             handler_(handler),
@@ -37,6 +48,33 @@ namespace crow
             middlewares_(middlewares),
             adaptor_ctx_(adaptor_ctx)
         {
+            if (concurrency_ < 1)
+                concurrency_ = 1;
+
+            for(int i = 0; i < concurrency_;  i++)
+                io_service_pool_.emplace_back(new boost::asio::io_service());
+            load_pool_.reset(new detail::worker_load[concurrency_]);
+
+            tcp::endpoint endpoint(boost::asio::ip::address::from_string(bindaddr), port);
+#ifdef SO_REUSEPORT
+            if (reuse_port)
+            {
+                // one listening socket per worker, the kernel spreads new connections between them
+                // and each worker accepts on its own io_service
+                for(auto& io_service : io_service_pool_)
+                {
+                    worker_acceptors_.emplace_back(new tcp::acceptor(*io_service));
+                    listen(*worker_acceptors_.back(), endpoint, true);
+                    // port 0: the other workers share the port picked by the first bind
+                    endpoint.port(worker_acceptors_.back()->local_endpoint().port());
+                }
+                return;
+            }
+#else
+            if (reuse_port)
+                CROW_LOG_WARNING << "SO_REUSEPORT is not supported, using a single acceptor";
+#endif
+            listen(acceptor_, endpoint, false);
         }
 
         void set_tick_function(std::chrono::milliseconds d, std::function<void()> f)
@@ -59,11 +97,9 @@ namespace crow
 
         void run()
         {
-            if (concurrency_ < 0)
-                concurrency_ = 1;
-
-            for(int i = 0; i < concurrency_;  i++)
-                io_service_pool_.emplace_back(new boost::asio::io_service());
+            settings_.on_released = [this]{ resume_accept(); };
+            settings_.draining = &draining_;
+            accept_paused_.reset(new std::atomic<bool>[std::max<size_t>(worker_acceptors_.size(), 1)]());
             get_cached_date_str_pool_.resize(concurrency_);
             timer_queue_pool_.resize(concurrency_);
 
@@ -102,20 +138,20 @@ namespace crow
                                 return date_str;
                             };
 
-                            // initializing timer queue
-                            detail::dumb_timer_queue timer_queue;
+                            // initializing timer wheel, driven once per granularity on the worker's io_service
+                            detail::timer_wheel timer_queue(std::chrono::milliseconds(settings_.timer_granularity_ms));
                             timer_queue_pool_[i] = &timer_queue;
 
-                            timer_queue.set_io_service(*io_service_pool_[i]);
+                            auto granularity = boost::posix_time::milliseconds(timer_queue.granularity().count());
                             boost::asio::deadline_timer timer(*io_service_pool_[i]);
-                            timer.expires_from_now(boost::posix_time::seconds(1));
+                            timer.expires_from_now(granularity);
 
                             std::function<void(const boost::system::error_code& ec)> handler;
                             handler = [&](const boost::system::error_code& ec){
                                 if (ec)
                                     return;
                                 timer_queue.process();
-                                timer.expires_from_now(boost::posix_time::seconds(1));
+                                timer.expires_from_now(granularity);
                                 timer.async_wait(handler);
                             };
                             timer.async_wait(handler);
@@ -149,18 +185,33 @@ namespace crow
             }
 
             CROW_LOG_INFO << server_name_ << " server is running at " << bindaddr_ <<":" << port_
-                          << " using " << concurrency_ << " threads";
+                          << " using " << concurrency_ << " threads"
+                          << (worker_acceptors_.empty() ? "" : " (SO_REUSEPORT acceptor per thread)");
             CROW_LOG_INFO << "Call `app.loglevel(crow::LogLevel::Warning)` to hide Info level logs.";
 
             signals_.async_wait(
-                [&](const boost::system::error_code& /*error*/, int /*signal_number*/){
-                    stop();
+                [&](const boost::system::error_code& /*error*/, int signal_number){
+                    if (!signal_function_)
+                    {
+                        stop();
+                        return;
+                    }
+                    signal_function_(signal_number);
+                    // a second signal does not wait for the first one to finish
+                    signals_.async_wait(
+                        [&](const boost::system::error_code& /*error*/, int /*signal_number*/){
+                            stop();
+                        });
                 });
 
             while(concurrency_ != init_count)
                 std::this_thread::yield();
 
-            do_accept();
+            if (worker_acceptors_.empty())
+                do_accept();
+            else
+                for(uint16_t i = 0; i < concurrency_; i ++)
+                    do_accept(i);
 
             std::thread([this]{
                 io_service_.run();
@@ -175,47 +226,232 @@ namespace crow
                 io_service->stop();
         }
 
+        // called on SIGINT/SIGTERM instead of stop(), on the acceptor thread: it must not block
+        void set_signal_function(std::function<void(int)> f)
+        {
+            signal_function_ = std::move(f);
+        }
+
+        // stops accepting and waits until no request is being received, handled or answered.
+        // blocks the calling thread, which must not be one of the server's; stop() is still needed afterwards.
+        // false when the timeout passed first
+        bool drain(std::chrono::milliseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            if (!draining_.exchange(true))
+            {
+                CROW_LOG_INFO << server_name_ << " server is draining";
+                io_service_.post([this]{ acceptor_.close(); });
+                for(uint16_t i = 0; i < worker_acceptors_.size(); i ++)
+                    io_service_pool_[i]->post([this, i]{ worker_acceptors_[i]->close(); });
+            }
+            while(!idle())
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return true;
+        }
+
+        void set_connection_settings(const detail::connection_settings& settings)
+        {
+            settings_ = settings;
+        }
+
+        const detail::worker_load& worker_load(uint16_t index) const
+        {
+            return load_pool_[index];
+        }
+
+        bool accept_paused() const
+        {
+            if (!accept_paused_)
+                return false;
+            for(size_t i = 0; i < std::max<size_t>(worker_acceptors_.size(), 1); i ++)
+                if (accept_paused_[i])
+                    return true;
+            return false;
+        }
+
     private:
+        static void listen(tcp::acceptor& acceptor, const tcp::endpoint& endpoint, bool reuse_port)
+        {
+            acceptor.open(endpoint.protocol());
+            acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            if (reuse_port)
+                acceptor.set_option(reuse_port_option(true));
+#endif
+            acceptor.bind(endpoint);
+            acceptor.listen();
+        }
+
+        // a worker blocked in a handler cannot serve new connections: prefer the fewest in-flight handlers,
+        // then the fewest connections; ties rotate so idle workers are still used in turn
         asio::io_service& pick_io_service()
         {
-            // TODO load balancing
-            roundrobin_index_++;
-            if (roundrobin_index_ >= io_service_pool_.size())
-                roundrobin_index_ = 0;
+            unsigned int best = roundrobin_index_;
+            std::pair<int, int> best_load{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+            for(unsigned int n = 1; n <= io_service_pool_.size(); n ++)
+            {
+                unsigned int i = (roundrobin_index_ + n) % io_service_pool_.size();
+                std::pair<int, int> load{load_pool_[i].handlers.load(), load_pool_[i].connections.load()};
+                if (load < best_load)
+                {
+                    best = i;
+                    best_load = load;
+                }
+            }
+            roundrobin_index_ = best;
             return *io_service_pool_[roundrobin_index_];
         }
 
+        // the worker is picked when the connection lands, not when the accept is armed:
+        // a handler that starts blocking in between would otherwise still get the connection
         void do_accept()
+        {
+            acceptor_.async_accept(accept_socket_,
+                [this](boost::system::error_code ec)
+                {
+                    if (!ec)
+                        hand_over();
+                    continue_accept(0);
+                });
+        }
+
+        // moves the socket accepted on the acceptor's io_service to a connection on the picked worker
+        void hand_over()
         {
             asio::io_service& is = pick_io_service();
             auto p = new Connection<Adaptor, Handler, Middlewares...>(
                 is, handler_, server_name_, middlewares_,
                 get_cached_date_str_pool_[roundrobin_index_], *timer_queue_pool_[roundrobin_index_],
-                adaptor_ctx_);
-            acceptor_.async_accept(p->socket(),
-                [this, p, &is](boost::system::error_code ec)
+                adaptor_ctx_, load_pool_[roundrobin_index_], settings_);
+            boost::system::error_code ec;
+            auto protocol = acceptor_.local_endpoint(ec).protocol();
+#if BOOST_VERSION >= 106700
+            auto fd = accept_socket_.release(ec);
+#else
+            // no socket::release() before boost 1.67: the descriptor is duplicated and the original closed
+            auto fd = ::dup(accept_socket_.native_handle());
+            accept_socket_.close(ec);
+#endif
+            if (fd < 0 || p->socket().assign(protocol, fd, ec))
+            {
+                CROW_LOG_ERROR << "Cannot hand over the accepted connection: " << (fd < 0 ? "no descriptor" : ec.message());
+                if (fd >= 0)
+                {
+#ifdef _WIN32
+                    ::closesocket(fd);
+#else
+                    ::close(fd);
+#endif
+                }
+                delete p;
+                return;
+            }
+            is.post([p]
+            {
+                p->start();
+            });
+        }
+
+        // accepting on the worker's own acceptor: the connection already runs on its io_service
+        void do_accept(uint16_t index)
+        {
+            auto p = new Connection<Adaptor, Handler, Middlewares...>(
+                *io_service_pool_[index], handler_, server_name_, middlewares_,
+                get_cached_date_str_pool_[index], *timer_queue_pool_[index],
+                adaptor_ctx_, load_pool_[index], settings_);
+            worker_acceptors_[index]->async_accept(p->socket(),
+                [this, p, index](boost::system::error_code ec)
                 {
                     if (!ec)
                     {
-                        is.post([p]
-                        {
-                            p->start();
-                        });
+                        p->start();
                     }
                     else
                     {
                         delete p;
                     }
-                    do_accept();
+                    continue_accept(index);
                 });
         }
 
+        bool idle() const
+        {
+            for(uint16_t i = 0; i < concurrency_; i ++)
+                if (load_pool_[i].handlers || load_pool_[i].body_bytes || load_pool_[i].writes)
+                    return false;
+            return true;
+        }
+
+        bool over_capacity(uint64_t percent) const
+        {
+            if (!settings_.max_connections && !settings_.max_body_bytes_in_flight)
+                return false;
+            int64_t connections = 0, body_bytes = 0;
+            for(uint16_t i = 0; i < concurrency_; i ++)
+            {
+                connections += load_pool_[i].connections;
+                body_bytes += load_pool_[i].body_bytes;
+            }
+            return (settings_.max_connections && (uint64_t)connections >= settings_.max_connections * percent / 100) ||
+                (settings_.max_body_bytes_in_flight && (uint64_t)body_bytes >= settings_.max_body_bytes_in_flight * percent / 100);
+        }
+
+        // over a limit the acceptor is not armed again: new connections wait in the kernel backlog
+        // (and the load balancer sends them elsewhere) until resume_accept() finds the load below the low-water mark
+        void continue_accept(uint16_t index)
+        {
+            if (draining_)
+                return;
+            if (!over_capacity(100))
+            {
+                if (worker_acceptors_.empty())
+                    do_accept();
+                else
+                    do_accept(index);
+                return;
+            }
+            CROW_LOG_WARNING << "Accept paused: connection or request body limit reached";
+            accept_paused_[index] = true;
+            // the connections may all have been released before the flag was set
+            resume_accept();
+        }
+
+        // called from any worker when a connection closes or releases body bytes
+        void resume_accept()
+        {
+            if (draining_ || !accept_paused() || over_capacity(settings_.low_water_percent))
+                return;
+            for(uint16_t i = 0; i < std::max<size_t>(worker_acceptors_.size(), 1); i ++)
+            {
+                if (!accept_paused_[i].exchange(false))
+                    continue;
+                CROW_LOG_INFO << "Accept resumed";
+                if (worker_acceptors_.empty())
+                    io_service_.post([this]{ do_accept(); });
+                else
+                    io_service_pool_[i]->post([this, i]{ do_accept(i); });
+            }
+        }
+
     private:
         asio::io_service io_service_;
         std::vector<std::unique_ptr<asio::io_service>> io_service_pool_;
-        std::vector<detail::dumb_timer_queue*> timer_queue_pool_;
+        std::unique_ptr<detail::worker_load[]> load_pool_;
+        detail::connection_settings settings_;
+        std::unique_ptr<std::atomic<bool>[]> accept_paused_;
+        std::atomic<bool> draining_{false};
+        std::function<void(int)> signal_function_;
+        std::vector<detail::timer_wheel*> timer_queue_pool_;
         std::vector<std::function<std::string()>> get_cached_date_str_pool_;
         tcp::acceptor acceptor_;
+        // the single acceptor accepts here, hand_over() then moves the socket to a worker
+        tcp::socket accept_socket_;
+        std::vector<std::unique_ptr<tcp::acceptor>> worker_acceptors_;
         boost::asio::signal_set signals_;
         boost::asio::deadline_timer tick_timer_;
 
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <boost/algorithm/string.hpp>
 #include <algorithm>
+#include <cstring>
 
 #include "crow/http_parser_merged.h"
 #include "crow/http_request.h"
@@ -66,18 +67,52 @@ namespace crow
             {
                 self->headers.emplace(std::move(self->header_field), std::move(self->header_value));
             }
+            if (self->content_length != CROW_ULLONG_MAX && self->content_length > 0)
+            {
+                // rejected before any of the body is read, the connection answers 413 and closes
+                if (self->max_body_size && self->content_length > self->max_body_size)
+                {
+                    self->reject_body(self->content_length);
+                    return -1;
+                }
+                // the declared length is only trusted up to max_body_reserve when there is no limit
+                self->body.reserve(self->max_body_size ? self->content_length : std::min<uint64_t>(self->content_length, max_body_reserve));
+                self->reading_body = !(self->flags & F_CHUNKED);
+            }
             self->process_header();
             return 0;
         }
         static int on_body(http_parser* self_, const char* at, size_t length)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
-            self->body.insert(self->body.end(), at, at+length);
+            if (self->direct_body)
+            {
+                // normally read in place by the connection, nothing to copy
+                if (self->body.size() < self->direct_body_end + length)
+                    self->body.resize(self->direct_body_end + length);
+                if (at != &self->body[self->direct_body_end])
+                    std::memcpy(&self->body[self->direct_body_end], at, length);
+                self->direct_body_end += length;
+                return 0;
+            }
+            // chunked bodies have no Content-Length, check as they grow
+            if (self->max_body_size && self->body.size() + length > self->max_body_size)
+            {
+                self->reject_body(self->body.size() + length);
+                return -1;
+            }
+            self->body.append(at, length);
             return 0;
         }
         static int on_message_complete(http_parser* self_)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
+            if (self->direct_body)
+            {
+                self->body.resize(self->direct_body_end);
+                self->direct_body = false;
+            }
+            self->reading_body = false;
 
             // url params
             self->url = self->raw_url.substr(0, self->raw_url.find("?"));
@@ -125,6 +160,9 @@ namespace crow
             headers.clear();
             url_params.clear();
             body.clear();
+            body_too_large = false;
+            reading_body = false;
+            direct_body = false;
         }
 
         void process_header()
@@ -132,16 +170,65 @@ namespace crow
             handler_->handle_header();
         }
 
+        // true when the rest of a Content-Length body is large enough to be read straight into body
+        bool can_read_body_directly(uint64_t threshold) const
+        {
+            if (direct_body)
+                return true;
+            return reading_body && threshold && content_length >= threshold &&
+                (max_body_size || content_length <= max_body_reserve);
+        }
+
+        // where the rest of the body goes; the bytes read there are then passed to feed() in place.
+        // the reserved capacity is only sized (and touched) up to direct_body_step ahead of the bytes received,
+        // a client announcing a large body without sending it holds little more than the step
+        char* direct_body_buffer(size_t& length)
+        {
+            if (!direct_body)
+            {
+                direct_body = true;
+                direct_body_end = body.size();
+            }
+            if (body.size() == direct_body_end)
+                body.resize(direct_body_end + std::min<uint64_t>(content_length, direct_body_step));
+            length = body.size() - direct_body_end;
+            return &body[direct_body_end];
+        }
+
+        void reject_body(uint64_t size)
+        {
+            body_too_large = true;
+            handler_->handle_body_too_large(size);
+        }
+
         void process_message()
         {
             handler_->handle();
         }
 
-        request to_request() const
+        request to_request() const &
+        {
+            return request{(HTTPMethod)method, raw_url, url, url_params, headers, body};
+        }
+
+        // the parser is cleared at the next message anyway, hand the buffers over instead of copying them
+        request to_request() &&
         {
             return request{(HTTPMethod)method, std::move(raw_url), std::move(url), std::move(url_params), std::move(headers), std::move(body)};
         }
 
+        // takes back the body buffer of a finished request so the next message on the connection
+        // reuses its capacity; skipped while a new body is already being received.
+        // an idle keep-alive connection keeps at most max_body_recycle, larger buffers go back to malloc
+        void recycle_body(std::string& old_body)
+        {
+            if (body.empty() && old_body.capacity() > body.capacity() && old_body.capacity() <= max_body_recycle)
+            {
+                old_body.clear();
+                body.swap(old_body);
+            }
+        }
+
 		bool is_upgrade() const
 		{
 			return upgrade;
@@ -162,6 +249,25 @@ namespace crow
         query_string url_params;
         std::string body;
 
+        // 0: no limit
+        uint64_t max_body_size = 0;
+        bool body_too_large = false;
+        // a Content-Length body is being received, content_length is what is left of it
+        bool reading_body = false;
+        // body is sized ahead of the bytes received and filled up to direct_body_end
+        bool direct_body = false;
+        size_t direct_body_end = 0;
+        static const uint64_t max_body_reserve = 16 * 1024 * 1024;
+        static const uint64_t direct_body_step = 1024 * 1024;
+        static const uint64_t max_body_recycle = 1024 * 1024;
+
         Handler* handler_;
     };
+
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::max_body_reserve;
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::direct_body_step;
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::max_body_recycle;
 }
@@ -317,6 +317,11 @@ namespace crow
             return *this;
         }
 
+        query_string(query_string&& qs)
+        {
+            *this = std::move(qs);
+        }
+
         query_string& operator = (query_string&& qs)
         {
             key_value_pairs_ = std::move(qs.key_value_pairs_);
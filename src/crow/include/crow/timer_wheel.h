@@ -0,0 +1,203 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "crow/logging.h"
+
+namespace crow
+{
+    namespace detail
+    {
+        // hierarchical hashed timing wheel: O(1) add and cancel, expiry at a fixed granularity.
+        // levels of 64 slots; a timer sits in the level its remaining ticks fall into and moves
+        // down a level each time the level below wraps around.
+        // not thread safe, owned by one io_service thread like the connections using it.
+        class timer_wheel
+        {
+        public:
+            struct key
+            {
+                timer_wheel* wheel{};
+                uint32_t index{};
+                uint32_t generation{};
+            };
+
+            explicit timer_wheel(std::chrono::milliseconds granularity = std::chrono::milliseconds(100),
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now())
+                : granularity_(granularity.count() > 0 ? granularity : std::chrono::milliseconds(1)), start_(start)
+            {
+                for(auto& head : slots_)
+                    head = npos;
+            }
+
+            std::chrono::milliseconds granularity() const
+            {
+                return granularity_;
+            }
+
+            // f runs from process() once delay has passed, rounded up to the granularity
+            key add(std::chrono::milliseconds delay, std::function<void()> f)
+            {
+                uint32_t index;
+                if (free_ != npos)
+                {
+                    index = free_;
+                    free_ = nodes_[index].next;
+                }
+                else
+                {
+                    index = (uint32_t)nodes_.size();
+                    nodes_.emplace_back();
+                }
+                uint64_t ticks = (delay.count() + granularity_.count() - 1) / granularity_.count();
+                node& n = nodes_[index];
+                n.f = std::move(f);
+                n.expiry = now_ + (ticks ? ticks : 1);
+                place(index);
+                ++ size_;
+                CROW_LOG_DEBUG << "timer add: " << this << ' ' << index << " at tick " << n.expiry;
+                key k;
+                k.wheel = this;
+                k.index = index;
+                k.generation = n.generation;
+                return k;
+            }
+
+            void cancel(key& k)
+            {
+                auto self = k.wheel;
+                k.wheel = nullptr;
+                if (!self || k.index >= self->nodes_.size())
+                    return;
+                node& n = self->nodes_[k.index];
+                if (n.generation != k.generation || n.slot == npos)
+                    return;
+                self->unlink(k.index);
+                self->release(k.index);
+            }
+
+            // runs the timers due up to now; ticks missed by a late call are caught up in order
+            void process(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+            {
+                if (now < start_)
+                    return;
+                uint64_t target = (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count() / granularity_.count());
+                while(now_ < target)
+                    tick();
+            }
+
+            size_t size() const
+            {
+                return size_;
+            }
+
+        private:
+            static const int slot_bits = 6;
+            static const uint32_t slot_count = 1 << slot_bits;
+            static const int levels = 4;
+            static const uint32_t npos = 0xffffffff;
+
+            struct node
+            {
+                std::function<void()> f;
+                uint64_t expiry{};
+                uint32_t prev{npos};
+                uint32_t next{npos};
+                uint32_t slot{npos};
+                uint32_t generation{};
+            };
+
+            void place(uint32_t index)
+            {
+                node& n = nodes_[index];
+                uint64_t remaining = n.expiry > now_ ? n.expiry - now_ : 0;
+                int level = 0;
+                while(level < levels - 1 && remaining >= ((uint64_t)1 << (slot_bits * (level + 1))))
+                    ++ level;
+                uint64_t expiry = n.expiry;
+                // beyond the top level: park in the farthest top slot, placed again when it cascades
+                if (remaining >= ((uint64_t)1 << (slot_bits * levels)))
+                    expiry = now_ + ((uint64_t)1 << (slot_bits * levels)) - 1;
+                uint32_t slot = level * slot_count + (uint32_t)((expiry >> (slot_bits * level)) & (slot_count - 1));
+
+                n.slot = slot;
+                n.prev = npos;
+                n.next = slots_[slot];
+                if (n.next != npos)
+                    nodes_[n.next].prev = index;
+                slots_[slot] = index;
+            }
+
+            void unlink(uint32_t index)
+            {
+                node& n = nodes_[index];
+                if (n.prev != npos)
+                    nodes_[n.prev].next = n.next;
+                else
+                    slots_[n.slot] = n.next;
+                if (n.next != npos)
+                    nodes_[n.next].prev = n.prev;
+                n.slot = npos;
+            }
+
+            void release(uint32_t index)
+            {
+                node& n = nodes_[index];
+                n.f = nullptr;
+                ++ n.generation;
+                n.next = free_;
+                free_ = index;
+                -- size_;
+            }
+
+            // moves the timers of a higher level slot down to where their remaining ticks belong
+            void cascade(int level)
+            {
+                uint32_t slot = level * slot_count + (uint32_t)((now_ >> (slot_bits * level)) & (slot_count - 1));
+                uint32_t index = slots_[slot];
+                slots_[slot] = npos;
+                while(index != npos)
+                {
+                    uint32_t next = nodes_[index].next;
+                    place(index);
+                    index = next;
+                }
+            }
+
+            void tick()
+            {
+                ++ now_;
+                for(int level = 1; level < levels; ++ level)
+                {
+                    if ((now_ >> (slot_bits * (level - 1))) & (slot_count - 1))
+                        break;
+                    cascade(level);
+                }
+
+                uint32_t slot = (uint32_t)(now_ & (slot_count - 1));
+                // one at a time: a callback may cancel other timers of this slot
+                while(slots_[slot] != npos)
+                {
+                    uint32_t index = slots_[slot];
+                    unlink(index);
+                    std::function<void()> f = std::move(nodes_[index].f);
+                    release(index);
+                    CROW_LOG_DEBUG << "timer call: " << this << ' ' << index << " at tick " << now_;
+                    if (f)
+                        f();
+                }
+            }
+
+            std::chrono::milliseconds granularity_;
+            std::chrono::steady_clock::time_point start_;
+            uint64_t now_{};
+            uint32_t slots_[levels * slot_count];
+            std::vector<node> nodes_;
+            uint32_t free_{npos};
+            size_t size_{};
+        };
+    }
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "crow.h"
+
+using namespace std;
+using namespace crow;
+
+/*
+ * throughput of multi-MB POSTs over one keep-alive connection:
+ * read through the 4 KB buffer (direct_read_threshold = 0) vs straight into the request body
+ * usage: body_read_performance_testing [loops] [body MB]
+ */
+
+static double run(uint64_t threshold, const std::string& message, int loops)
+{
+    SimpleApp app;
+    CROW_ROUTE(app, "/").methods("POST"_method)([](const request& req){ return std::to_string(req.body.size()); });
+    Server<SimpleApp> server(&app, "127.0.0.1", 45461);
+    crow::detail::connection_settings settings;
+    settings.direct_read_threshold = threshold;
+    server.set_connection_settings(settings);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    asio::io_service is;
+    asio::ip::tcp::socket c(is);
+    c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string("127.0.0.1"), 45461));
+
+    char buf[2048];
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < loops; i ++)
+    {
+        asio::write(c, asio::buffer(message));
+        // the response is small and arrives in one piece
+        c.receive(asio::buffer(buf, 2048));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    server.stop();
+    return seconds;
+}
+
+int main(int argc, char* argv[])
+{
+    const int loops = argc > 1 ? std::stoi(argv[1]) : 50;
+    const size_t body_size = (argc > 2 ? std::stoul(argv[2]) : 7) * 1024 * 1024;
+    crow::logger::setLogLevel(crow::LogLevel::Warning);
+
+    std::string message = "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: " + std::to_string(body_size) + "\r\n\r\n";
+    message.append(body_size, 'x');
+
+    double mb = (double)body_size * loops / (1024 * 1024);
+    double buffered = run(0, message, loops);
+    double direct = run(64 * 1024, message, loops);
+    std::cout << "body: " << body_size << " bytes, loops: " << loops << std::endl;
+    std::cout << "4 KB buffer: " << buffered * 1000 / loops << " ms/request, " << mb / buffered << " MB/s" << std::endl;
+    std::cout << "direct read: " << direct * 1000 / loops << " ms/request, " << mb / direct << " MB/s" << std::endl;
+    return 0;
+}
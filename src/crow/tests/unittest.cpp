@@ -446,6 +446,561 @@ TEST(multi_server)
     server2.stop();
 }
 
+TEST(reuseport_server)
+{
+    static char buf[2048];
+    SimpleApp app;
+    CROW_ROUTE(app, "/")([]{return "A";});
+
+    // every worker listens on the port, connections are spread by the kernel
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451, nullptr, 4, nullptr, true);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    std::string sendmsg = "GET /\r\n\r\n";
+    asio::io_service is;
+    for(int i = 0; i < 16; i ++)
+    {
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+
+        c.send(asio::buffer(sendmsg));
+
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL('A', buf[recved-1]);
+    }
+    server.stop();
+}
+
+TEST(least_loaded_worker)
+{
+    static char buf[2048];
+    SimpleApp app;
+    std::atomic<bool> slow_started{false};
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    CROW_ROUTE(app, "/slow")([&]{
+        slow_started = true;
+        released.wait_for(std::chrono::seconds(3));
+        return "S";
+    });
+    CROW_ROUTE(app, "/fast")([]{return "F";});
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451, nullptr, 2);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    asio::io_service is;
+    asio::ip::tcp::socket slow(is);
+    slow.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    slow.send(asio::buffer(std::string("GET /slow\r\n\r\n")));
+    while(!slow_started)
+        std::this_thread::yield();
+
+    // a round-robin pick would put some of these behind the blocked handler
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < 4; i ++)
+    {
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("GET /fast\r\n\r\n")));
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL('F', buf[recved-1]);
+    }
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    ASSERT_EQUAL(1, server.worker_load(0).handlers + server.worker_load(1).handlers);
+
+    release.set_value();
+    size_t recved = slow.receive(asio::buffer(buf, 2048));
+    ASSERT_EQUAL('S', buf[recved-1]);
+    server.stop();
+}
+
+TEST(worker_picked_when_connection_lands)
+{
+    static char buf[2048];
+    SimpleApp app;
+    std::atomic<bool> slow_started{false};
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    CROW_ROUTE(app, "/slow")([&]{
+        slow_started = true;
+        released.wait_for(std::chrono::seconds(3));
+        return "S";
+    });
+    CROW_ROUTE(app, "/fast")([]{return "F";});
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451, nullptr, 2);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    // two idle connections, one per worker; the next accept is armed while both are idle
+    asio::io_service is;
+    asio::ip::tcp::socket first(is), second(is);
+    first.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    second.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    while(server.worker_load(0).connections + server.worker_load(1).connections < 2)
+        std::this_thread::yield();
+    ASSERT_EQUAL(1, server.worker_load(0).connections.load());
+
+    // the blocking handler starts after the accept was armed: the new connection must still avoid its worker
+    first.send(asio::buffer(std::string("GET /slow\r\n\r\n")));
+    while(!slow_started)
+        std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    asio::ip::tcp::socket c(is);
+    c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    c.send(asio::buffer(std::string("GET /fast\r\n\r\n")));
+    size_t recved = c.receive(asio::buffer(buf, 2048));
+    ASSERT_EQUAL('F', buf[recved-1]);
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+
+    release.set_value();
+    recved = first.receive(asio::buffer(buf, 2048));
+    ASSERT_EQUAL('S', buf[recved-1]);
+    server.stop();
+}
+
+TEST(max_body_size)
+{
+    static char buf[2048];
+    SimpleApp app;
+    CROW_ROUTE(app, "/").methods("POST"_method)([](const request& req){return std::to_string(req.body.size());});
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+    crow::detail::connection_settings settings;
+    settings.max_body_size = 16;
+    std::vector<std::pair<uint64_t, bool>> observed;
+    settings.on_request_body = [&](uint64_t size, bool rejected){ observed.emplace_back(size, rejected); };
+    server.set_connection_settings(settings);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    asio::io_service is;
+    {
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 10\r\n\r\n0123456789")));
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL("10", std::string(buf + recved - 2, buf + recved));
+    }
+    {
+        // answered from the headers alone, without sending the body
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 7000000\r\n\r\n")));
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL("HTTP/1.1 413", std::string(buf, buf + std::min<size_t>(recved, 12)));
+    }
+    {
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("POST / HTTP/1.1\r\nHost: a\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "a\r\n0123456789\r\na\r\n0123456789\r\n0\r\n\r\n")));
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL("HTTP/1.1 413", std::string(buf, buf + std::min<size_t>(recved, 12)));
+    }
+    server.stop();
+
+    ASSERT_EQUAL(3u, observed.size());
+    if (observed.size() == 3)
+    {
+        ASSERT_TRUE(observed[0] == std::make_pair((uint64_t)10, false));
+        ASSERT_TRUE(observed[1] == std::make_pair((uint64_t)7000000, true));
+        ASSERT_TRUE(observed[2] == std::make_pair((uint64_t)20, true));
+    }
+}
+
+TEST(large_body_direct_read)
+{
+    SimpleApp app;
+    CROW_ROUTE(app, "/").methods("POST"_method)([](const request& req){
+        size_t sum = 0;
+        for(unsigned char c : req.body)
+            sum += c;
+        return std::to_string(req.body.size()) + " " + std::to_string(sum);
+    });
+
+    std::string body(3 * 1024 * 1024 + 7, 0);
+    size_t sum = 0;
+    for(size_t i = 0; i < body.size(); i ++)
+    {
+        body[i] = (char)(i * 31 % 251);
+        sum += (unsigned char)body[i];
+    }
+    std::string message = "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    std::string expected = std::to_string(body.size()) + " " + std::to_string(sum);
+
+    // the same requests through the 4 KB buffer and read straight into the body
+    for(uint64_t threshold : {(uint64_t)0, (uint64_t)64 * 1024})
+    {
+        Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+        crow::detail::connection_settings settings;
+        settings.direct_read_threshold = threshold;
+        server.set_connection_settings(settings);
+        auto _ = async(launch::async, [&]{server.run();});
+
+        asio::io_service is;
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        // keep-alive: the second request reuses the recycled buffer
+        for(int i = 0; i < 2; i ++)
+        {
+            asio::write(c, asio::buffer(message));
+            std::string response;
+            char buf[2048];
+            size_t header_end;
+            while((header_end = response.find("\r\n\r\n")) == std::string::npos ||
+                response.size() < header_end + 4 + std::stoul(response.substr(response.find("Content-Length: ") + 16)))
+            {
+                size_t recved = c.receive(asio::buffer(buf, 2048));
+                response.append(buf, recved);
+            }
+            ASSERT_EQUAL(expected, response.substr(header_end + 4));
+        }
+        server.stop();
+    }
+}
+
+struct parser_test_handler
+{
+    void handle_header() {}
+    void handle_body_too_large(uint64_t) {}
+    void handle() { handled ++; }
+    int handled = 0;
+};
+
+TEST(parser_moves_and_recycles_body)
+{
+    parser_test_handler handler;
+    HTTPParser<parser_test_handler> parser(&handler);
+    std::string body(100000, 'a');
+    std::string message = "POST /upload?x=1 HTTP/1.1\r\nHost: a\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    ASSERT_TRUE(parser.feed(message.data(), message.size()));
+    ASSERT_EQUAL(1, handler.handled);
+    const char* buffer = parser.body.data();
+    request req = std::move(parser).to_request();
+    ASSERT_TRUE(req.body == body);
+    ASSERT_TRUE(req.body.data() == buffer);
+    ASSERT_EQUAL("1", std::string(req.url_params.get("x")));
+    ASSERT_TRUE(parser.body.empty());
+
+    // the next message on the connection is received into the same buffer
+    parser.recycle_body(req.body);
+    ASSERT_TRUE(req.body.empty());
+    ASSERT_TRUE(parser.feed(message.data(), message.size()));
+    ASSERT_EQUAL(2, handler.handled);
+    ASSERT_TRUE(parser.body.data() == buffer);
+    ASSERT_TRUE(parser.body == body);
+
+    // large buffers are not kept by an idle connection
+    request large = std::move(parser).to_request();
+    large.body.reserve(2 * 1024 * 1024);
+    parser.recycle_body(large.body);
+    ASSERT_TRUE(parser.body.capacity() < 2 * 1024 * 1024);
+}
+
+TEST(direct_body_grows_in_steps)
+{
+    parser_test_handler handler;
+    HTTPParser<parser_test_handler> parser(&handler);
+    const size_t size = 8 * 1024 * 1024 + 3;
+    std::string header = "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: " + std::to_string(size) + "\r\n\r\n";
+    ASSERT_TRUE(parser.feed(header.data(), header.size()));
+    ASSERT_TRUE(parser.can_read_body_directly(64 * 1024));
+
+    // only headers received: the announced body is not allocated up front
+    size_t length;
+    char* data = parser.direct_body_buffer(length);
+    ASSERT_TRUE(length <= 1024 * 1024);
+    ASSERT_TRUE(parser.body.size() <= 1024 * 1024);
+
+    size_t sent = 0;
+    while(sent < size)
+    {
+        data = parser.direct_body_buffer(length);
+        length = std::min<size_t>(length, 300 * 1024);
+        length = std::min(length, size - sent);
+        std::memset(data, 'a' + (int)(sent % 26), length);
+        ASSERT_TRUE(parser.feed(data, length));
+        sent += length;
+        ASSERT_TRUE(parser.body.size() <= sent + 1024 * 1024);
+    }
+    ASSERT_EQUAL(1, handler.handled);
+    ASSERT_EQUAL(size, parser.body.size());
+}
+
+TEST(timer_wheel)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto at = [&](int ms){ return start + std::chrono::milliseconds(ms); };
+    crow::detail::timer_wheel wheel(std::chrono::milliseconds(10), start);
+    std::vector<int> fired;
+
+    // one timer per level of the wheel, added out of order
+    for(int ms : {300000, 50, 700, 20, 1000000, 45000})
+        wheel.add(std::chrono::milliseconds(ms), [&fired, ms]{ fired.push_back(ms); });
+    auto cancelled = wheel.add(std::chrono::milliseconds(700), [&fired]{ fired.push_back(-1); });
+    // rounded up to the granularity, never due at once
+    wheel.add(std::chrono::milliseconds(0), [&fired]{ fired.push_back(0); });
+    ASSERT_EQUAL(8u, wheel.size());
+    wheel.cancel(cancelled);
+    wheel.cancel(cancelled);
+    ASSERT_EQUAL(7u, wheel.size());
+
+    wheel.process(at(9));
+    ASSERT_EQUAL(0u, fired.size());
+    wheel.process(at(10));
+    ASSERT_EQUAL(1u, fired.size());
+    wheel.process(at(49));
+    ASSERT_EQUAL(2u, fired.size());
+    wheel.process(at(699));
+    ASSERT_EQUAL(3u, fired.size());
+    // a late call catches up on every missed tick
+    wheel.process(at(1000000));
+    ASSERT_EQUAL(0u, wheel.size());
+    ASSERT_TRUE((fired == std::vector<int>{0, 20, 50, 700, 45000, 300000, 1000000}));
+
+    // a stale key does not cancel the timer reusing its slot
+    fired.clear();
+    wheel.add(std::chrono::milliseconds(10), [&fired]{ fired.push_back(1); });
+    cancelled.wheel = &wheel;
+    wheel.cancel(cancelled);
+    ASSERT_EQUAL(1u, wheel.size());
+
+    // two timers due at the same tick cancelling each other: only the first one runs
+    crow::detail::timer_wheel::key a, b;
+    a = wheel.add(std::chrono::milliseconds(20), [&]{ fired.push_back(2); wheel.cancel(b); });
+    b = wheel.add(std::chrono::milliseconds(20), [&]{ fired.push_back(2); wheel.cancel(a); });
+    wheel.process(at(1000030));
+    ASSERT_TRUE((fired == std::vector<int>{1, 2}));
+    ASSERT_EQUAL(0u, wheel.size());
+}
+
+TEST(connection_timeouts)
+{
+    static char buf[2048];
+    SimpleApp app;
+    response* pending = nullptr;
+    boost::asio::io_service* pending_io = nullptr;
+    CROW_ROUTE(app, "/")([]{ return "ok"; });
+    CROW_ROUTE(app, "/big")([]{ return std::string(32 * 1024 * 1024, 'x'); });
+    CROW_ROUTE(app, "/slow")([&](const request& req, response& res){
+        // completed from outside, after the deadline
+        pending = &res;
+        pending_io = req.io_service;
+    });
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+    crow::detail::connection_settings settings;
+    settings.timer_granularity_ms = 10;
+    settings.read_timeout_ms = 100;
+    settings.handler_timeout_ms = 200;
+    server.set_connection_settings(settings);
+    auto _ = async(launch::async, [&]{server.run();});
+
+    asio::io_service is;
+    {
+        // idle keep-alive connection is closed by the read deadline
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("GET / HTTP/1.1\r\nHost: a\r\n\r\n")));
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL("ok", std::string(buf + recved - 2, buf + recved));
+        auto start = std::chrono::steady_clock::now();
+        boost::system::error_code ec;
+        c.receive(asio::buffer(buf, 2048), 0, ec);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        ASSERT_TRUE(ec == asio::error::eof);
+        ASSERT_TRUE(elapsed >= std::chrono::milliseconds(90) && elapsed < std::chrono::seconds(2));
+    }
+    {
+        // a slow reader is not cut off by the read deadline while the response is being written
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("GET /big HTTP/1.1\r\nHost: a\r\n\r\n")));
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        std::string response;
+        size_t header_end;
+        boost::system::error_code ec;
+        while(!ec && ((header_end = response.find("\r\n\r\n")) == std::string::npos ||
+            response.size() < header_end + 4 + 32 * 1024 * 1024))
+        {
+            size_t recved = c.receive(asio::buffer(buf, 2048), 0, ec);
+            response.append(buf, recved);
+        }
+        ASSERT_TRUE(!ec);
+    }
+    {
+        // a handler past its deadline loses the connection
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string("GET /slow HTTP/1.1\r\nHost: a\r\n\r\n")));
+        auto start = std::chrono::steady_clock::now();
+        boost::system::error_code ec;
+        c.receive(asio::buffer(buf, 2048), 0, ec);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        ASSERT_TRUE(ec == asio::error::eof);
+        ASSERT_TRUE(elapsed >= std::chrono::milliseconds(190) && elapsed < std::chrono::seconds(2));
+        ASSERT_TRUE(pending != nullptr);
+        if (pending)
+        {
+            // finishing late only releases the connection
+            pending_io->post([&]{ pending->end(); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    server.stop();
+}
+
+TEST(accept_limits)
+{
+    static char buf[2048];
+    SimpleApp app;
+    CROW_ROUTE(app, "/").methods("GET"_method, "POST"_method)([](const request& req){ return std::to_string(req.body.size()); });
+
+    auto connect = [](asio::ip::tcp::socket& c)
+    {
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    };
+    auto settle = []{ std::this_thread::sleep_for(std::chrono::milliseconds(100)); };
+
+    for(int by_body_bytes = 0; by_body_bytes < 2; by_body_bytes ++)
+    {
+        Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+        crow::detail::connection_settings settings;
+        if (by_body_bytes)
+            settings.max_body_bytes_in_flight = 4000;
+        else
+            settings.max_connections = 2;
+        settings.low_water_percent = 50;
+        server.set_connection_settings(settings);
+        auto _ = async(launch::async, [&]{server.run();});
+
+        asio::io_service is;
+        asio::ip::tcp::socket a(is), b(is), c(is);
+        connect(a);
+        // a body still being received holds its reserved size
+        a.send(asio::buffer(std::string("POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 5000\r\n\r\n01234")));
+        settle();
+        connect(b);
+        settle();
+        ASSERT_TRUE(server.accept_paused());
+
+        // completes the handshake in the kernel backlog but is not served yet
+        connect(c);
+        c.send(asio::buffer(std::string("GET / HTTP/1.1\r\nHost: a\r\n\r\n")));
+        settle();
+        ASSERT_EQUAL(0u, c.available());
+
+        if (by_body_bytes)
+        {
+            a.send(asio::buffer(std::string(4995, 'x')));
+            size_t recved = a.receive(asio::buffer(buf, 2048));
+            ASSERT_EQUAL("5000", std::string(buf + recved - 4, buf + recved));
+        }
+        else
+        {
+            a.close();
+            b.close();
+        }
+        size_t recved = c.receive(asio::buffer(buf, 2048));
+        ASSERT_EQUAL("0", std::string(buf + recved - 1, buf + recved));
+        ASSERT_TRUE(!server.accept_paused());
+        server.stop();
+    }
+}
+
+TEST(drain)
+{
+    static char buf[2048];
+    SimpleApp app;
+    response* pending = nullptr;
+    boost::asio::io_service* pending_io = nullptr;
+    CROW_ROUTE(app, "/slow")([&](const request& req, response& res){
+        pending = &res;
+        pending_io = req.io_service;
+    });
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+    auto _ = async(launch::async, [&]{server.run();});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    asio::io_service is;
+    asio::ip::tcp::socket a(is);
+    a.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+    a.send(asio::buffer(std::string("GET /slow HTTP/1.1\r\nHost: a\r\nConnection: Keep-Alive\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(pending != nullptr);
+
+    // the handler is still running
+    ASSERT_TRUE(!server.drain(std::chrono::milliseconds(100)));
+    {
+        asio::ip::tcp::socket b(is);
+        boost::system::error_code ec;
+        b.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451), ec);
+        ASSERT_TRUE(!!ec);
+    }
+
+    auto drained = async(launch::async, [&]{ return server.drain(std::chrono::seconds(2)); });
+    if (pending)
+        pending_io->post([&]{ pending->write("done"); pending->end(); });
+    ASSERT_TRUE(drained.get());
+
+    // answered, then closed despite keep-alive
+    std::string response;
+    boost::system::error_code ec;
+    while(!ec)
+    {
+        size_t recved = a.receive(asio::buffer(buf, 2048), 0, ec);
+        response.append(buf, recved);
+    }
+    ASSERT_TRUE(ec == asio::error::eof);
+    ASSERT_TRUE(response.find("connection: close\r\n") != std::string::npos);
+    ASSERT_EQUAL("done", response.substr(response.size() - 4));
+    server.stop();
+}
+
+TEST(deferred_response_on_closing_connection)
+{
+    static char buf[2048];
+    SimpleApp app;
+    std::vector<std::thread> workers;
+    CROW_ROUTE(app, "/")([&](const request& req, response& res){
+        // completed from another thread after the handler returned, like the response compression
+        auto io_service = req.io_service;
+        auto response = &res;
+        workers.emplace_back([io_service, response]{
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            response->body = "done";
+            io_service->post([response]{ response->end(); });
+        });
+    });
+
+    Server<SimpleApp> server(&app, LOCALHOST_ADDRESS, 45451);
+    auto _ = async(launch::async, [&]{server.run();});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    asio::io_service is;
+    for(auto request : {"GET / HTTP/1.1\r\nHost: a\r\nConnection: close\r\n\r\n", "GET / HTTP/1.0\r\n\r\n"})
+    {
+        asio::ip::tcp::socket c(is);
+        c.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(LOCALHOST_ADDRESS), 45451));
+        c.send(asio::buffer(std::string(request)));
+        std::string response;
+        boost::system::error_code ec;
+        while(!ec)
+        {
+            size_t recved = c.receive(asio::buffer(buf, 2048), 0, ec);
+            response.append(buf, recved);
+        }
+        ASSERT_TRUE(ec == asio::error::eof);
+        ASSERT_EQUAL("HTTP/1.1 200", response.substr(0, 12));
+        ASSERT_EQUAL("done", response.substr(response.size() - 4));
+    }
+    server.stop();
+    for(auto& worker : workers)
+        worker.join();
+}
+
 TEST(json_read)
 {
 	{
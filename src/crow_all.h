@@ -317,6 +317,11 @@ namespace crow
             return *this;
         }
 
+        query_string(query_string&& qs)
+        {
+            *this = std::move(qs);
+        }
+
         query_string& operator = (query_string&& qs)
         {
             key_value_pairs_ = std::move(qs.key_value_pairs_);
@@ -3991,83 +3996,203 @@ namespace crow
 
 #pragma once
 
-#include <boost/asio.hpp>
-#include <deque>
-#include <functional>
 #include <chrono>
-#include <thread>
-
-
+#include <cstdint>
+#include <functional>
+#include <vector>
 
 
 namespace crow
 {
-    namespace detail 
+    namespace detail
     {
-        // fast timer queue for fixed tick value.
-        class dumb_timer_queue
+        // hierarchical hashed timing wheel: O(1) add and cancel, expiry at a fixed granularity.
+        // levels of 64 slots; a timer sits in the level its remaining ticks fall into and moves
+        // down a level each time the level below wraps around.
+        // not thread safe, owned by one io_service thread like the connections using it.
+        class timer_wheel
         {
         public:
-            using key = std::pair<dumb_timer_queue*, int>;
+            struct key
+            {
+                timer_wheel* wheel{};
+                uint32_t index{};
+                uint32_t generation{};
+            };
 
-            void cancel(key& k)
+            explicit timer_wheel(std::chrono::milliseconds granularity = std::chrono::milliseconds(100),
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now())
+                : granularity_(granularity.count() > 0 ? granularity : std::chrono::milliseconds(1)), start_(start)
             {
-                auto self = k.first;
-                k.first = nullptr;
-                if (!self)
-                    return;
+                for(auto& head : slots_)
+                    head = npos;
+            }
 
-                unsigned int index = (unsigned int)(k.second - self->step_);
-                if (index < self->dq_.size())
-                    self->dq_[index].second = nullptr;
+            std::chrono::milliseconds granularity() const
+            {
+                return granularity_;
             }
 
-            key add(std::function<void()> f)
+            // f runs from process() once delay has passed, rounded up to the granularity
+            key add(std::chrono::milliseconds delay, std::function<void()> f)
             {
-                dq_.emplace_back(std::chrono::steady_clock::now(), std::move(f));
-                int ret = step_+dq_.size()-1;
+                uint32_t index;
+                if (free_ != npos)
+                {
+                    index = free_;
+                    free_ = nodes_[index].next;
+                }
+                else
+                {
+                    index = (uint32_t)nodes_.size();
+                    nodes_.emplace_back();
+                }
+                uint64_t ticks = (delay.count() + granularity_.count() - 1) / granularity_.count();
+                node& n = nodes_[index];
+                n.f = std::move(f);
+                n.expiry = now_ + (ticks ? ticks : 1);
+                place(index);
+                ++ size_;
+                CROW_LOG_DEBUG << "timer add: " << this << ' ' << index << " at tick " << n.expiry;
+                key k;
+                k.wheel = this;
+                k.index = index;
+                k.generation = n.generation;
+                return k;
+            }
 
-                CROW_LOG_DEBUG << "timer add inside: " << this << ' ' << ret ;
-                return {this, ret};
+            void cancel(key& k)
+            {
+                auto self = k.wheel;
+                k.wheel = nullptr;
+                if (!self || k.index >= self->nodes_.size())
+                    return;
+                node& n = self->nodes_[k.index];
+                if (n.generation != k.generation || n.slot == npos)
+                    return;
+                self->unlink(k.index);
+                self->release(k.index);
             }
 
-            void process()
+            // runs the timers due up to now; ticks missed by a late call are caught up in order
+            void process(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
             {
-                if (!io_service_)
+                if (now < start_)
                     return;
+                uint64_t target = (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count() / granularity_.count());
+                while(now_ < target)
+                    tick();
+            }
 
-                auto now = std::chrono::steady_clock::now();
-                while(!dq_.empty())
-                {
-                    auto& x = dq_.front();
-                    if (now - x.first < std::chrono::seconds(tick))
-                        break;
-                    if (x.second)
-                    {
-                        CROW_LOG_DEBUG << "timer call: " << this << ' ' << step_;
-                        // we know that timer handlers are very simple currenty; call here
-                        x.second();
-                    }
-                    dq_.pop_front();
-                    step_++;
-                }
+            size_t size() const
+            {
+                return size_;
             }
 
-            void set_io_service(boost::asio::io_service& io_service)
+        private:
+            static const int slot_bits = 6;
+            static const uint32_t slot_count = 1 << slot_bits;
+            static const int levels = 4;
+            static const uint32_t npos = 0xffffffff;
+
+            struct node
+            {
+                std::function<void()> f;
+                uint64_t expiry{};
+                uint32_t prev{npos};
+                uint32_t next{npos};
+                uint32_t slot{npos};
+                uint32_t generation{};
+            };
+
+            void place(uint32_t index)
             {
-                io_service_ = &io_service;
+                node& n = nodes_[index];
+                uint64_t remaining = n.expiry > now_ ? n.expiry - now_ : 0;
+                int level = 0;
+                while(level < levels - 1 && remaining >= ((uint64_t)1 << (slot_bits * (level + 1))))
+                    ++ level;
+                uint64_t expiry = n.expiry;
+                // beyond the top level: park in the farthest top slot, placed again when it cascades
+                if (remaining >= ((uint64_t)1 << (slot_bits * levels)))
+                    expiry = now_ + ((uint64_t)1 << (slot_bits * levels)) - 1;
+                uint32_t slot = level * slot_count + (uint32_t)((expiry >> (slot_bits * level)) & (slot_count - 1));
+
+                n.slot = slot;
+                n.prev = npos;
+                n.next = slots_[slot];
+                if (n.next != npos)
+                    nodes_[n.next].prev = index;
+                slots_[slot] = index;
             }
 
-            dumb_timer_queue() noexcept
+            void unlink(uint32_t index)
             {
+                node& n = nodes_[index];
+                if (n.prev != npos)
+                    nodes_[n.prev].next = n.next;
+                else
+                    slots_[n.slot] = n.next;
+                if (n.next != npos)
+                    nodes_[n.next].prev = n.prev;
+                n.slot = npos;
             }
 
-        private:
+            void release(uint32_t index)
+            {
+                node& n = nodes_[index];
+                n.f = nullptr;
+                ++ n.generation;
+                n.next = free_;
+                free_ = index;
+                -- size_;
+            }
+
+            // moves the timers of a higher level slot down to where their remaining ticks belong
+            void cascade(int level)
+            {
+                uint32_t slot = level * slot_count + (uint32_t)((now_ >> (slot_bits * level)) & (slot_count - 1));
+                uint32_t index = slots_[slot];
+                slots_[slot] = npos;
+                while(index != npos)
+                {
+                    uint32_t next = nodes_[index].next;
+                    place(index);
+                    index = next;
+                }
+            }
+
+            void tick()
+            {
+                ++ now_;
+                for(int level = 1; level < levels; ++ level)
+                {
+                    if ((now_ >> (slot_bits * (level - 1))) & (slot_count - 1))
+                        break;
+                    cascade(level);
+                }
 
-            int tick{5};
-            boost::asio::io_service* io_service_{};
-            std::deque<std::pair<decltype(std::chrono::steady_clock::now()), std::function<void()>>> dq_;
-            int step_{};
+                uint32_t slot = (uint32_t)(now_ & (slot_count - 1));
+                // one at a time: a callback may cancel other timers of this slot
+                while(slots_[slot] != npos)
+                {
+                    uint32_t index = slots_[slot];
+                    unlink(index);
+                    std::function<void()> f = std::move(nodes_[index].f);
+                    release(index);
+                    CROW_LOG_DEBUG << "timer call: " << this << ' ' << index << " at tick " << now_;
+                    if (f)
+                        f();
+                }
+            }
+
+            std::chrono::milliseconds granularity_;
+            std::chrono::steady_clock::time_point start_;
+            uint64_t now_{};
+            uint32_t slots_[levels * slot_count];
+            std::vector<node> nodes_;
+            uint32_t free_{npos};
+            size_t size_{};
         };
     }
 }
@@ -6501,6 +6626,7 @@ namespace crow
 #include <unordered_map>
 #include <boost/algorithm/string.hpp>
 #include <algorithm>
+#include <cstring>
 
 
 
@@ -6565,18 +6691,52 @@ namespace crow
             {
                 self->headers.emplace(std::move(self->header_field), std::move(self->header_value));
             }
+            if (self->content_length != CROW_ULLONG_MAX && self->content_length > 0)
+            {
+                // rejected before any of the body is read, the connection answers 413 and closes
+                if (self->max_body_size && self->content_length > self->max_body_size)
+                {
+                    self->reject_body(self->content_length);
+                    return -1;
+                }
+                // the declared length is only trusted up to max_body_reserve when there is no limit
+                self->body.reserve(self->max_body_size ? self->content_length : std::min<uint64_t>(self->content_length, max_body_reserve));
+                self->reading_body = !(self->flags & F_CHUNKED);
+            }
             self->process_header();
             return 0;
         }
         static int on_body(http_parser* self_, const char* at, size_t length)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
-            self->body.insert(self->body.end(), at, at+length);
+            if (self->direct_body)
+            {
+                // normally read in place by the connection, nothing to copy
+                if (self->body.size() < self->direct_body_end + length)
+                    self->body.resize(self->direct_body_end + length);
+                if (at != &self->body[self->direct_body_end])
+                    std::memcpy(&self->body[self->direct_body_end], at, length);
+                self->direct_body_end += length;
+                return 0;
+            }
+            // chunked bodies have no Content-Length, check as they grow
+            if (self->max_body_size && self->body.size() + length > self->max_body_size)
+            {
+                self->reject_body(self->body.size() + length);
+                return -1;
+            }
+            self->body.append(at, length);
             return 0;
         }
         static int on_message_complete(http_parser* self_)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
+            if (self->direct_body)
+            {
+                self->body.resize(self->direct_body_end);
+                self->direct_body = false;
+            }
+            self->reading_body = false;
 
             // url params
             self->url = self->raw_url.substr(0, self->raw_url.find("?"));
@@ -6624,6 +6784,9 @@ namespace crow
             headers.clear();
             url_params.clear();
             body.clear();
+            body_too_large = false;
+            reading_body = false;
+            direct_body = false;
         }
 
         void process_header()
@@ -6631,16 +6794,65 @@ namespace crow
             handler_->handle_header();
         }
 
+        // true when the rest of a Content-Length body is large enough to be read straight into body
+        bool can_read_body_directly(uint64_t threshold) const
+        {
+            if (direct_body)
+                return true;
+            return reading_body && threshold && content_length >= threshold &&
+                (max_body_size || content_length <= max_body_reserve);
+        }
+
+        // where the rest of the body goes; the bytes read there are then passed to feed() in place.
+        // the reserved capacity is only sized (and touched) up to direct_body_step ahead of the bytes received,
+        // a client announcing a large body without sending it holds little more than the step
+        char* direct_body_buffer(size_t& length)
+        {
+            if (!direct_body)
+            {
+                direct_body = true;
+                direct_body_end = body.size();
+            }
+            if (body.size() == direct_body_end)
+                body.resize(direct_body_end + std::min<uint64_t>(content_length, direct_body_step));
+            length = body.size() - direct_body_end;
+            return &body[direct_body_end];
+        }
+
+        void reject_body(uint64_t size)
+        {
+            body_too_large = true;
+            handler_->handle_body_too_large(size);
+        }
+
         void process_message()
         {
             handler_->handle();
         }
 
-        request to_request() const
+        request to_request() const &
+        {
+            return request{(HTTPMethod)method, raw_url, url, url_params, headers, body};
+        }
+
+        // the parser is cleared at the next message anyway, hand the buffers over instead of copying them
+        request to_request() &&
         {
             return request{(HTTPMethod)method, std::move(raw_url), std::move(url), std::move(url_params), std::move(headers), std::move(body)};
         }
 
+        // takes back the body buffer of a finished request so the next message on the connection
+        // reuses its capacity; skipped while a new body is already being received.
+        // an idle keep-alive connection keeps at most max_body_recycle, larger buffers go back to malloc
+        void recycle_body(std::string& old_body)
+        {
+            if (body.empty() && old_body.capacity() > body.capacity() && old_body.capacity() <= max_body_recycle)
+            {
+                old_body.clear();
+                body.swap(old_body);
+            }
+        }
+
 		bool is_upgrade() const
 		{
 			return upgrade;
@@ -6661,8 +6873,27 @@ namespace crow
         query_string url_params;
         std::string body;
 
+        // 0: no limit
+        uint64_t max_body_size = 0;
+        bool body_too_large = false;
+        // a Content-Length body is being received, content_length is what is left of it
+        bool reading_body = false;
+        // body is sized ahead of the bytes received and filled up to direct_body_end
+        bool direct_body = false;
+        size_t direct_body_end = 0;
+        static const uint64_t max_body_reserve = 16 * 1024 * 1024;
+        static const uint64_t direct_body_step = 1024 * 1024;
+        static const uint64_t max_body_recycle = 1024 * 1024;
+
         Handler* handler_;
     };
+
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::max_body_reserve;
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::direct_body_step;
+    template <typename Handler>
+    const uint64_t HTTPParser<Handler>::max_body_recycle;
 }
 
 
@@ -8808,6 +9039,52 @@ namespace crow
         }
     }
 
+    namespace detail
+    {
+        // load of one worker io_service: updated by its connections, read when picking a worker
+        struct worker_load
+        {
+            std::atomic<int> connections{0};
+            std::atomic<int> handlers{0};
+            // capacity of the request bodies being received or handled
+            std::atomic<int64_t> body_bytes{0};
+            // responses being written
+            std::atomic<int> writes{0};
+        };
+
+        // limits and hooks shared by all connections of a server
+        struct connection_settings
+        {
+            // 0: no limit; larger bodies are answered with 413 as soon as the headers are parsed
+            uint64_t max_body_size{0};
+            // called with the body size of each request, rejected is true for a 413
+            std::function<void(uint64_t size, bool rejected)> on_request_body;
+            // bodies with at least this much left are read straight into the request body
+            // instead of through the 4 KB buffer; 0 disables
+            uint64_t direct_read_threshold{64 * 1024};
+            // tick of the per-worker timer wheel, deadlines are rounded up to it
+            uint64_t timer_granularity_ms{100};
+            // the connection is closed when a deadline passes; 0 disables it
+            // waiting for (the rest of) a request, keep-alive idle time included
+            uint64_t read_timeout_ms{5000};
+            // writing one response to the peer
+            uint64_t write_timeout_ms{0};
+            // from routing a request until the handler completes the response.
+            // the wheel runs on the connection's io thread: a handler blocking that thread is not
+            // interrupted, only responses completed later (from another thread) are covered
+            uint64_t handler_timeout_ms{0};
+            // accepting pauses at this many connections or body bytes in flight, 0: no limit
+            uint64_t max_connections{0};
+            uint64_t max_body_bytes_in_flight{0};
+            // and resumes once both are below this percentage of their limit
+            uint64_t low_water_percent{90};
+            // set by the server: a connection closed or released body bytes
+            std::function<void()> on_released;
+            // set by the server: while draining, every response closes its connection
+            const std::atomic<bool>* draining{};
+        };
+    }
+
 #ifdef CROW_ENABLE_DEBUG
     static std::atomic<int> connectionCount;
 #endif
@@ -8821,8 +9098,10 @@ namespace crow
             const std::string& server_name,
             std::tuple<Middlewares...>* middlewares,
             std::function<std::string()>& get_cached_date_str_f,
-            detail::dumb_timer_queue& timer_queue,
-            typename Adaptor::context* adaptor_ctx_
+            detail::timer_wheel& timer_queue,
+            typename Adaptor::context* adaptor_ctx_,
+            detail::worker_load& load,
+            const detail::connection_settings& settings
             ) 
             : adaptor_(io_service, adaptor_ctx_), 
             handler_(handler), 
@@ -8830,8 +9109,12 @@ namespace crow
             server_name_(server_name),
             middlewares_(middlewares),
             get_cached_date_str(get_cached_date_str_f),
-            timer_queue(timer_queue)
+            timer_queue(timer_queue),
+            load_(load),
+            settings_(settings)
         {
+            parser_.max_body_size = settings_.max_body_size;
+            load_.connections ++;
 #ifdef CROW_ENABLE_DEBUG
             connectionCount ++;
             CROW_LOG_DEBUG << "Connection open, total " << connectionCount << ", " << this;
@@ -8841,7 +9124,14 @@ namespace crow
         ~Connection()
         {
             res.complete_request_handler_ = nullptr;
-            cancel_deadline_timer();
+            cancel_deadline(read_timer_);
+            cancel_deadline(write_timer_);
+            cancel_deadline(handler_timer_);
+            leave_handler();
+            update_body_bytes(true);
+            load_.connections --;
+            if (settings_.on_released)
+                settings_.on_released();
 #ifdef CROW_ENABLE_DEBUG
             connectionCount --;
             CROW_LOG_DEBUG << "Connection closed, total " << connectionCount << ", " << this;
@@ -8858,7 +9148,7 @@ namespace crow
             adaptor_.start([this](const boost::system::error_code& ec) {
                 if (!ec)
                 {
-                    start_deadline();
+                    start_deadline(read_timer_, settings_.read_timeout_ms);
 
                     do_read();
                 }
@@ -8869,6 +9159,18 @@ namespace crow
             });
         }
 
+        void handle_body_too_large(uint64_t size)
+        {
+            CROW_LOG_INFO << "Request body too large: " << this << ' ' << size << " > " << parser_.max_body_size;
+            if (settings_.on_request_body)
+                settings_.on_request_body(size, true);
+            // the rest of the body is never read, the connection closes after the response
+            close_connection_ = true;
+            add_keep_alive_ = false;
+            res = response(413);
+            complete_request();
+        }
+
         void handle_header()
         {
             // HTTP 1.1 Expect: 100-continue
@@ -8883,12 +9185,14 @@ namespace crow
 
         void handle()
         {
-            cancel_deadline_timer();
+            cancel_deadline(read_timer_);
             bool is_invalid_request = false;
             add_keep_alive_ = false;
 
-            req_ = std::move(parser_.to_request());
+            req_ = std::move(parser_).to_request();
             request& req = req_;
+            if (settings_.on_request_body)
+                settings_.on_request_body(req.body.size(), false);
 
             if (parser_.check_version(1, 0))
             {
@@ -8951,6 +9255,9 @@ namespace crow
                 {
                     res.complete_request_handler_ = [this]{ this->complete_request(); };
                     need_to_call_after_handlers_ = true;
+                    in_handler_ = true;
+                    load_.handlers ++;
+                    start_deadline(handler_timer_, settings_.handler_timeout_ms);
                     handler_->handle(req, res);
                     if (add_keep_alive_)
                         res.set_header("connection", "Keep-Alive");
@@ -8969,6 +9276,9 @@ namespace crow
         void complete_request()
         {
             CROW_LOG_INFO << "Response: " << this << ' ' << req_.raw_url << ' ' << res.code << ' ' << close_connection_;
+            leave_handler();
+            cancel_deadline(handler_timer_);
+            update_body_bytes();
 
             if (need_to_call_after_handlers_)
             {
@@ -8984,11 +9294,19 @@ namespace crow
 
             //auto self = this->shared_from_this();
             res.complete_request_handler_ = nullptr;
+            // the request is finished with its response, its body buffer serves the next request
+            parser_.recycle_body(req_.body);
             
             if (!adaptor_.is_open())
             {
-                //CROW_LOG_DEBUG << this << " delete (socket is closed) " << is_reading << ' ' << is_writing;
-                //delete this;
+                // closed by the handler deadline: no read is pending to clean up the connection
+                if (need_to_start_read_after_complete_)
+                {
+                    need_to_start_read_after_complete_ = false;
+                    is_reading = false;
+                    CROW_LOG_DEBUG << this << " from complete_request (socket is closed)";
+                    check_destroy();
+                }
                 return;
             }
 
@@ -9007,6 +9325,7 @@ namespace crow
                 {401, "HTTP/1.1 401 Unauthorized\r\n"},
                 {403, "HTTP/1.1 403 Forbidden\r\n"},
                 {404, "HTTP/1.1 404 Not Found\r\n"},
+                {413, "HTTP/1.1 413 Payload Too Large\r\n"},
                 {422, "HTTP/1.1 422 Unprocessable Entity\r\n"},
 
                 {500, "HTTP/1.1 500 Internal Server Error\r\n"},
@@ -9021,6 +9340,14 @@ namespace crow
             buffers_.clear();
             buffers_.reserve(4*(res.headers.size()+5)+3);
 
+            // keep-alive clients send their next request to another instance
+            if (settings_.draining && *settings_.draining && !close_connection_)
+            {
+                close_connection_ = true;
+                add_keep_alive_ = false;
+                res.set_header("connection", "close");
+            }
+
             if (res.body.empty() && res.json_value.t() == json::type::Object)
             {
                 res.body = json::dump(res.json_value);
@@ -9084,7 +9411,13 @@ namespace crow
             if (need_to_start_read_after_complete_)
             {
                 need_to_start_read_after_complete_ = false;
-                start_deadline();
+                if (close_connection_)
+                {
+                    // the write in flight keeps the connection until it closes the adaptor
+                    is_reading = false;
+                    return;
+                }
+                start_read_deadline();
                 do_read();
             }
         }
@@ -9094,57 +9427,86 @@ namespace crow
         {
             //auto self = this->shared_from_this();
             is_reading = true;
+            if (parser_.can_read_body_directly(settings_.direct_read_threshold))
+            {
+                size_t length;
+                char* data = parser_.direct_body_buffer(length);
+                adaptor_.socket().async_read_some(boost::asio::buffer(data, length), 
+                    [this, data](const boost::system::error_code& ec, std::size_t bytes_transferred)
+                    {
+                        handle_read(ec, data, bytes_transferred);
+                    });
+                return;
+            }
             adaptor_.socket().async_read_some(boost::asio::buffer(buffer_), 
                 [this](const boost::system::error_code& ec, std::size_t bytes_transferred)
                 {
-                    bool error_while_reading = true;
-                    if (!ec)
-                    {
-                        bool ret = parser_.feed(buffer_.data(), bytes_transferred);
-                        if (ret && adaptor_.is_open())
-                        {
-                            error_while_reading = false;
-                        }
-                    }
-
-                    if (error_while_reading)
-                    {
-                        cancel_deadline_timer();
-                        parser_.done();
-                        adaptor_.close();
-                        is_reading = false;
-                        CROW_LOG_DEBUG << this << " from read(1)";
-                        check_destroy();
-                    }
-                    else if (close_connection_)
-                    {
-                        cancel_deadline_timer();
-                        parser_.done();
-                        is_reading = false;
-                        check_destroy();
-                        // adaptor will close after write
-                    }
-                    else if (!need_to_call_after_handlers_)
-                    {
-                        start_deadline();
-                        do_read();
-                    }
-                    else
-                    {
-                        // res will be completed later by user
-                        need_to_start_read_after_complete_ = true;
-                    }
+                    handle_read(ec, buffer_.data(), bytes_transferred);
                 });
         }
 
+        void handle_read(const boost::system::error_code& ec, const char* data, std::size_t bytes_transferred)
+        {
+            bool error_while_reading = true;
+            if (!ec)
+            {
+                bool ret = parser_.feed(data, bytes_transferred);
+                update_body_bytes();
+                // a rejected body stops the parser, the 413 is still being written
+                if ((ret || parser_.body_too_large) && adaptor_.is_open())
+                {
+                    error_while_reading = false;
+                }
+            }
+
+            if (error_while_reading)
+            {
+                cancel_deadline(read_timer_);
+                parser_.done();
+                adaptor_.close();
+                is_reading = false;
+                CROW_LOG_DEBUG << this << " from read(1)";
+                check_destroy();
+            }
+            else if (close_connection_)
+            {
+                cancel_deadline(read_timer_);
+                parser_.done();
+                if (need_to_call_after_handlers_)
+                {
+                    // res will be completed later by user: the connection and res stay alive until then,
+                    // complete_request stops reading and the write closes the connection
+                    need_to_start_read_after_complete_ = true;
+                    return;
+                }
+                is_reading = false;
+                check_destroy();
+                // adaptor will close after write
+            }
+            else if (!need_to_call_after_handlers_)
+            {
+                start_read_deadline();
+                do_read();
+            }
+            else
+            {
+                // res will be completed later by user
+                need_to_start_read_after_complete_ = true;
+            }
+        }
+
         void do_write()
         {
             //auto self = this->shared_from_this();
             is_writing = true;
+            load_.writes ++;
+            start_deadline(write_timer_, settings_.write_timeout_ms);
             boost::asio::async_write(adaptor_.socket(), buffers_, 
                 [&](const boost::system::error_code& ec, std::size_t /*bytes_transferred*/)
                 {
                     is_writing = false;
+                    load_.writes --;
+                    cancel_deadline(write_timer_);
                     res.clear();
                     res_body_copy_.clear();
                     if (!ec)
@@ -9155,6 +9517,10 @@ namespace crow
                             CROW_LOG_DEBUG << this << " from write(1)";
                             check_destroy();
                         }
+                        else if (is_reading && !need_to_call_after_handlers_)
+                        {
+                            start_read_deadline();
+                        }
                     }
                     else
                     {
@@ -9174,17 +9540,58 @@ namespace crow
             }
         }
 
-        void cancel_deadline_timer()
+        void leave_handler()
         {
-            CROW_LOG_DEBUG << this << " timer cancelled: " << timer_cancel_key_.first << ' ' << timer_cancel_key_.second;
-            timer_queue.cancel(timer_cancel_key_);
+            if (in_handler_)
+            {
+                in_handler_ = false;
+                load_.handlers --;
+            }
         }
 
-        void start_deadline(/*int timeout = 5*/)
+        // the body being parsed and the one of the request in the handler count against max_body_bytes_in_flight
+        void update_body_bytes(bool closing = false)
         {
-            cancel_deadline_timer();
-            
-            timer_cancel_key_ = timer_queue.add([this]
+            uint64_t bytes = 0;
+            if (!closing)
+            {
+                if (parser_.reading_body || !parser_.body.empty())
+                    bytes += parser_.body.capacity();
+                if (in_handler_)
+                    bytes += req_.body.capacity();
+            }
+            if (bytes == body_bytes_)
+                return;
+            load_.body_bytes += (int64_t)bytes - (int64_t)body_bytes_;
+            bool released = bytes < body_bytes_;
+            body_bytes_ = bytes;
+            if (released && !closing && settings_.on_released)
+                settings_.on_released();
+        }
+
+        // a response being written is covered by the write deadline only,
+        // the read deadline starts again once it completes
+        void start_read_deadline()
+        {
+            if (is_writing)
+                cancel_deadline(read_timer_);
+            else
+                start_deadline(read_timer_, settings_.read_timeout_ms);
+        }
+
+        void cancel_deadline(detail::timer_wheel::key& timer)
+        {
+            CROW_LOG_DEBUG << this << " timer cancelled: " << timer.wheel << ' ' << timer.index;
+            timer_queue.cancel(timer);
+        }
+
+        void start_deadline(detail::timer_wheel::key& timer, uint64_t timeout_ms)
+        {
+            cancel_deadline(timer);
+            if (!timeout_ms)
+                return;
+
+            timer = timer_queue.add(std::chrono::milliseconds(timeout_ms), [this]
             {
                 if (!adaptor_.is_open())
                 {
@@ -9192,7 +9599,7 @@ namespace crow
                 }
                 adaptor_.close();
             });
-            CROW_LOG_DEBUG << this << " timer added: " << timer_cancel_key_.first << ' ' << timer_cancel_key_.second;
+            CROW_LOG_DEBUG << this << " timer added: " << timer.wheel << ' ' << timer.index;
         }
 
     private:
@@ -9213,21 +9620,26 @@ namespace crow
         std::string content_length_;
         std::string date_str_;
         std::string res_body_copy_;
+        uint64_t body_bytes_{};
 
-        //boost::asio::deadline_timer deadline_;
-        detail::dumb_timer_queue::key timer_cancel_key_;
+        detail::timer_wheel::key read_timer_;
+        detail::timer_wheel::key write_timer_;
+        detail::timer_wheel::key handler_timer_;
 
         bool is_reading{};
         bool is_writing{};
         bool need_to_call_after_handlers_{};
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
+        bool in_handler_{};
 
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
 
         std::function<std::string()>& get_cached_date_str;
-        detail::dumb_timer_queue& timer_queue;
+        detail::timer_wheel& timer_queue;
+        detail::worker_load& load_;
+        const detail::connection_settings& settings_;
     };
 
 }
@@ -9245,9 +9657,15 @@ namespace crow
 #include <cstdint>
 #include <atomic>
 #include <future>
+#include <thread>
 #include <vector>
+#include <limits>
+#include <utility>
 
 #include <memory>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 
 
@@ -9261,12 +9679,17 @@ namespace crow
     using namespace boost;
     using tcp = asio::ip::tcp;
 
+#ifdef SO_REUSEPORT
+    using reuse_port_option = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
     template <typename Handler, typename Adaptor = SocketAdaptor, typename ... Middlewares>
     class Server
     {
     public:
-    Server(Handler* handler, std::string bindaddr, uint16_t port, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, typename Adaptor::context* adaptor_ctx = nullptr)
-            : acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address::from_string(bindaddr), port)),
+    Server(Handler* handler, std::string bindaddr, uint16_t port, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, typename Adaptor::context* adaptor_ctx = nullptr, bool reuse_port = false)
+            : acceptor_(io_service_),
+            accept_socket_(io_service_),
             signals_(io_service_, SIGINT, SIGTERM),
             tick_timer_(io_service_),
             handler_(handler),
@@ -9276,6 +9699,33 @@ namespace crow
             middlewares_(middlewares),
             adaptor_ctx_(adaptor_ctx)
         {
+            if (concurrency_ < 1)
+                concurrency_ = 1;
+
+            for(int i = 0; i < concurrency_;  i++)
+                io_service_pool_.emplace_back(new boost::asio::io_service());
+            load_pool_.reset(new detail::worker_load[concurrency_]);
+
+            tcp::endpoint endpoint(boost::asio::ip::address::from_string(bindaddr), port);
+#ifdef SO_REUSEPORT
+            if (reuse_port)
+            {
+                // one listening socket per worker, the kernel spreads new connections between them
+                // and each worker accepts on its own io_service
+                for(auto& io_service : io_service_pool_)
+                {
+                    worker_acceptors_.emplace_back(new tcp::acceptor(*io_service));
+                    listen(*worker_acceptors_.back(), endpoint, true);
+                    // port 0: the other workers share the port picked by the first bind
+                    endpoint.port(worker_acceptors_.back()->local_endpoint().port());
+                }
+                return;
+            }
+#else
+            if (reuse_port)
+                CROW_LOG_WARNING << "SO_REUSEPORT is not supported, using a single acceptor";
+#endif
+            listen(acceptor_, endpoint, false);
         }
 
         void set_tick_function(std::chrono::milliseconds d, std::function<void()> f)
@@ -9298,11 +9748,9 @@ namespace crow
 
         void run()
         {
-            if (concurrency_ < 0)
-                concurrency_ = 1;
-
-            for(int i = 0; i < concurrency_;  i++)
-                io_service_pool_.emplace_back(new boost::asio::io_service());
+            settings_.on_released = [this]{ resume_accept(); };
+            settings_.draining = &draining_;
+            accept_paused_.reset(new std::atomic<bool>[std::max<size_t>(worker_acceptors_.size(), 1)]());
             get_cached_date_str_pool_.resize(concurrency_);
             timer_queue_pool_.resize(concurrency_);
 
@@ -9341,20 +9789,20 @@ namespace crow
                                 return date_str;
                             };
 
-                            // initializing timer queue
-                            detail::dumb_timer_queue timer_queue;
+                            // initializing timer wheel, driven once per granularity on the worker's io_service
+                            detail::timer_wheel timer_queue(std::chrono::milliseconds(settings_.timer_granularity_ms));
                             timer_queue_pool_[i] = &timer_queue;
 
-                            timer_queue.set_io_service(*io_service_pool_[i]);
+                            auto granularity = boost::posix_time::milliseconds(timer_queue.granularity().count());
                             boost::asio::deadline_timer timer(*io_service_pool_[i]);
-                            timer.expires_from_now(boost::posix_time::seconds(1));
+                            timer.expires_from_now(granularity);
 
                             std::function<void(const boost::system::error_code& ec)> handler;
                             handler = [&](const boost::system::error_code& ec){
                                 if (ec)
                                     return;
                                 timer_queue.process();
-                                timer.expires_from_now(boost::posix_time::seconds(1));
+                                timer.expires_from_now(granularity);
                                 timer.async_wait(handler);
                             };
                             timer.async_wait(handler);
@@ -9388,18 +9836,33 @@ namespace crow
             }
 
             CROW_LOG_INFO << server_name_ << " server is running at " << bindaddr_ <<":" << port_
-                          << " using " << concurrency_ << " threads";
+                          << " using " << concurrency_ << " threads"
+                          << (worker_acceptors_.empty() ? "" : " (SO_REUSEPORT acceptor per thread)");
             CROW_LOG_INFO << "Call `app.loglevel(crow::LogLevel::Warning)` to hide Info level logs.";
 
             signals_.async_wait(
-                [&](const boost::system::error_code& /*error*/, int /*signal_number*/){
-                    stop();
+                [&](const boost::system::error_code& /*error*/, int signal_number){
+                    if (!signal_function_)
+                    {
+                        stop();
+                        return;
+                    }
+                    signal_function_(signal_number);
+                    // a second signal does not wait for the first one to finish
+                    signals_.async_wait(
+                        [&](const boost::system::error_code& /*error*/, int /*signal_number*/){
+                            stop();
+                        });
                 });
 
             while(concurrency_ != init_count)
                 std::this_thread::yield();
 
-            do_accept();
+            if (worker_acceptors_.empty())
+                do_accept();
+            else
+                for(uint16_t i = 0; i < concurrency_; i ++)
+                    do_accept(i);
 
             std::thread([this]{
                 io_service_.run();
@@ -9414,47 +9877,232 @@ namespace crow
                 io_service->stop();
         }
 
+        // called on SIGINT/SIGTERM instead of stop(), on the acceptor thread: it must not block
+        void set_signal_function(std::function<void(int)> f)
+        {
+            signal_function_ = std::move(f);
+        }
+
+        // stops accepting and waits until no request is being received, handled or answered.
+        // blocks the calling thread, which must not be one of the server's; stop() is still needed afterwards.
+        // false when the timeout passed first
+        bool drain(std::chrono::milliseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            if (!draining_.exchange(true))
+            {
+                CROW_LOG_INFO << server_name_ << " server is draining";
+                io_service_.post([this]{ acceptor_.close(); });
+                for(uint16_t i = 0; i < worker_acceptors_.size(); i ++)
+                    io_service_pool_[i]->post([this, i]{ worker_acceptors_[i]->close(); });
+            }
+            while(!idle())
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return true;
+        }
+
+        void set_connection_settings(const detail::connection_settings& settings)
+        {
+            settings_ = settings;
+        }
+
+        const detail::worker_load& worker_load(uint16_t index) const
+        {
+            return load_pool_[index];
+        }
+
+        bool accept_paused() const
+        {
+            if (!accept_paused_)
+                return false;
+            for(size_t i = 0; i < std::max<size_t>(worker_acceptors_.size(), 1); i ++)
+                if (accept_paused_[i])
+                    return true;
+            return false;
+        }
+
     private:
+        static void listen(tcp::acceptor& acceptor, const tcp::endpoint& endpoint, bool reuse_port)
+        {
+            acceptor.open(endpoint.protocol());
+            acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            if (reuse_port)
+                acceptor.set_option(reuse_port_option(true));
+#endif
+            acceptor.bind(endpoint);
+            acceptor.listen();
+        }
+
+        // a worker blocked in a handler cannot serve new connections: prefer the fewest in-flight handlers,
+        // then the fewest connections; ties rotate so idle workers are still used in turn
         asio::io_service& pick_io_service()
         {
-            // TODO load balancing
-            roundrobin_index_++;
-            if (roundrobin_index_ >= io_service_pool_.size())
-                roundrobin_index_ = 0;
+            unsigned int best = roundrobin_index_;
+            std::pair<int, int> best_load{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+            for(unsigned int n = 1; n <= io_service_pool_.size(); n ++)
+            {
+                unsigned int i = (roundrobin_index_ + n) % io_service_pool_.size();
+                std::pair<int, int> load{load_pool_[i].handlers.load(), load_pool_[i].connections.load()};
+                if (load < best_load)
+                {
+                    best = i;
+                    best_load = load;
+                }
+            }
+            roundrobin_index_ = best;
             return *io_service_pool_[roundrobin_index_];
         }
 
+        // the worker is picked when the connection lands, not when the accept is armed:
+        // a handler that starts blocking in between would otherwise still get the connection
         void do_accept()
+        {
+            acceptor_.async_accept(accept_socket_,
+                [this](boost::system::error_code ec)
+                {
+                    if (!ec)
+                        hand_over();
+                    continue_accept(0);
+                });
+        }
+
+        // moves the socket accepted on the acceptor's io_service to a connection on the picked worker
+        void hand_over()
         {
             asio::io_service& is = pick_io_service();
             auto p = new Connection<Adaptor, Handler, Middlewares...>(
                 is, handler_, server_name_, middlewares_,
                 get_cached_date_str_pool_[roundrobin_index_], *timer_queue_pool_[roundrobin_index_],
-                adaptor_ctx_);
-            acceptor_.async_accept(p->socket(),
-                [this, p, &is](boost::system::error_code ec)
+                adaptor_ctx_, load_pool_[roundrobin_index_], settings_);
+            boost::system::error_code ec;
+            auto protocol = acceptor_.local_endpoint(ec).protocol();
+#if BOOST_VERSION >= 106700
+            auto fd = accept_socket_.release(ec);
+#else
+            // no socket::release() before boost 1.67: the descriptor is duplicated and the original closed
+            auto fd = ::dup(accept_socket_.native_handle());
+            accept_socket_.close(ec);
+#endif
+            if (fd < 0 || p->socket().assign(protocol, fd, ec))
+            {
+                CROW_LOG_ERROR << "Cannot hand over the accepted connection: " << (fd < 0 ? "no descriptor" : ec.message());
+                if (fd >= 0)
+                {
+#ifdef _WIN32
+                    ::closesocket(fd);
+#else
+                    ::close(fd);
+#endif
+                }
+                delete p;
+                return;
+            }
+            is.post([p]
+            {
+                p->start();
+            });
+        }
+
+        // accepting on the worker's own acceptor: the connection already runs on its io_service
+        void do_accept(uint16_t index)
+        {
+            auto p = new Connection<Adaptor, Handler, Middlewares...>(
+                *io_service_pool_[index], handler_, server_name_, middlewares_,
+                get_cached_date_str_pool_[index], *timer_queue_pool_[index],
+                adaptor_ctx_, load_pool_[index], settings_);
+            worker_acceptors_[index]->async_accept(p->socket(),
+                [this, p, index](boost::system::error_code ec)
                 {
                     if (!ec)
                     {
-                        is.post([p]
-                        {
-                            p->start();
-                        });
+                        p->start();
                     }
                     else
                     {
                         delete p;
                     }
-                    do_accept();
+                    continue_accept(index);
                 });
         }
 
+        bool idle() const
+        {
+            for(uint16_t i = 0; i < concurrency_; i ++)
+                if (load_pool_[i].handlers || load_pool_[i].body_bytes || load_pool_[i].writes)
+                    return false;
+            return true;
+        }
+
+        bool over_capacity(uint64_t percent) const
+        {
+            if (!settings_.max_connections && !settings_.max_body_bytes_in_flight)
+                return false;
+            int64_t connections = 0, body_bytes = 0;
+            for(uint16_t i = 0; i < concurrency_; i ++)
+            {
+                connections += load_pool_[i].connections;
+                body_bytes += load_pool_[i].body_bytes;
+            }
+            return (settings_.max_connections && (uint64_t)connections >= settings_.max_connections * percent / 100) ||
+                (settings_.max_body_bytes_in_flight && (uint64_t)body_bytes >= settings_.max_body_bytes_in_flight * percent / 100);
+        }
+
+        // over a limit the acceptor is not armed again: new connections wait in the kernel backlog
+        // (and the load balancer sends them elsewhere) until resume_accept() finds the load below the low-water mark
+        void continue_accept(uint16_t index)
+        {
+            if (draining_)
+                return;
+            if (!over_capacity(100))
+            {
+                if (worker_acceptors_.empty())
+                    do_accept();
+                else
+                    do_accept(index);
+                return;
+            }
+            CROW_LOG_WARNING << "Accept paused: connection or request body limit reached";
+            accept_paused_[index] = true;
+            // the connections may all have been released before the flag was set
+            resume_accept();
+        }
+
+        // called from any worker when a connection closes or releases body bytes
+        void resume_accept()
+        {
+            if (draining_ || !accept_paused() || over_capacity(settings_.low_water_percent))
+                return;
+            for(uint16_t i = 0; i < std::max<size_t>(worker_acceptors_.size(), 1); i ++)
+            {
+                if (!accept_paused_[i].exchange(false))
+                    continue;
+                CROW_LOG_INFO << "Accept resumed";
+                if (worker_acceptors_.empty())
+                    io_service_.post([this]{ do_accept(); });
+                else
+                    io_service_pool_[i]->post([this, i]{ do_accept(i); });
+            }
+        }
+
     private:
         asio::io_service io_service_;
         std::vector<std::unique_ptr<asio::io_service>> io_service_pool_;
-        std::vector<detail::dumb_timer_queue*> timer_queue_pool_;
+        std::unique_ptr<detail::worker_load[]> load_pool_;
+        detail::connection_settings settings_;
+        std::unique_ptr<std::atomic<bool>[]> accept_paused_;
+        std::atomic<bool> draining_{false};
+        std::function<void(int)> signal_function_;
+        std::vector<detail::timer_wheel*> timer_queue_pool_;
         std::vector<std::function<std::string()>> get_cached_date_str_pool_;
         tcp::acceptor acceptor_;
+        // the single acceptor accepts here, hand_over() then moves the socket to a worker
+        tcp::socket accept_socket_;
+        std::vector<std::unique_ptr<tcp::acceptor>> worker_acceptors_;
         boost::asio::signal_set signals_;
         boost::asio::deadline_timer tick_timer_;
 
@@ -9579,6 +10227,58 @@ namespace crow
             return *this;
         }
 
+        // one SO_REUSEPORT acceptor per thread: the kernel hashes each connection to a fixed thread,
+        // so new connections no longer go to the least-loaded worker
+        self_t& reuseport(bool enabled = true)
+        {
+            reuse_port_ = enabled;
+            return *this;
+        }
+
+        self_t& max_body_size(uint64_t size)
+        {
+            connection_settings_.max_body_size = size;
+            return *this;
+        }
+
+        self_t& direct_read_threshold(uint64_t size)
+        {
+            connection_settings_.direct_read_threshold = size;
+            return *this;
+        }
+
+        self_t& timer_granularity(std::chrono::milliseconds granularity)
+        {
+            connection_settings_.timer_granularity_ms = granularity.count();
+            return *this;
+        }
+
+        // connection deadlines, 0 disables one. the handler deadline cannot interrupt a handler
+        // blocking the io thread, it only covers responses completed later from another thread
+        self_t& timeouts(std::chrono::milliseconds read, std::chrono::milliseconds write, std::chrono::milliseconds handler)
+        {
+            connection_settings_.read_timeout_ms = read.count();
+            connection_settings_.write_timeout_ms = write.count();
+            connection_settings_.handler_timeout_ms = handler.count();
+            return *this;
+        }
+
+        // accepting pauses at max_connections or max_body_bytes in flight (0: no limit)
+        // and resumes once both are below low_water_percent of them
+        self_t& accept_limits(uint64_t max_connections, uint64_t max_body_bytes, uint64_t low_water_percent = 90)
+        {
+            connection_settings_.max_connections = max_connections;
+            connection_settings_.max_body_bytes_in_flight = max_body_bytes;
+            connection_settings_.low_water_percent = std::min<uint64_t>(low_water_percent, 100);
+            return *this;
+        }
+
+        self_t& request_body_observer(std::function<void(uint64_t, bool)> f)
+        {
+            connection_settings_.on_request_body = std::move(f);
+            return *this;
+        }
+
         void validate()
         {
             router_.validate();
@@ -9590,15 +10290,19 @@ namespace crow
 #ifdef CROW_ENABLE_SSL
             if (use_ssl_)
             {
-                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_)));
+                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_, reuse_port_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_connection_settings(connection_settings_);
+                ssl_server_->set_signal_function(signal_function_);
                 ssl_server_->run();
             }
             else
 #endif
             {
-                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr)));
+                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr, reuse_port_)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_connection_settings(connection_settings_);
+                server_->set_signal_function(signal_function_);
                 server_->run();
             }
         }
@@ -9617,6 +10321,50 @@ namespace crow
             }
         }
 
+        // called on SIGINT/SIGTERM instead of stop(), on the acceptor thread: it must not block
+        self_t& signal_handler(std::function<void(int)> f)
+        {
+            signal_function_ = std::move(f);
+            return *this;
+        }
+
+        // stops accepting and waits for the requests in flight, see Server::drain; call stop() afterwards
+        bool drain(std::chrono::milliseconds timeout)
+        {
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_->drain(timeout);
+            }
+#endif
+            return server_->drain(timeout);
+        }
+
+        // load of a worker thread of the running server, nullptr before run()
+        const detail::worker_load* worker_load(uint16_t index)
+        {
+            if (index >= concurrency_)
+                return nullptr;
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_ ? &ssl_server_->worker_load(index) : nullptr;
+            }
+#endif
+            return server_ ? &server_->worker_load(index) : nullptr;
+        }
+
+        bool accept_paused()
+        {
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+            {
+                return ssl_server_ && ssl_server_->accept_paused();
+            }
+#endif
+            return server_ && server_->accept_paused();
+        }
+
         void debug_print()
         {
             CROW_LOG_DEBUG << "Routing:";
@@ -9718,6 +10466,9 @@ namespace crow
     private:
         uint16_t port_ = 80;
         uint16_t concurrency_ = 1;
+        bool reuse_port_ = false;
+        detail::connection_settings connection_settings_;
+        std::function<void(int)> signal_function_;
         std::string bindaddr_ = "0.0.0.0";
         Router router_;
 
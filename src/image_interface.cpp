@@ -7,18 +7,65 @@
 #include "conf_param.h"
 #include "apollo_conf.h"
 #include "image_operation.h"
+#include "thread_budget.h"
+#include "image_buffer.h"
+#include "json_scanner.h"
+#include "url_cache.h"
+#include "stream_decoder.h"
+#include "metrics.h"
 
+static Metrics::Counter *g_cbor_responses =
+    Metrics::GetCounter("image_response_format_total{format=\"cbor\"}");
+static Metrics::Counter *g_msgpack_responses =
+    Metrics::GetCounter("image_response_format_total{format=\"msgpack\"}");
+
+/**
+ * 只用jsoncpp解析image_base64以外的小字段：
+ * 扫描请求体定位image_base64的值，image_base64_直接指向请求体中的数据，
+ * 把值替换为空字符串后的其余部分交给jsoncpp；值中有转义字符时回退到完整解析
+ */
+TALError ImageInterface::ParseImageRequestBody() {
+    JsonStringSpan &span = image_base64_span_;
+    if (!ScanJsonStringField(request_body_, "image_base64", span)) {
+        span = JsonStringSpan();
+        return ParseRequestBody();
+    }
+    if (!span.found || span.escaped) {
+        return ParseRequestBody();
+    }
+
+    std::string rest;
+    rest.reserve(request_body_.size() - (span.end - span.begin));
+    rest.append(request_body_, 0, span.begin);
+    rest.append(request_body_, span.end, std::string::npos);
+    try {
+        Json::Reader reader;
+        if (!reader.parse(rest, request_body_json_) || 
+            !request_body_json_.isObject()) {
+            return SERVICE_ERROR.E_UNKNOWN_REQ;
+        }
+    } catch (std::exception &e) {
+        return SERVICE_ERROR.E_UNKNOWN_REQ;
+    }
+    image_base64_.set(request_body_.data() + span.begin, span.end - span.begin);
+    return SERVICE_ERROR.E_OK;
+}
 
 TALError ImageInterface::VerifyImageParam() {
 	m_details = false;
 	m_precision = false;
+	m_fields = ResultFields();
 
     if (request_body_json_.isMember("image_base64")) {
         auto &image = request_body_json_["image_base64"];
         if (!image.isString()) {
             return SERVICE_ERROR.E_UNKNOWN_REQ;
         }
-        image_base64_ = image.asString();
+        // ParseImageRequestBody已经取出image_base64时，json中的值为空字符串
+        if (image_base64_.empty()) {
+            image_base64_storage_ = image.asString();
+            image_base64_ = image_base64_storage_;
+        }
     }
 
     if (image_base64_.empty() && 
@@ -50,37 +97,71 @@ TALError ImageInterface::VerifyImageParam() {
 		}
     }
 
+    if (request_body_json_.isMember("fields")) {
+    	if (!ResultFields::Parse(request_body_json_["fields"], m_fields)) {
+    		return SERVICE_ERROR.E_UNKNOWN_REQ;
+    	}
+    }
+
     return SERVICE_ERROR.E_OK;
 }
 
+/**
+ * 外网URL转换为内网URL：
+ * 1.命中缓存时直接使用内网URL
+ * 2.未命中时在后台转换并写入缓存，当前请求先下载原始URL，转换不在关键路径上
+ * 3.未启用缓存时同步转换
+ */
 void ImageInterface::TransSingleURL() {
-    std::string error_msg;
+    std::string inner_url;
+    if (UrlTransCache::Get(image_url_, inner_url)) {
+        image_url_ = inner_url;
+        return;
+    }
+
     auto trans_url = ConfParam::GetValue(APOLLO_DATAFLOW_URL_TRANS_HOST, "");
     auto timeout = ConfParam::GetValue(APOLLO_DATAFLOW_URL_TRANS_TIMEOUT, 1);
     auto retry = ConfParam::GetValue(APOLLO_DATAFLOW_URL_TRANS_RETRY, 1);
-    std::vector<std::string> image_urls{image_url_};
-    bool res = false;
-    for (int i=0; i<retry; ++i) {
-        res = Trans2InnerUrl(request_id_, image_urls, trans_url,
-                             error_msg, timeout);
-        if (res) {
-            break;
+    auto request_id = request_id_;
+    auto interface_url = interface_url_;
+    auto image_url = image_url_;
+    // 可能在后台线程执行，只捕获副本
+    auto trans = [=](std::string &inner_url) -> bool {
+        std::string error_msg;
+        std::vector<std::string> image_urls{image_url};
+        bool res = false;
+        for (int i=0; i<retry; ++i) {
+            res = Trans2InnerUrl(request_id, image_urls, trans_url,
+                                 error_msg, timeout);
+            if (res) {
+                break;
+            }
         }
-    }
-    if (!res) {
-        LOG(ERROR) << GenerateAlarmMsg(TECHNICAL_ERROR.E_URL_TRANS,
-                                       interface_url_,
-                                       error_msg);
-    } else {
-        if (image_urls.size() >= 1) {
-            image_url_ = image_urls[0];
+        if (!res) {
+            LOG(ERROR) << GenerateAlarmMsg(TECHNICAL_ERROR.E_URL_TRANS,
+                                           interface_url,
+                                           error_msg);
+            return false;
+        }
+        if (image_urls.empty()) {
+            return false;
+        }
+        inner_url = image_urls[0];
+        return true;
+    };
+
+    if (!UrlTransCache::Enabled()) {
+        if (trans(inner_url)) {
+            image_url_ = inner_url;
         }
+        return;
     }
+    inner_url_future_ = UrlTransCache::TransAsync(image_url_, trans);
 }
 
 TALError ImageInterface::HandleImage() {
     TALError res;
-    if (((res=ParseRequestBody())!=SERVICE_ERROR.E_OK) || 
+    if (((res=ParseImageRequestBody())!=SERVICE_ERROR.E_OK) || 
         ((res=VerifyImageParam())!=SERVICE_ERROR.E_OK)) {
         return res;
     }
@@ -89,17 +170,43 @@ TALError ImageInterface::HandleImage() {
         TransSingleURL();
     }
 
-    std::string image_binary;
-    res = GetImageData(image_binary, image_url_, image_base64_);
-    if (res != SERVICE_ERROR.E_OK) {
-        return res;
+    // 下载的数据到达时增量解码，不支持的格式在下载完成后按缓冲的数据解码
+    int target_side = ConfParam::GetValue(APOLLO_LOCAL_DECODE_TARGET_SIDE, 0);
+    StreamDecoder decoder(target_side);
+    DownloadProgress progress;
+    if (ConfParam::GetValue(APOLLO_LOCAL_STREAM_DECODE, 1) != 0) {
+        progress = [&decoder](const std::string &data) { decoder.Feed(data); };
     }
 
-    res = DecodeImage(cv_image_, image_binary);
+    ImageBuffer image_binary;
+    res = GetImageData(image_binary.Data(), image_url_, image_base64_, 
+                       3000, 3, progress);
+    if (res != SERVICE_ERROR.E_OK && inner_url_future_.valid()) {
+        // 原始URL下载失败(例如只能通过内网访问)，等待后台转换的结果重试
+        std::string inner_url = inner_url_future_.get();
+        if (!inner_url.empty() && inner_url != image_url_) {
+            image_url_ = inner_url;
+            decoder.Reset();
+            res = GetImageData(image_binary.Data(), image_url_, image_base64_, 
+                               3000, 3, progress);
+        }
+    }
     if (res != SERVICE_ERROR.E_OK) {
         return res;
     }
 
+    res = DecodeImage(cv_image_, image_binary.Data(), target_side, image_scale_, 
+                      &decoder);
+    // 解码时请求体、base64、二进制缓冲区、解码后的图片同时存在，即接入阶段的内存峰值
+    // 旧路径(额外拷贝一份vector<uchar>)的峰值对比见 common/test/ingest_memory_testing
+    LOG(INFO) << "ingest peak bytes: " 
+        << request_body_.size() + image_base64_storage_.capacity() + 
+           image_binary.Data().capacity() + 
+           cv_image_.total() * cv_image_.elemSize()
+        << ", body: " << request_body_.size()
+        << ", binary: " << image_binary.Data().size()
+        << ", image: " << cv_image_.total() * cv_image_.elemSize()
+        << ", scale: " << image_scale_;
     return res;
 }
 
@@ -107,9 +214,11 @@ void ImageInterface::HandleRequest(std::string &response) {
     int64_t request_time = base::Time::Now().ToJavaTime();
     LOG(INFO) << "start, " << request_.raw_url;
 
+    response_format_ = ResponseWriter::FromAccept(request_.get_header_value("Accept"));
     TALError error{SERVICE_ERROR.E_OK};
     Json::Value result;
     do {
+        ThreadBudget::Scope budget;
         if ((error = HandleImage()) != SERVICE_ERROR.E_OK) {
             break;
         }
@@ -119,21 +228,42 @@ void ImageInterface::HandleRequest(std::string &response) {
     int64_t response_time = base::Time::Now().ToJavaTime();
     double cost = response_time - request_time;
 
-    Json::Value root;
-    root["code"] = Json::Value(error.code);
-    root["msg"] = Json::Value(error.message);
-    auto duration = 0.0f;
-    Json::Value data;
-    if (error == SERVICE_ERROR.E_OK) {
-        duration = cost;
-        data = result;
+    // 与Json::FastWriter序列化{"code","data","msg"}的结果一致，data可以是handler编码好的片段
+    // CBOR/MessagePack的结构相同
+    response.clear();
+    auto writer = ResponseWriter::Create(response_format_, response);
+    writer->StartObject(3);
+    writer->Key("code");
+    writer->Value(Json::Value(error.code));
+    writer->Key("data");
+    if (error != SERVICE_ERROR.E_OK) {
+        writer->Null();
+    } else if (has_encoded_data_) {
+        writer->Raw(encoded_data_);
+    } else {
+        writer->Value(result);
     }
 //    data["process_duration"] = duration;
-    root["data"] = data;
-    Json::FastWriter writer;
-    response = writer.write(root);
+    writer->Key("msg");
+    writer->Value(Json::Value(error.message));
+    writer->EndObject();
+    writer->Finish();
 
-    SendDataFlow(request_time, response_time, error, response);
+    if (response_format_ == ResponseFormat::JSON) {
+        SendDataFlow(request_time, response_time, error, response);
+    } else {
+        // 数据流中的响应为JSON
+        std::string json;
+        if (!ResponseWriter::ToJson(response_format_, response, json)) {
+            LOG(ERROR) << "transcode response to json failed, " << request_.raw_url;
+        }
+        SendDataFlow(request_time, response_time, error, json);
+        if (response_format_ == ResponseFormat::CBOR) {
+            g_cbor_responses->Add();
+        } else {
+            g_msgpack_responses->Add();
+        }
+    }
     LOG(INFO) << "end, " << request_.raw_url
         << ", " << error << ", duration:" << cost << "ms";
     MallocTrim();
@@ -167,8 +297,14 @@ void ImageInterface::SendDataFlow(int64_t request_time,
     mq_data.SetValue(data_err_code, error.code);
     mq_data.SetValue(data_msg, error.message);
     mq_data.SetValue(data_err_msg, error.message);
-    mq_data.TransDataToJson(trans_response_json, response);
-    mq_data.TransDataToJson(trans_body_json, request_body_);
+    // 响应和去掉image_base64的请求体直接拼接，不再解析和序列化
+    mq_data.SetResponse(response);
+    if (image_base64_span_.found && image_base64_span_.begin < image_base64_span_.end) {
+        mq_data.SetRequestParam(request_body_, image_base64_span_.member_begin, 
+                                image_base64_span_.member_end);
+    } else {
+        mq_data.SetRequestParam(request_body_, 0, 0);
+    }
     std::string mq_message = mq_data.GetJsonData();
     // LOG(INFO) << "data_flow: " << mq_message;
     KafkaClient::GetInstance()->SendMsg(mq_message);
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "tal_interface.h"
+#include "base/strings/string_piece.h"
+#include "response_writer.h"
+#include "json_scanner.h"
+#include "composion_result.hpp"
 
 #include <string>
 #include <vector>
+#include <future>
 #include "opencv2/opencv.hpp"
 
 
@@ -15,27 +20,48 @@
 class ImageInterface : public TALInterface {
 protected:
     std::string image_url_;
-    std::string image_base64_;
+    // URL转换缓存未命中时后台转换的结果，原始URL下载失败时等待并使用内网URL下载
+    std::shared_future<std::string> inner_url_future_;
+    // 指向request.body中的base64数据；请求体有转义字符需要完整解析时，指向image_base64_storage_
+    base::StringPiece image_base64_;
+    std::string image_base64_storage_;
+    // 请求体中image_base64的位置，数据流消息中去掉此成员作为requestParam
+    JsonStringSpan image_base64_span_;
     std::vector<cv::Rect> cv_rects_;
     cv::Mat cv_image_;
+    // 原图与cv_image_的比例，JPEG缩小解码时大于1，返回的坐标需要乘以此比例
+    int image_scale_{1};
     bool m_details;
     bool m_precision;
+    // 请求参数fields，没有时返回全部
+    ResultFields m_fields;
+    // handler直接输出编码好的data时使用，此时忽略handler的result参数
+    ResponseFormat response_format_{ResponseFormat::JSON};
+    std::string encoded_data_;
+    bool has_encoded_data_{false};
 public:
     ImageInterface() = delete;
     ImageInterface(const std::string &interface_url, 
                    const crow::request &request) : 
         TALInterface{interface_url, request} {}
-    ImageInterface(const ImageInterface &) = default;
-    ImageInterface &operator=(ImageInterface &) = default;
-    ImageInterface(ImageInterface &&) = default;
-    ImageInterface &operator=(ImageInterface &&) = default;
+    // image_base64_可能指向本对象的image_base64_storage_，拷贝/移动后会指向原对象或失效
+    ImageInterface(const ImageInterface &) = delete;
+    ImageInterface &operator=(const ImageInterface &) = delete;
+    ImageInterface(ImageInterface &&) = delete;
+    ImageInterface &operator=(ImageInterface &&) = delete;
     virtual ~ImageInterface() {}
 
+    // HandleRequest之后有效：与Accept头协商出的响应格式
+    const char *ContentType() const {
+        return ResponseWriter::ContentType(response_format_);
+    }
+
 private:
     TALError ParseRectangleData(cv::Rect &cv_rect, 
                                 Json::Value &rectangle);
 
 protected:
+    TALError ParseImageRequestBody();
     TALError VerifyImageParam();
     TALError VerifyInnerImageParam();
     TALError VerifyFaceRectangle(bool optional=false);
@@ -1,52 +1,41 @@
 #include "image_operation.h"
 #include "file_download.h"
 #include "base/base64.h"
+#include "fast_base64.h"
+#include "metrics.h"
+#include "base/logging.h"
 
-#include <functional>
-#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
 #include <vector>
 #include <iostream>
 
 
 using namespace base;
 
-static bool CallWithRetry(unsigned int retry_count, 
-                          unsigned int retry_sleep_millseconds, 
-                          std::function<bool()> call){
-    for (unsigned int i=0; i<retry_count; ++i) {
-        if (call()) {
-            return true;
-        }
-        usleep(retry_sleep_millseconds * 1000);
-    }
-    return false;
-}
-
 TALError GetImageData(std::string &image_data, 
                       const std::string &image_url,
-                      const std::string &image_base64, 
-                      unsigned int download_timeout_seconds, 
-                      unsigned int retry_count, 
-                      unsigned int retry_sleep_millsecods) {
+                      const base::StringPiece &image_base64, 
+                      unsigned int download_deadline_ms, 
+                      unsigned int max_attempts, 
+                      const DownloadProgress &progress) {
     TALError error;
     if (!image_base64.empty()) {
-        if (!Base64Decode(image_base64, &image_data)) {
+        // 直接解码到image_data中，image_data可能是池化的缓冲区，不经过临时string
+        if (!FastBase64Decode(image_base64, &image_data)) {
             error = SERVICE_ERROR.E_IMAGE_BASE64_DECODE;
-        } 
+        }
     } else if (!image_url.empty()) {
-        auto download_image = [&]()->bool {
-            double img_size = 0.0;
-            std::string err_msg;
-            bool res = DownloadImage(image_url, 
-                                     image_data, 
-                                     img_size, 
-                                     err_msg, 
-                                     download_timeout_seconds);
-            return res;
-        };
-        if(!CallWithRetry(retry_count, 
-                          retry_sleep_millsecods, 
-                          download_image)) {
+        // 慢请求由对冲请求兜底，失败时立即重试，整个下载不超过download_deadline_ms
+        std::string err_msg;
+        if (!DownloadImageHedged(image_url, 
+                                 image_data, 
+                                 err_msg, 
+                                 download_deadline_ms, 
+                                 max_attempts, 
+                                 progress)) {
+            LOG(ERROR) << err_msg;
             error = SERVICE_ERROR.E_IMAGE_DOWNLOAD;
         }
     } else {
@@ -55,40 +44,188 @@ TALError GetImageData(std::string &image_data,
     return error;
 }
 
-TALError DecodeImage(cv::Mat &dest_img, 
-                     const std::string &src_img) {
-    std::vector<uchar> buf;
-    for (const auto &item : src_img) {
-        buf.push_back(item);
+bool ReadJpegSize(const std::string &image_binary, int &width, int &height) {
+    auto data = reinterpret_cast<const unsigned char *>(image_binary.data());
+    size_t size = image_binary.size();
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
     }
-
-    dest_img = cv::imdecode(buf, cv::IMREAD_COLOR);
-    if ((dest_img.dims!=2) || (dest_img.rows==0) || (dest_img.cols==0)) {
-        // abnormal image
-        return SERVICE_ERROR.E_IMAGE_DECODE;
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        // 段之间的多余字节与libjpeg的next_marker一样跳过(libjpeg只告警，照常解码)
+        if (data[pos] != 0xFF) {
+            ++pos;
+            continue;
+        }
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) {  // 填充字节
+            ++pos;
+            continue;
+        }
+        pos += 2;
+        if (marker == 0x00) {  // 0xFF00不是标记，同样按多余字节跳过
+            continue;
+        }
+        // 没有长度字段的标记：TEM、RST0-7
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {  // EOI/SOS之前没有SOF
+            return false;
+        }
+        size_t length = (data[pos] << 8) | data[pos + 1];
+        if (length < 2) {
+            return false;
+        }
+        // SOF0-SOF15，排除DHT(C4)、JPG(C8)、DAC(CC)
+        if (marker >= 0xC0 && marker <= 0xCF && 
+            marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (length < 7 || pos + 7 > size) {
+                return false;
+            }
+            height = (data[pos + 3] << 8) | data[pos + 4];
+            width = (data[pos + 5] << 8) | data[pos + 6];
+            return width > 0 && height > 0;
+        }
+        pos += length;
     }
+    return false;
+}
 
-    if (dest_img.rows < 32 || dest_img.cols < 32) {
-    	return SERVICE_ERROR.E_IMAGE_RESOLUTION;
+bool ReadPngSize(const std::string &image_binary, int &width, int &height) {
+    // 8字节签名 + IHDR(长度13) ：长度(4) "IHDR"(4) 宽(4) 高(4)
+    static const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    auto data = reinterpret_cast<const unsigned char *>(image_binary.data());
+    if (image_binary.size() < 24 || 
+        memcmp(data, signature, sizeof(signature)) != 0 || 
+        memcmp(data + 12, "IHDR", 4) != 0) {
+        return false;
+    }
+    auto read_u32 = [data](size_t pos) -> uint32_t {
+        return (uint32_t(data[pos]) << 24) | (uint32_t(data[pos + 1]) << 16) | 
+               (uint32_t(data[pos + 2]) << 8) | uint32_t(data[pos + 3]);
+    };
+    uint32_t w = read_u32(16), h = read_u32(20);
+    // PNG规定宽高不超过2^31-1
+    if (w == 0 || h == 0 || w > 0x7FFFFFFF || h > 0x7FFFFFFF) {
+        return false;
     }
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    return true;
+}
+
+// 按原因统计被拒绝的图片
+static void CountReject(const char *reason) {
+    Metrics::Add(std::string("image_reject_total{reason=\"") + reason + "\"}");
+}
 
-    if (dest_img.rows > 4096 || dest_img.cols > 4096) {
-    	return SERVICE_ERROR.E_IMAGE_RESOLUTION;
+static TALError CheckImageSize(int rows, int cols) {
+    const char *reason = nullptr;
+    int _h = rows > cols ? rows : cols;
+    int _w = rows <= cols ? rows : cols;
+    if (rows < 32 || cols < 32) {
+        reason = "too_small";
+    } else if (rows > 4096 || cols > 4096) {
+        reason = "too_large";
+    } else if (int64_t(rows) * cols > (4096 * 2160)) {  // 4K
+        reason = "too_many_pixels";
+    } else if (int64_t(_w) * 15 < _h) {
+        reason = "aspect_ratio";
     }
 
-    if (src_img.length() > (1<<20) * 5) {
-    	return SERVICE_ERROR.E_IMAGE_RESOLUTION;
+    if (reason) {
+        CountReject(reason);
+        return SERVICE_ERROR.E_IMAGE_RESOLUTION;
     }
+    return SERVICE_ERROR.E_OK;
+}
 
-    if ((dest_img.rows * dest_img.cols) > (4096 * 2160)) {  // 4K
+TALError CheckImageHeader(const std::string &image_binary, 
+                          int &width, 
+                          int &height) {
+    width = 0;
+    height = 0;
+    if (image_binary.length() > (1<<20) * 5) {
+        CountReject("payload_size");
         return SERVICE_ERROR.E_IMAGE_RESOLUTION;
     }
 
-    int _h = dest_img.rows > dest_img.cols ? dest_img.rows : dest_img.cols;
-    int _w = dest_img.rows <= dest_img.cols ? dest_img.rows : dest_img.cols;
+    bool parsed = false;
+    auto format = CheckImageFormat(image_binary);
+    if (format == ImageFormat::JPG) {
+        parsed = ReadJpegSize(image_binary, width, height);
+    } else if (format == ImageFormat::PNG) {
+        parsed = ReadPngSize(image_binary, width, height);
+    } else {
+        // 其他格式交给imdecode，解码后再校验尺寸
+        return SERVICE_ERROR.E_OK;
+    }
+
+    if (!parsed) {
+        // 头部解析不出尺寸时不直接拒绝，交给imdecode，解码后再校验尺寸
+        Metrics::Add("image_header_unparsed_total");
+        width = height = 0;
+        return SERVICE_ERROR.E_OK;
+    }
+    return CheckImageSize(height, width);
+}
+
+TALError DecodeImage(cv::Mat &dest_img, 
+                     const std::string &src_img) {
+    int scale = 1;
+    return DecodeImage(dest_img, src_img, 0, scale);
+}
+
+TALError DecodeImage(cv::Mat &dest_img, 
+                     const std::string &src_img, 
+                     int target_side, 
+                     int &scale, 
+                     StreamDecoder *decoder) {
+    scale = 1;
+    int width = 0, height = 0;
+    TALError res = CheckImageHeader(src_img, width, height);
+    if (res != SERVICE_ERROR.E_OK) {
+        if (decoder) {
+            decoder->Reset();
+        }
+        return res;
+    }
+    // 流式解码只处理JPEG/PNG，且只用于头部中读出尺寸、上面已经校验过的图片
+    if (decoder && width > 0 && decoder->Finish(src_img, dest_img, scale)) {
+        return SERVICE_ERROR.E_OK;
+    }
+    if (decoder && width == 0) {
+        decoder->Reset();
+    }
+    scale = 1;
+
+    int flags = cv::IMREAD_COLOR;
+    if (target_side > 0 && CheckImageFormat(src_img) == ImageFormat::JPG) {
+        // libjpeg的DCT缩放只支持1/2、1/4、1/8
+        scale = StreamDecoder::JpegScale(width, height, target_side);
+        if (scale == 2) {
+            flags = cv::IMREAD_REDUCED_COLOR_2;
+        } else if (scale == 4) {
+            flags = cv::IMREAD_REDUCED_COLOR_4;
+        } else if (scale == 8) {
+            flags = cv::IMREAD_REDUCED_COLOR_8;
+        }
+    }
+
+    // 用Mat头包装src_img，imdecode直接读取，不拷贝
+    const cv::Mat buf(1, static_cast<int>(src_img.size()), CV_8UC1, 
+                      const_cast<char *>(src_img.data()));
+    dest_img = cv::imdecode(buf, flags);
+    if ((dest_img.dims!=2) || (dest_img.rows==0) || (dest_img.cols==0)) {
+        // abnormal image
+        CountReject("decode_failed");
+        return SERVICE_ERROR.E_IMAGE_DECODE;
+    }
 
-    if (_w * 15 < _h) {
-    	return SERVICE_ERROR.E_IMAGE_RESOLUTION;
+    // 头部中没有尺寸的格式，按解码后的尺寸校验
+    if (width == 0) {
+        return CheckImageSize(dest_img.rows, dest_img.cols);
     }
     return SERVICE_ERROR.E_OK;
 }
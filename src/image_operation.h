@@ -1,20 +1,49 @@
 #pragma once
 
 #include "service_error.h"
+#include "base/strings/string_piece.h"
+#include "file_download.h"
+#include "stream_decoder.h"
 
 #include "opencv2/opencv.hpp"
 
 
+// 下载时progress在数据到达时被调用，用于边下载边解码
 TALError GetImageData(std::string &image_data, 
                       const std::string &image_url,
-                      const std::string &image_base64, 
-                      unsigned int download_timeout_seconds=3, 
-                      unsigned int retry_count=3, 
-                      unsigned int retry_sleep_millsecods=500);
+                      const base::StringPiece &image_base64, 
+                      unsigned int download_deadline_ms=3000, 
+                      unsigned int max_attempts=3, 
+                      const DownloadProgress &progress=nullptr);
 
 TALError DecodeImage(cv::Mat &dest_img, 
                      const std::string &src_img);
 
+/**
+ * target_side>0时，较大的JPEG按1/2、1/4、1/8直接缩小解码，缩小后长边不小于target_side
+ * scale返回原图与解码后图片的比例(1/2/4/8)，尺寸校验按原图进行
+ * decoder已经在下载过程中完成解码时直接使用其结果，否则按src_img解码
+ */
+TALError DecodeImage(cv::Mat &dest_img, 
+                     const std::string &src_img, 
+                     int target_side, 
+                     int &scale, 
+                     StreamDecoder *decoder=nullptr);
+
+// 从JPEG的SOF段/PNG的IHDR中读取图片尺寸，不解码像素
+bool ReadJpegSize(const std::string &image_binary, int &width, int &height);
+bool ReadPngSize(const std::string &image_binary, int &width, int &height);
+
+/**
+ * 解码前只根据头部校验图片：数据大小、尺寸和长宽比
+ * 其他格式或JPEG/PNG头部解析不出尺寸时width/height为0，由解码后再校验；
+ * 后者计数为image_header_unparsed_total
+ * 被拒绝的图片按原因计数：image_reject_total{reason="..."}
+ */
+TALError CheckImageHeader(const std::string &image_binary, 
+                          int &width, 
+                          int &height);
+
 enum class ImageFormat{UNKNOWN, PNG, JPG, JPEG, BMP};
 ImageFormat CheckImageFormat(const std::string &image_binary);
 bool ImageToBase64(const cv::Mat& src_img, std::string& dst_img, const std::string& format = "jpg", int quality=100);
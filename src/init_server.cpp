@@ -17,7 +17,13 @@
 #include "ali_oss_client.h"
 #include "apollo_conf.h"
 #include "tal_interface.h"
+#include "thread_budget.h"
+#include "image_buffer.h"
+#include "http_client.h"
+#include "url_cache.h"
+#include "response_compress.h"
 #include "composion.hpp"
+#include "metrics.h"
 
 
 using namespace facethink;
@@ -90,7 +96,12 @@ void ReleaseEureka() {
     if (g_current_env == CURRENT_ENV::LOCAL) {
         return;
     }
-    g_eureka_client->stop();
+    // 摘流时已经注销过，ReleaseService中再次调用时直接返回
+    EurekaClient *client = g_eureka_client;
+    g_eureka_client = nullptr;
+    if (client) {
+        client->stop();
+    }
 }
 
 bool DumpCallback(const google_breakpad::MinidumpDescriptor &descr, 
@@ -348,6 +359,35 @@ void ReleaseDistributeLock() {
     DistributeLock::ReleaseInstance();
 }
 
+static void InitThreadBudget() {
+    int total_threads = ConfParam::GetValue(APOLLO_LOCAL_CPU_THREADS, 0);
+    int max_concurrency = ConfParam::GetValue(APOLLO_LOCAL_MAX_CONCURRENCY, 0);
+    ThreadBudget::Init(std::max(total_threads, 0), 
+                       std::max(max_concurrency, 0));
+    // 每个并发请求保留一个图片缓冲区，超过8MB的缓冲区不归还
+    ImageBuffer::Init(ThreadBudget::Concurrency(), 8 << 20);
+}
+
+static void InitUrlTransCache() {
+    bool use_redis = ConfParam::GetValue(APOLLO_LOCAL_URL_CACHE_REDIS, 0) != 0;
+    if (use_redis && !init_redis) {
+        InitRedisConn();
+    }
+    UrlTransCache::Init(ConfParam::GetValue(APOLLO_LOCAL_URL_CACHE_SIZE, 0),
+                        ConfParam::GetValue(APOLLO_LOCAL_URL_CACHE_TTL, 3600),
+                        use_redis);
+}
+
+static void InitResponseCompress() {
+    size_t min_size = 0;
+    if (ConfParam::GetValue(APOLLO_LOCAL_COMPRESS, 1) != 0) {
+        min_size = ConfParam::GetValue(APOLLO_LOCAL_COMPRESS_MIN_SIZE, 1024);
+    }
+    ResponseCompressor::Init(min_size, 
+                             ConfParam::GetValue(APOLLO_LOCAL_COMPRESS_LEVEL, 1), 
+                             ConfParam::GetValue(APOLLO_LOCAL_COMPRESS_THREADS, 2));
+}
+
 void InitService() {
     InitLog();
     LOG(INFO) << "init service";
@@ -363,6 +403,10 @@ void InitService() {
 
     InitDumpFile();   // 初始化dump文件，NOTE：需要将其打印到标准输出
     InitKafka();      // 初始化Kafka连接等信息-数据回流
+    InitThreadBudget();  // 划分请求并发与推理内部并行的线程数
+    HttpClient::Init(ConfParam::GetValue(APOLLO_LOCAL_HTTP2, 0) != 0);  // 共享连接的HTTP客户端
+    InitUrlTransCache();  // URL转换缓存
+    InitResponseCompress();  // 响应压缩
 
     // 这些配置项需要在apollo中进行配置后才会初始化
     // InitAliOSS();     // 初始化阿里云OSS
@@ -387,17 +431,101 @@ void ReleaseService() {
 
 }
 
+// SIGTERM后置为true：就绪检查返回503，crow停止accept并关闭keep-alive连接
+static std::atomic<bool> g_draining{false};
+// crow已退出(再次收到信号时直接stop)，摘流线程不再等待
+static std::atomic<bool> g_stopped{false};
+
+// 摘流顺序：注销Eureka、就绪检查失败 -> 等待调用方感知下线(期间正常处理请求)
+// -> 停止accept，等待处理中的请求完成 -> 等待Kafka队列发送完成 -> 退出，
+// 以上步骤总共不超过local_drain_timeout_ms
+static void Drain(crow::SimpleApp &app) {
+    auto start = std::chrono::steady_clock::now();
+    auto timeout = std::chrono::milliseconds(
+        std::max(ConfParam::GetValue(APOLLO_LOCAL_DRAIN_TIMEOUT_MS, 30000), 0));
+    auto delay = std::chrono::milliseconds(
+        std::max(ConfParam::GetValue(APOLLO_LOCAL_DRAIN_DELAY_MS, 5000), 0));
+    auto remaining = [&]() {
+        auto left = timeout - std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        return std::max(left, std::chrono::milliseconds(0));
+    };
+    const auto step = std::chrono::milliseconds(100);
+
+    LOG(INFO) << "draining: deregister from eureka";
+    g_draining = true;
+    ReleaseEureka();
+    while (!g_stopped && remaining().count() > 0 && 
+           std::chrono::steady_clock::now() - start < delay) {
+        std::this_thread::sleep_for(step);
+    }
+
+    LOG(INFO) << "draining: stop accepting, wait for in-flight requests";
+    bool drained = false;
+    while (!g_stopped && !drained && remaining().count() > 0) {
+        drained = app.drain(std::min(remaining(), step));
+    }
+    if (!drained) {
+        LOG(ERROR) << "draining: requests still in flight at the deadline";
+    }
+    if (!g_stopped && !KafkaClient::GetInstance()->Flush(remaining())) {
+        LOG(ERROR) << "draining: kafka queue not flushed at the deadline";
+    }
+    LOG(INFO) << "draining: done in " 
+        << std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start).count() << "ms";
+    if (!g_stopped) {
+        app.stop();
+    }
+}
+
 void Listen(RequestEvents &events) {
     std::string app_name{ConfParam::GetValue(APOLLO_PAAS_EUREKA_APP_NAME, 
                                              "UNDEFINED")};
     TALInterface::SetAppName(app_name);
 
+    std::string readiness_url{ConfParam::GetValue(APOLLO_LOCAL_READINESS_URL, 
+                                                  "/health")};
     crow::SimpleApp app;
     for (auto &event : events) {
-        auto func = [&](const crow::request &request) {
-            std::string response;
-            event.second(request, response);
-            return crow::response{response};
+        auto func = [&](const crow::request &request, crow::response &res) {
+            if (g_draining && request.url == readiness_url) {
+                res.code = 503;
+                res.body = "draining";
+                res.end();
+                return;
+            }
+            std::string content_type;
+            event.second(request, res.body, content_type);
+            if (!content_type.empty()) {
+                res.set_header("Content-Type", content_type);
+            }
+            auto encoding = ResponseCompressor::Negotiate(
+                request.get_header_value("Accept-Encoding"));
+            if (encoding == ResponseCompressor::Encoding::NONE || 
+                !ResponseCompressor::ShouldCompress(res.body.size()) || 
+                !request.io_service) {
+                res.end();
+                return;
+            }
+            // 压缩在线程池中执行，完成后回到连接所在的io线程设置header并发送；
+            // 在此之前连接不会读取新的请求，request和res保持有效。
+            // 压缩线程只读取body，header只在io线程中修改
+            res.set_header("Vary", "Accept-Encoding");
+            auto io_service = request.io_service;
+            auto response = &res;
+            ResponseCompressor::Submit([io_service, response, encoding]() {
+                auto compressed = std::make_shared<std::string>();
+                bool ok = ResponseCompressor::Compress(encoding, response->body, *compressed);
+                io_service->post([response, compressed, ok, encoding]() {
+                    if (ok) {
+                        response->body.swap(*compressed);
+                        response->set_header("Content-Encoding", 
+                                             ResponseCompressor::Name(encoding));
+                    }
+                    response->end();
+                });
+            });
         };
         auto &url = event.first.first;
         if (event.first.second == HTTP_METHOD::POST) {
@@ -413,8 +541,87 @@ void Listen(RequestEvents &events) {
                 << (int)event.first.second;
         }
     }
+    // 每个io线程的连接数和处理中的请求数，新连接分配给负载最低的线程
+    for (uint16_t i = 0; i < ThreadBudget::Concurrency(); ++i) {
+        std::string worker = "{worker=\"" + std::to_string(i) + "\"}";
+        Metrics::SetGauge("crow_worker_connections" + worker, [&app, i]() {
+            auto load = app.worker_load(i);
+            return load ? (double)load->connections.load() : 0.0;
+        });
+        Metrics::SetGauge("crow_worker_inflight_handlers" + worker, [&app, i]() {
+            auto load = app.worker_load(i);
+            return load ? (double)load->handlers.load() : 0.0;
+        });
+    }
+    // 请求体占用的内存和是否因连接/请求体上限暂停了accept
+    Metrics::SetGauge("crow_inflight_body_bytes", [&app]() {
+        double bytes = 0;
+        for (uint16_t i = 0; i < ThreadBudget::Concurrency(); ++i) {
+            auto load = app.worker_load(i);
+            bytes += load ? (double)load->body_bytes.load() : 0.0;
+        }
+        return bytes;
+    });
+    Metrics::SetGauge("crow_accept_paused", [&app]() {
+        return app.accept_paused() ? 1.0 : 0.0;
+    });
     ConnectEureka();
     int service_port = ConfParam::GetValue(APOLLO_LOCAL_SERVICE_PORT, 
                                            6732);
-    app.port(service_port).multithreaded().run();
+    bool reuse_port = ConfParam::GetValue(APOLLO_LOCAL_REUSE_PORT, 0) != 0;
+    if (reuse_port) {
+        LOG(WARNING) << APOLLO_LOCAL_REUSE_PORT << " enabled: connections are "
+                     << "spread by the kernel, load-aware worker placement is off";
+    }
+    int max_body_size = ConfParam::GetValue(APOLLO_LOCAL_MAX_BODY_SIZE, 0);
+    int direct_read_threshold = 
+        ConfParam::GetValue(APOLLO_LOCAL_DIRECT_READ_THRESHOLD, 64 << 10);
+    int timer_granularity_ms = 
+        ConfParam::GetValue(APOLLO_LOCAL_TIMER_GRANULARITY_MS, 100);
+    int read_timeout_ms = ConfParam::GetValue(APOLLO_LOCAL_READ_TIMEOUT_MS, 5000);
+    int write_timeout_ms = 
+        ConfParam::GetValue(APOLLO_LOCAL_WRITE_TIMEOUT_MS, 30000);
+    int handler_timeout_ms = 
+        ConfParam::GetValue(APOLLO_LOCAL_HANDLER_TIMEOUT_MS, 0);
+    int max_connections = ConfParam::GetValue(APOLLO_LOCAL_MAX_CONNECTIONS, 0);
+    // 字节数可能超过int，按double读取
+    double max_inflight_body_bytes = 
+        ConfParam::GetValue(APOLLO_LOCAL_MAX_INFLIGHT_BODY_BYTES, 0.0);
+    int low_water_percent = 
+        ConfParam::GetValue(APOLLO_LOCAL_ACCEPT_LOW_WATER_PERCENT, 90);
+    // 请求体大小分布：接受的和按Content-Length拒绝的分开统计
+    static const std::vector<uint64_t> body_bounds = {
+        1 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 2 << 20, 4 << 20, 
+        8 << 20, 16 << 20, 32 << 20
+    };
+    auto body_bytes = Metrics::GetHistogram("request_body_bytes", body_bounds);
+    auto rejected_body_bytes = 
+        Metrics::GetHistogram("request_body_rejected_bytes", body_bounds);
+    std::thread drain_thread;
+    app.port(service_port).concurrency(ThreadBudget::Concurrency())
+        .reuseport(reuse_port)
+        .max_body_size(std::max(max_body_size, 0))
+        .direct_read_threshold(std::max(direct_read_threshold, 0))
+        .timer_granularity(std::chrono::milliseconds(
+            std::max(timer_granularity_ms, 1)))
+        .timeouts(std::chrono::milliseconds(std::max(read_timeout_ms, 0)), 
+                  std::chrono::milliseconds(std::max(write_timeout_ms, 0)), 
+                  std::chrono::milliseconds(std::max(handler_timeout_ms, 0)))
+        .accept_limits(std::max(max_connections, 0), 
+                       (uint64_t)std::max(max_inflight_body_bytes, 0.0), 
+                       std::max(low_water_percent, 0))
+        .request_body_observer([body_bytes, rejected_body_bytes](uint64_t size, 
+                                                                 bool rejected) {
+            (rejected ? rejected_body_bytes : body_bytes)->Observe(size);
+        })
+        // 信号处理在crow的accept线程中执行，摘流放到单独的线程
+        .signal_handler([&app, &drain_thread](int signal_number) {
+            LOG(INFO) << "signal " << signal_number << " received, draining";
+            drain_thread = std::thread([&app]() { Drain(app); });
+        })
+        .run();
+    g_stopped = true;
+    if (drain_thread.joinable()) {
+        drain_thread.join();
+    }
 }
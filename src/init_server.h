@@ -16,7 +16,7 @@ using namespace logging;
 enum class CURRENT_ENV{LOCAL, TEST, PRE, PROD};
 extern CURRENT_ENV g_current_env;
 
-// 注册到Eureka注册中心，取消注册会在ReleaseService中自动进行
+// 注册到Eureka注册中心，取消注册会在SIGTERM摘流或ReleaseService中自动进行
 void ConnectEureka();
 
 /**
@@ -36,9 +36,11 @@ void ReleaseService();
 
 enum class HTTP_METHOD{POST, PUT, GET, UPDATE};
 using ListenURL = std::pair<const std::string, HTTP_METHOD>;
+// 参数：请求、响应体、响应的Content-Type(为空时不设置)
 using EventFunc = std::function<void(const crow::request &, 
+                                     std::string&, 
                                      std::string&)>;
 // 结构：<<url, http_method>, request_callback>
 using RequestEvents = std::vector<std::pair<ListenURL, EventFunc>>;
-// 开始监听请求
+// 开始监听请求，收到SIGTERM/SIGINT后摘流并返回
 void Listen(RequestEvents &events);
@@ -3,21 +3,33 @@
 #include "base/command_line.h"
 
 #include "app.h"
+#include "metrics.h"
 
 static void Listen() {
     RequestEvents url_events;
     auto welcome = [](const crow::request &request, 
-                      std::string &response)->void {
+                      std::string &response, 
+                      std::string &content_type)->void {
         response = "welcome to micro service";
     };
     auto welcome_url = std::make_pair("/health", HTTP_METHOD::GET);
     url_events.emplace_back(std::make_pair(welcome_url, welcome));
 
+    auto metrics = [](const crow::request &request, 
+                      std::string &response, 
+                      std::string &content_type)->void {
+        response = Metrics::Export();
+    };
+    auto metrics_url = std::make_pair("/metrics", HTTP_METHOD::GET);
+    url_events.emplace_back(std::make_pair(metrics_url, metrics));
+
     auto demo_request = [](const crow::request &request, 
-                      std::string &response)->void {
+                      std::string &response, 
+                      std::string &content_type)->void {
         // 这个路由是PaaS新增业务时的路由地址全称：对外的地址全称
         MicroserviceDemo service{"/aiimage/cn-composition", request};
         service.ProcessRequest(response);
+        content_type = service.ContentType();
     };
     // 这个路由是PaaS新增业务时替换前缀后面的那部分，这里的样例是在PaaS中
     // 配置的替换前缀为2
@@ -7,6 +7,7 @@
 
 #include "url_request.hpp"
 #include "base/logging.h"
+#include "http_client.h"
 
 using namespace std;
 using namespace logging;
@@ -42,7 +43,11 @@ bool URLRequest::request(string url, map<string, string> &header, string &body,
 
 bool URLRequest::request(string url, map<string, string> &header, const char *body, size_t size, string &response,
 		int timeout, int retry) {
-	CURL *curl = curl_easy_init();
+	HttpClient::Handle handle;
+	CURL *curl = handle.Get();
+	if (!curl) {
+		return false;
+	}
 	long res_code = -1;
 	response = "";
 	struct curl_slist *li = nullptr;
@@ -67,7 +72,7 @@ bool URLRequest::request(string url, map<string, string> &header, const char *bo
         curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
         curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeout);
         curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
-        int ret = curl_easy_perform(curl);
+        int ret = handle.Perform();
 
         if(ret == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &res_code);
         if (res_code == 200) {
@@ -77,7 +82,6 @@ bool URLRequest::request(string url, map<string, string> &header, const char *bo
         LOG(INFO) << url << " request error code : " << res_code;
 	}
 	curl_slist_free_all(li);
-	curl_easy_cleanup(curl);
 	if (res_code != 200)
 		return false;
 	return true;